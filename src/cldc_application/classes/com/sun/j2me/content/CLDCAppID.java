@@ -34,6 +34,11 @@ public class CLDCAppID implements ApplicationID {
 	public int		suiteID;
 	public String	className;
 	
+	/** The invocation store handle; valid for handleSuiteID and handleClassName */
+	private int		handle;
+	private int		handleSuiteID;
+	private String	handleClassName;
+	
 	public CLDCAppID( int suiteID, String classname) {
 		this.suiteID = suiteID;
 		this.className = classname;
@@ -48,7 +53,27 @@ public class CLDCAppID implements ApplicationID {
 	}
 	
 	public ApplicationID duplicate() {
-		return new CLDCAppID(suiteID, className);
+		CLDCAppID app = new CLDCAppID(suiteID, className);
+		app.handle = handle;
+		app.handleSuiteID = handleSuiteID;
+		app.handleClassName = handleClassName;
+		return app;
+	}
+	
+	/**
+	 * Returns the handle the application is registered with in the
+	 * invocation store. The application is registered on the first call
+	 * and again only if the public fields are changed.
+	 * 
+	 * @return the application handle
+	 */
+	int handle() {
+		if( handle == 0 || handleSuiteID != suiteID || handleClassName != className ){
+			handle = InvocationStore.registerApp0(suiteID, className);
+			handleSuiteID = suiteID;
+			handleClassName = className;
+		}
+		return handle;
 	}
 
 	public void serialize(DataOutputStream dataOut) throws IOException {
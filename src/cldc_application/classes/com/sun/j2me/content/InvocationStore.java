@@ -187,18 +187,8 @@ public class InvocationStore implements StoreGate {
         }
         invoc.tid = tid;
         
-    	int s = 0;
-    	while ((s = getByTid0(invoc, tid, mode)) == -1) {
-    		/*
-    		 * Sizes of arguments and data buffers were insufficient
-    		 * reallocate and retry.
-    		 */
-    		invoc.setArgs(new String[invoc.argsLen]);
-    		invoc.setData(new byte[invoc.dataLen]);
-    	}
-    
-    	// Update the return if no invocation
-    	if (s == 0) {
+    	// the native side allocates the arguments and data arrays
+    	if (getByTid0(invoc, tid, mode) == 0) {
     	    invoc = null;
     	}
     
@@ -228,20 +218,8 @@ public class InvocationStore implements StoreGate {
      */
     private static InvocationImpl get(CLDCAppID appID, int mode, int blockID) {
     	InvocationImpl invoc = new InvocationImpl();
-    	int s;
-    	while((s = get0(invoc, appID.suiteID, appID.className, mode, blockID)) == -1) {
-    		if( Logger.LOGGER != null )
-    			Logger.LOGGER.println("InvocationStore.get0 returns " + s);
-    		/*
-    		 * Sizes of arguments and data buffers were insufficient
-    		 * reallocate and retry.
-    		 */
-    		invoc.setArgs(new String[invoc.argsLen]);
-    		invoc.setData(new byte[invoc.dataLen]);
-    	}
-    
-    	// Update the return if no invocation
-    	if (s == 0) {
+    	// the native side allocates the arguments and data arrays
+    	if (get0(invoc, appID.handle(), mode, blockID) == 0) {
     	    invoc = null;
     	}
     
@@ -266,8 +244,7 @@ public class InvocationStore implements StoreGate {
      */
     public boolean waitForEvent(ApplicationID appID, boolean request, int blockID) {
         final int mode = (request ? MODE_LREQUEST : MODE_LRESPONSE);
-        CLDCAppID app = CLDCAppID.from(appID);
-        boolean pending = listen0(app.suiteID, app.className, mode, blockID);
+        boolean pending = listen0(CLDCAppID.from(appID).handle(), mode, blockID);
         if (Logger.LOGGER != null) {
             Logger.LOGGER.println("Store listen: " + appID +
                                           ", request: " + request +
@@ -289,8 +266,7 @@ public class InvocationStore implements StoreGate {
      */
     public void resetListenNotifiedFlag(ApplicationID appID, boolean request) {
         int mode = (request ? MODE_LREQUEST : MODE_LRESPONSE);
-        CLDCAppID app = CLDCAppID.from(appID);
-        resetListenNotifiedFlag0(app.suiteID, app.className, mode);
+        resetListenNotifiedFlag0(CLDCAppID.from(appID).handle(), mode);
 
         if (Logger.LOGGER != null) {
             Logger.LOGGER.println("Store setListenNotify: " +
@@ -324,7 +300,7 @@ public class InvocationStore implements StoreGate {
             Logger.LOGGER.println("Store setCleanup: " + appID +
                                           ": " + cleanup);
         }
-        setCleanupFlag0(CLDCAppID.from(appID).suiteID, CLDCAppID.from(appID).className, cleanup);
+        setCleanupFlag0(CLDCAppID.from(appID).handle(), cleanup);
     }
 
     /**
@@ -332,7 +308,9 @@ public class InvocationStore implements StoreGate {
      * @return the number of invocations in the native queue
      */
     public int requestsCount(ApplicationID appID) {
-        return requestsCount0(CLDCAppID.from(appID).suiteID, CLDCAppID.from(appID).className);
+        CLDCAppID app = CLDCAppID.from(appID);
+        // no classname counts all the invocations of the suite
+        return requestsCount0(app.suiteID, (app.className != null)? app.handle() : 0);
     }
 
     public void update(InvocationImpl invoc) {
@@ -361,6 +339,33 @@ public class InvocationStore implements StoreGate {
 		dispose0(tid);
 	}
 	
+    /**
+     * Native method to register the application in the store.
+     * The same handle is returned for every registration of
+     * the suiteId and classname until the suite is released.
+     *
+     * @param suiteId the MIDletSuite ID of the application
+     * @param classname the classname of the application
+     * @return the application handle, a positive integer
+     * @see CLDCAppID#handle
+     * @see #releaseSuite
+     */
+    static native int registerApp0(int suiteId, String classname);
+
+    /**
+     * Releases the handles of the applications of the removed suite.
+     * The released handles match no invocations.
+     *
+     * @param suiteId the MIDletSuite ID of the removed suite
+     */
+    static void releaseSuite(int suiteId) {
+    	if( Logger.LOGGER != null )
+    		Logger.LOGGER.println("InvocationStore.releaseSuite(" + suiteId + ")");
+        releaseSuite0(suiteId);
+    }
+
+    private static native void releaseSuite0(int suiteId);
+
     /**
      * Native method to store a new Invocation.
      * All of the fields of the InvocationImpl are stored.
@@ -378,18 +383,17 @@ public class InvocationStore implements StoreGate {
      * from the store.
      * @param invoc the Invocation containing the suiteId and
      *  classname to fill in with an available invocation.
-     * @param suiteId the MIDletSuite ID to match
-     * @param classname the classname to match
+     * @param app the handle of the application to match
      * @param mode one of {@link #MODE_REQUEST}, {@link #MODE_RESPONSE},
      *    or {@link #MODE_CLEANUP}
      * @param blockID True if the method should block until an
      *    Invocation is available
      * @return 1 if a matching invocation was found and returned
-     *    in its entirety; zero if there was no matching invocation;
-     *    -1 if the sizes of the arguments or parameter array were wrong
+     *    in its entirety, the arguments and data arrays are allocated
+     *    as needed; zero if there was no matching invocation
      * @see #get
      */
-    private static native int get0(InvocationImpl invoc, int suiteId, String classname, 
+    private static native int get0(InvocationImpl invoc, int app, 
                                     int mode, int blockID);
 
     private static native int getByTid0(InvocationImpl invoc, int tid, int mode);
@@ -401,16 +405,14 @@ public class InvocationStore implements StoreGate {
      * Each Invocation will only be returned once to prevent
      * multiple notifications.
      *
-     * @param suiteId the MIDletSuite ID to match
-     * @param classname the classname to match
+     * @param app the handle of the application to match
      * @param mode one of {@link #MODE_LREQUEST}, {@link #MODE_LRESPONSE}
      * @param blockID true if the method should block until an
      *     Invocation is available
      * @return true if a matching invocation was found; otherwise false.
      * @see #get0
      */
-    private static native boolean listen0(int suiteId, String classname,
-                                          int mode, int blockID);
+    private static native boolean listen0(int app, int mode, int blockID);
 
     /**
      * Native method to reset the listen notified state for pending
@@ -418,14 +420,12 @@ public class InvocationStore implements StoreGate {
      * Each Invocation will only be returned once to prevent
      * multiple notifications.
      *
-     * @param suiteId the MIDletSuite ID to match
-     * @param classname the classname to match
+     * @param app the handle of the application to match
      * @param mode one of {@link #MODE_LREQUEST}, {@link #MODE_LRESPONSE}
      *   <code>false</code> to reset the notified state for responses
      * @see #listen0
      */
-    private static native void resetListenNotifiedFlag0(int suiteId, String classname,
-                                                int mode);
+    private static native void resetListenNotifiedFlag0(int app, int mode);
 
     /**
      * Native method to unblock any threads that might be
@@ -440,20 +440,20 @@ public class InvocationStore implements StoreGate {
      * Sets the cleanup flag in matching Invocations.
      * Any marked invocation will be modified by {@link #getCleanup}.
      *
-     * @param suiteId the MIDlet suiteId to search for,
-     *  MUST not be <code>null</code>
-     * @param classname to match, must not be null
+     * @param app the handle of the application to match
      * @param cleanup <code>true</code> to mark the Invocation for
      *  cleanup at exit
      */
-    private static native void setCleanupFlag0(int suiteId, String classname,
-                                           boolean cleanup);
+    private static native void setCleanupFlag0(int app, boolean cleanup);
 
     /**
      * Return the number of invocations in the native queue for the specified app.
+     * @param suiteId the MIDlet suiteId to search for
+     * @param app the handle of the application to match,
+     *  0 to match any class of the suite
      * @return the number of invocations in the native queue
      */
-    private static native int requestsCount0(int suiteId, String classname);
+    private static native int requestsCount0(int suiteId, int app);
     
     private static native void update0(InvocationImpl invoc);
     private static native void resetFlags0(int tid);
@@ -26,6 +26,7 @@
 
 package com.sun.j2me.content;
 
+import java.util.Hashtable;
 import java.util.Vector;
 
 /**
@@ -41,6 +42,32 @@ class RegistryStore implements RegistryGate {
     static final Vector emptyVector = new Vector();
     static final ContentHandlerImpl[] emptyHandlersArray = new ContentHandlerImpl[0]; 
 
+    /** Deserialized results of <code>getValues</code> and 
+     * <code>getHandlerValues</code>, keyed by the request arguments. */
+    private final Hashtable valuesCache = new Hashtable();
+
+    /** Registry generation the cached values belong to. */
+    private int cacheGeneration = -1;
+
+    /** Initial size of the transfer array. A larger result is taken
+     * into the array of its exact size. */
+    private static final int TRANSFER_SIZE = 0x100;
+
+    /** Estimated number of characters transferred per handler. */
+    private static final int HANDLER_CHARS = 0x40;
+
+    /** Largest number of handlers the page array is estimated for. */
+    private static final int PAGE_ESTIMATE = 0x20;
+
+    /** Handler record with the hexadecimal suite ID and flag. */
+    private static final int RECORD_HEX = 0;
+
+    /** Handler record with the binary suite ID and flag. */
+    private static final int RECORD_BINARY = 1;
+
+    /** Handler record format negotiated with the native registry. */
+    private static int recordFormat = RECORD_HEX;
+
 	public ContentHandlerImpl.Data register(ApplicationID appID,
 										ContentHandlerRegData handlerData) {
         if( !register0(CLDCAppID.from(appID).suiteID, CLDCAppID.from(appID).className, 
@@ -60,9 +87,15 @@ class RegistryStore implements RegistryGate {
 
 	public void enumHandlers(String callerId, int fieldId, String value,
 						ContentHandlerImpl.Handle.Receiver output) {
-		ContentHandlerImpl[] result = findHandler(callerId, fieldId, value);
-		for( int i = 0; i < result.length; i++)
-			output.push(result[i].handle);
+        /* Check value for null */
+        value.length();
+        ResultCursor cursor;
+        synchronized (this) {
+            char[] buf = new char[ TRANSFER_SIZE ];
+            cursor = transferred(buf, findHandler0(callerId, fieldId, value, buf));
+        }
+        // the handlers not reached by the receiver are never built
+        pushHandlers(cursor, output);
 	}
 
     /**
@@ -101,10 +134,31 @@ class RegistryStore implements RegistryGate {
      */
     public ContentHandlerImpl[] findHandler(String callerId, int fieldId, 
                                                 String value) {
-        /* Check value for null */
-        value.length();
         HandlersCollection collection = new HandlersCollection();
-        deserializeCHArray(findHandler0(callerId, fieldId, value), collection);
+        enumHandlers(callerId, fieldId, value, collection);
+        return collection.getArray(); 
+    }
+
+    /**
+     * Searches content handlers by the content URL suffix. The longest
+     * suffix of the URL file name matched by registered handlers ranks
+     * first, e.g. <code>.tar.gz</code> before <code>.gz</code>.
+     * @param callerId ID value to check access
+     * @param url content URL
+     * @param action requested action or <code>null</code> if any
+     * @return found handlers array.
+     */
+    public ContentHandlerImpl[] findHandlerByURL(String callerId, String url,
+                                                String action) {
+        /* Check url for null */
+        url.length();
+        ResultCursor cursor;
+        synchronized (this) {
+            char[] buf = new char[ TRANSFER_SIZE ];
+            cursor = transferred(buf, getByURL0(callerId, url, action, buf));
+        }
+        HandlersCollection collection = new HandlersCollection();
+        pushHandlers(cursor, collection);
         return collection.getArray(); 
     }
 
@@ -115,8 +169,13 @@ class RegistryStore implements RegistryGate {
      * @return found handlers array.
      */
     public ContentHandlerImpl[] forSuite(int suiteId) {
+        ResultCursor cursor;
+        synchronized (this) {
+            char[] buf = new char[ TRANSFER_SIZE ];
+            cursor = transferred(buf, forSuite0(suiteId, buf));
+        }
         HandlersCollection collection = new HandlersCollection();
-        deserializeCHArray(forSuite0(suiteId), collection);
+        pushHandlers(cursor, collection);
         return collection.getArray(); 
     }
     
@@ -145,10 +204,15 @@ class RegistryStore implements RegistryGate {
      * @return found values array.
      */
     public String[] getValues(String callerId, int fieldId) {
-        String res = getValues0(callerId, fieldId);
-        Vector v = deserializeString(res);
-        String[] result = new String[ v.size() ];
-        v.copyInto(result);
+        String key = fieldId + (callerId == null? "": ":" + callerId);
+        String[] result = getCached(key);
+        if (result == null) {
+            String res = getValues0(callerId, fieldId);
+            Vector v = deserializeString(res);
+            result = new String[ v.size() ];
+            v.copyInto(result);
+            putCached(key, result);
+        }
         if( Logger.LOGGER != null ){
         	StringBuffer b = new StringBuffer();
         	for( int i = 0; i < result.length; i++)
@@ -169,12 +233,106 @@ class RegistryStore implements RegistryGate {
      * @return array of values
      */
     public String[] getHandlerValues(String handlerId, int fieldId) {
-        String res = loadFieldValues0(handlerId, fieldId);
-        Vector v = deserializeString(res);
-        String[] result = new String[ v.size() ];
-        v.copyInto(result);
+        String key = "#" + fieldId + ":" + handlerId;
+        String[] result = getCached(key);
+        if (result == null) {
+            String res = loadFieldValues0(handlerId, fieldId);
+            Vector v = deserializeString(res);
+            result = new String[ v.size() ];
+            v.copyInto(result);
+            putCached(key, result);
+        }
+        return result;
+    }
+
+    /**
+     * Opens the cursor paging through the handlers found by the type,
+     * suffix or action.
+     * @param callerId ID value to check access
+     * @param fieldId index of searchable field
+     * @param value searched value
+     * @return cursor handle or 0 if the cursor can't be opened
+     */
+    public int openCursor(String callerId, int fieldId, String value) {
+        /* Check value for null */
+        value.length();
+        return openCursor0(callerId, fieldId, value);
+    }
+
+    /**
+     * Returns the next page of the found handlers. The handlers are paged
+     * in the order of their IDs, a page continues after the last ID of the
+     * previous one even if the registry has changed meanwhile.
+     * @param cursor cursor handle
+     * @param maxCount maximum number of handlers in the page
+     * @return the page, an empty array when the cursor is exhausted
+     * @exception RuntimeException if the cursor is closed or has been
+     *  reclaimed by the newer cursors, so the rest of the result is
+     *  unavailable
+     */
+    public ContentHandlerImpl[] nextPage(int cursor, int maxCount) {
+        ResultCursor page;
+        // the array is estimated from the page size, a larger page is retaken
+        int size = Math.min(maxCount, PAGE_ESTIMATE) * HANDLER_CHARS;
+        synchronized (this) {
+            char[] buf = new char[ Math.max(size, TRANSFER_SIZE) ];
+            page = transferred(buf, nextPage0(cursor, maxCount, buf));
+        }
+        HandlersCollection collection = new HandlersCollection();
+        pushHandlers(page, collection);
+        return collection.getArray();
+    }
+
+    /**
+     * Closes the cursor.
+     * @param cursor cursor handle
+     */
+    public void closeCursor(int cursor) {
+        closeCursor0(cursor);
+    }
+
+    /**
+     * Returns the registry generation. It is changed by every 
+     * registration and unregistration.
+     * @return current registry generation
+     */
+    public int getGeneration() {
+        return getGeneration0();
+    }
+
+    /**
+     * Returns a copy of the cached values. The cache is dropped when
+     * the registry generation changes.
+     * @param key request key
+     * @return copy of the values or <code>null</code> if not cached
+     */
+    private synchronized String[] getCached(String key) {
+        int generation = getGeneration0();
+        if (generation != cacheGeneration) {
+            valuesCache.clear();
+            cacheGeneration = generation;
+            return null;
+        }
+        String[] values = (String[])valuesCache.get(key);
+        if (values == null)
+            return null;
+        String[] result = new String[ values.length ];
+        System.arraycopy(values, 0, result, 0, values.length);
         return result;
     }
+
+    /**
+     * Caches the values for the current registry generation.
+     * @param key request key
+     * @param values values to cache, a copy is stored
+     */
+    private synchronized void putCached(String key, String[] values) {
+        if (cacheGeneration == getGeneration0()) {
+            String[] copy = new String[ values.length ];
+            System.arraycopy(values, 0, copy, 0, values.length);
+            valuesCache.put(key, copy);
+        }
+    }
     
     /**
      * Creates and loads handler's data.
@@ -208,6 +366,13 @@ class RegistryStore implements RegistryGate {
 		return selectSingleHandler0(action, pairs);
 	}
 
+    /**
+     * The first character of the serialized form framed with 32-bit
+     * lengths. The older framing with 16-bit lengths is recognized by its
+     * absence.
+     */
+    private static final char FRAMING_V2 = '\uFFFF';
+
     /**
      * Transforms serialized form to array of Strings.
      * <BR>Serialization format is the same as ContentHandlerImpl
@@ -219,19 +384,30 @@ class RegistryStore implements RegistryGate {
     private static Vector/*<String>*/ deserializeString(String str) {
     	if( str == null )
     		return emptyVector;
+    	if( str.length() > 0 && str.charAt(0) == FRAMING_V2 )
+    		return deserializeString(str, 1, true);
+    	return deserializeString(str, 0, false);
+    }
+
+    /**
+     * Transforms serialized form to array of Strings.
+     * @param str String in serialized form
+     * @param pos position of the first element
+     * @param v2 <code>true</code> if elements are framed with 32-bit
+     *        lengths (two characters, the high half first),
+     *        <code>false</code> for 16-bit lengths (one character)
+     * @return array of Strings
+     */
+    private static Vector/*<String>*/ deserializeString(String str, int pos,
+    														boolean v2) {
     	Vector result = new Vector();
     	// all lengths in bytes
-    	int pos = 0;
-//        if(Logger.LOGGER != null) 
-//        	Logger.LOGGER.println( "deserializeString: string length = " + str.length() );
     	while( pos < str.length() ){
-    		int elem_length = (int)str.charAt(pos++) / 2;
-//            if(Logger.LOGGER != null) 
-//            	Logger.LOGGER.println( "deserializeString: pos = " + pos + 
-//            							", elem_length = " + elem_length );
+    		int elem_length = (int)str.charAt(pos++);
+    		if( v2 )
+    			elem_length = (elem_length << 16) | (int)str.charAt(pos++);
+    		elem_length /= 2;
     		result.addElement(str.substring(pos, pos + elem_length));
-//            if(Logger.LOGGER != null)
-//            	Logger.LOGGER.println( "deserializeString: '" + str.substring(pos, pos + elem_length) + "'" );
     		pos += elem_length;
     	}
         return result;
@@ -246,36 +422,102 @@ class RegistryStore implements RegistryGate {
     private static ContentHandlerImpl.Data deserializeCH(String str) {
         if(Logger.LOGGER != null) 
         	Logger.LOGGER.println( "RegistryStore.deserializeCH '" + str + "'");
-        Vector components = deserializeString(str);
+        return deserializeCH(deserializeString(str));
+    }
 
+    /**
+     * Restores ContentHandler main fields from the deserialized components.
+     * @param components ContentHandler main data components
+     * @return restored ContentHandlerImpl object or null
+     */
+    private static ContentHandlerImpl.Data deserializeCH(Vector components) {
         if (components.size() < 1) return null;
         String id = (String)components.elementAt(0);
         if (id.length() == 0) return null; // ID is significant field
 
         if (components.size() < 2) return null;
-        String storageId = (String)components.elementAt(1);
+        int storageId = parseInt((String)components.elementAt(1));
 
         if (components.size() < 3) return null;
         String class_name = (String)components.elementAt(2);
 
         if (components.size() < 4) return null;
-        int regMethod = Integer.parseInt((String)components.elementAt(3), 16);
+        int regMethod = parseInt((String)components.elementAt(3));
 
-        return new ContentHandlerImpl.Data( id, new CLDCAppID( Integer.parseInt(storageId, 16), class_name ), regMethod );
+        return new ContentHandlerImpl.Data( id, new CLDCAppID( storageId, class_name ), regMethod );
     }
 
     /**
-     * Restores ContentHandlerImpl array from serialized form.
-     * @param str ContentHandlerImpl array in serialized form.
-     * @return restored ContentHandlerImpl array
+     * Parses the integer field of the handler record.
+     * @param field the field in the negotiated record format
+     * @return the field value
      */
-    private static void deserializeCHArray(String str,
+    private static int parseInt(String field) {
+        if (recordFormat != RECORD_BINARY)
+            return Integer.parseInt(field, 16);
+        int value = 0;
+        for (int i = 0; i < field.length(); i++)
+            value = value << 16 | field.charAt(i);
+        return value;
+    }
+
+    /**
+     * Completes the transfer of the query result. If the array was too
+     * small the native registry kept the result, it is taken into a new
+     * array then. Must be called with the store locked right after the
+     * query.
+     * @param buf array passed to the query
+     * @param count the query return value: the number of characters
+     *        transferred or the negated number of characters required
+     * @return cursor over the transferred result
+     */
+    private ResultCursor transferred(char[] buf, int count) {
+        if (count < 0) {
+            buf = new char[ -count ];
+            count = takeResult0(buf);
+        }
+        return new ResultCursor(buf, 0, count);
+    }
+
+    /**
+     * Pushes the handlers of the transferred array one by one. The handler
+     * data is parsed right from the array, only when the receiver
+     * accepts the previous handler.
+     * @param cursor cursor over the handlers array
+     * @param output handlers receiver
+     */
+    private static void pushHandlers(ResultCursor cursor,
     						ContentHandlerImpl.Handle.Receiver output) {
-    	if( str != null ){
-	        Vector strs = deserializeString(str);
-	        for (int i = 0; i < strs.size(); i++)
-	        	output.push(new ContentHandlerHandle(deserializeCH( (String)strs.elementAt(i) )));
-    	}
+        while (cursor.next()) {
+            ContentHandlerImpl.Data data = deserializeCH(cursor.open());
+            if (data != null)
+                output.push(new ContentHandlerHandle(data));
+        }
+    }
+
+    /**
+     * Restores ContentHandler main fields (ID, suite_ID, class_name and
+     * flag) from the transferred array.
+     * @param fields cursor over the handler fields
+     * @return restored ContentHandlerImpl object or null
+     */
+    private static ContentHandlerImpl.Data deserializeCH(ResultCursor fields) {
+        if (!fields.next()) return null;
+        String id = fields.getString();
+        if (id.length() == 0) return null; // ID is significant field
+
+        boolean binary = recordFormat == RECORD_BINARY;
+
+        if (!fields.next()) return null;
+        int storageId = binary? fields.getInt(): fields.getHex();
+
+        if (!fields.next()) return null;
+        String class_name = fields.getString();
+
+        if (!fields.next()) return null;
+        int regMethod = binary? fields.getInt(): fields.getHex();
+
+        return new ContentHandlerImpl.Data( id, new CLDCAppID( storageId, class_name ), regMethod );
     }
 
     /** Singleton instance. Worker for the class static methods. */
@@ -292,9 +534,11 @@ class RegistryStore implements RegistryGate {
         } catch (ClassNotFoundException cnfe) {
             throw new RuntimeException(cnfe.getMessage());
         }
-        if (!init()) {
+        int format = init(RECORD_BINARY);
+        if (format < 0) {
             throw new RuntimeException("RegistryStore initialization failed");
         }
+        recordFormat = format;
 		if( Logger.LOGGER != null )
 			Logger.LOGGER.println("RegistryStore has created");
     }
@@ -308,17 +552,74 @@ class RegistryStore implements RegistryGate {
      * @param callerId ID value to check access
      * @param searchBy index of searchable field.
      * @param value searched value
-     * @return found handlers array in serialized form.
+     * @param buf array to transfer found handlers array into
+     * @return number of transferred characters or, if <code>buf</code>
+     *        is too small, negated number of characters required by
+     *        <code>takeResult0</code>
      */
-    private static native String findHandler0(String callerId, int searchBy,
-                                        String value);
+    private static native int findHandler0(String callerId, int searchBy,
+                                        String value, char[] buf);
+
+    /**
+     * Native implementation of <code>findHandlerByURL</code>.
+     * @param callerId ID value to check access
+     * @param url content URL
+     * @param action requested action or <code>null</code>
+     * @param buf array to transfer found handlers array into
+     * @return number of transferred characters or, if <code>buf</code>
+     *        is too small, negated number of characters required by
+     *        <code>takeResult0</code>
+     */
+    private static native int getByURL0(String callerId, String url,
+                                        String action, char[] buf);
 
     /**
      * Native implementation of <code>findBySuite</code>.
      * @param suiteId explored suite Id
-     * @return handlers registered for the given suite in serialized form.
+     * @param buf array to transfer the handlers registered for the given
+     *        suite into
+     * @return number of transferred characters or, if <code>buf</code>
+     *        is too small, negated number of characters required by
+     *        <code>takeResult0</code>
      */
-    private static native String forSuite0(int suiteId);
+    private static native int forSuite0(int suiteId, char[] buf);
+
+    /**
+     * Transfers the result kept by the previous query which array
+     * was too small.
+     * @param buf array to transfer the result into
+     * @return number of transferred characters, 0 if no result is kept
+     *        or the negated number of characters required
+     */
+    private static native int takeResult0(char[] buf);
+
+    /**
+     * Native implementation of <code>openCursor</code>.
+     * @param callerId ID value to check access
+     * @param searchBy index of searchable field.
+     * @param value searched value
+     * @return cursor handle or 0 if the cursor can't be opened
+     */
+    private static native int openCursor0(String callerId, int searchBy,
+                                        String value);
+
+    /**
+     * Native implementation of <code>nextPage</code>.
+     * @param cursor cursor handle
+     * @param maxCount maximum number of handlers in the page
+     * @param buf array to transfer the page into
+     * @return number of transferred characters or, if <code>buf</code>
+     *        is too small, negated number of characters required by
+     *        <code>takeResult0</code>
+     * @exception RuntimeException if the cursor is not open
+     */
+    private static native int nextPage0(int cursor, int maxCount, char[] buf);
+
+    /**
+     * Native implementation of <code>closeCursor</code>.
+     * @param cursor cursor handle
+     */
+    private static native void closeCursor0(int cursor);
 
     /**
      * Native implementation of <code>getValues</code>.
@@ -328,6 +629,12 @@ class RegistryStore implements RegistryGate {
      */
     private static native String getValues0(String callerId, int searchBy);
 
+    /**
+     * Native implementation of <code>getGeneration</code>.
+     * @return current registry generation
+     */
+    private static native int getGeneration0();
+
     /**
      * Loads content handler data.
      * @param callerId ID value to check access.
@@ -354,10 +661,12 @@ class RegistryStore implements RegistryGate {
     
     /**
      * Initialize persistence storage.
-     * @return <code>true</code> or
-     * <BR><code>false</code> if initialization fails.
+     * @param recordFormat the most compact handler record format
+     *        supported, @link RECORD_BINARY
+     * @return the handler record format selected by the native registry
+     * <BR>or -1 if initialization fails.
      */
-    private static native boolean init();
+    private static native int init(int recordFormat);
 
     /**
      * Cleanup native resources.
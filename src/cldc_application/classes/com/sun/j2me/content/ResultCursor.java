@@ -0,0 +1,122 @@
+/*
+ *
+ *
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation. 
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt). 
+ * 
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA 
+ * 
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions. 
+ */
+
+package com.sun.j2me.content;
+
+/**
+ * Reads the registry query result in place, as the native registry
+ * transferred it into a char array. Elements are framed with 32-bit byte
+ * lengths, two characters each, the high half first. An element is
+ * converted to a String only when it is requested, so the elements the
+ * caller skips are never built.
+ */
+final class ResultCursor {
+    /** The transferred data. */
+    private final char[] data;
+    /** End of the enumerated level. */
+    private final int end;
+    /** Start of the next element. */
+    private int pos;
+    /** Start of the current element content. */
+    private int elemStart;
+    /** End of the current element content. */
+    private int elemEnd;
+
+    /**
+     * Creates the cursor over the level of the data.
+     * @param data transferred data
+     * @param begin start of the level content
+     * @param end end of the level content
+     */
+    ResultCursor(char[] data, int begin, int end) {
+        this.data = data;
+        this.pos = begin;
+        this.end = end;
+    }
+
+    /**
+     * Moves to the next element of the level.
+     * @return <code>false</code> if there are no more elements
+     */
+    boolean next() {
+        if (pos + 2 > end)
+            return false;
+        int length = ((int)data[pos] << 16 | (int)data[pos + 1]) / 2;
+        elemStart = pos + 2;
+        elemEnd = elemStart + length;
+        pos = elemEnd;
+        return true;
+    }
+
+    /**
+     * Returns the current element as a string.
+     * @return the string
+     */
+    String getString() {
+        return new String(data, elemStart, elemEnd - elemStart);
+    }
+
+    /**
+     * Parses the current element as a hexadecimal number.
+     * @return the number
+     * @exception NumberFormatException if the element is not a number
+     */
+    int getHex() {
+        int i = elemStart;
+        boolean negative = i < elemEnd && data[i] == '-';
+        int value = 0;
+        if (negative) i++;
+        if (i == elemEnd)
+            throw new NumberFormatException();
+        for (; i < elemEnd; i++) {
+            int digit = Character.digit(data[i], 16);
+            if (digit < 0)
+                throw new NumberFormatException();
+            value = value << 4 | digit;
+        }
+        return negative? -value: value;
+    }
+
+    /**
+     * Reads the current element as a binary number, one or two
+     * characters, the high half first.
+     * @return the number
+     */
+    int getInt() {
+        int value = 0;
+        for (int i = elemStart; i < elemEnd; i++)
+            value = value << 16 | data[i];
+        return value;
+    }
+
+    /**
+     * Opens the nested level stored as the current element.
+     * @return the cursor over the nested level
+     */
+    ResultCursor open() {
+        return new ResultCursor(data, elemStart, elemEnd);
+    }
+}
@@ -163,6 +163,7 @@ public class CHManagerImpl extends CHManagerBase {
     public void uninstall(int suiteId) {
         if( Logger.LOGGER != null ) Logger.LOGGER.println( "CHManagerImpl.uninstall()" );
         RegistryInstaller.uninstallAll(suiteId, false);
+        InvocationStore.releaseSuite(suiteId);
     }
     
     public InvocationProxy getInvocation(MIDlet midlet){
@@ -0,0 +1,107 @@
+/*
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation. 
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt). 
+ * 
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA 
+ * 
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions. 
+ */
+
+/**
+ * @file
+ * @defgroup chapi JSR 211 Content Handler API (CHAPI)
+ * @ingroup msa
+ * @brief Radix trie of the registered content handler IDs.
+ * ##include <jsr211_id_trie.h>
+ * @{
+ * <P>
+ * The trie is maintained by the registry index and answers the ID
+ * relation queries with a single traversal of the requested ID: the
+ * handlers whose IDs are prefixes of a value and the handlers whose IDs
+ * start with the value. Nodes are labeled with UTF-16 strings, children
+ * of a node are kept in a sibling list.
+ */
+
+#ifndef _JSR211_ID_TRIE_H_
+#define _JSR211_ID_TRIE_H_
+
+#include "jsr211_registry_index.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif/*__cplusplus*/
+
+/**
+ * Trie visitor callback.
+ *
+ * @param h visited handler
+ * @param ctx visitor context
+ * @return JSR211_OK to continue the traversal
+ */
+typedef jsr211_result (*jsr211_trie_visitor)(jsr211_index_handler* h, void* ctx);
+
+/**
+ * Inserts the handler ID into the trie.
+ *
+ * @param h indexed handler
+ * @return JSR211_OK or JSR211_FAILED if no memory available
+ */
+jsr211_result jsr211_trie_insert(jsr211_index_handler* h);
+
+/**
+ * Removes the handler ID from the trie.
+ *
+ * @param id handler ID
+ * @param len ID length in jchars
+ */
+void jsr211_trie_remove(const jchar* id, size_t len);
+
+/**
+ * Removes all IDs from the trie and releases its memory.
+ */
+void jsr211_trie_release(void);
+
+/**
+ * Visits all handlers conflicting with the ID, i.e. the handlers whose
+ * IDs are prefixes of the ID, equal to it or start with it.
+ *
+ * @param id tested ID
+ * @param len ID length in jchars
+ * @param visitor callback called for each conflicting handler
+ * @param ctx visitor context
+ * @return JSR211_OK or the first failed visitor status
+ */
+jsr211_result jsr211_trie_conflicts(const jchar* id, size_t len,
+                        jsr211_trie_visitor visitor, void* ctx);
+
+/**
+ * Finds the handler with the longest ID being a prefix of the given ID.
+ *
+ * @param id requested ID
+ * @param len ID length in jchars
+ * @return found handler or NULL
+ */
+jsr211_index_handler* jsr211_trie_prefix_of(const jchar* id, size_t len);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif/*__cplusplus*/
+
+#endif  /* _JSR211_ID_TRIE_H_ */
@@ -46,10 +46,20 @@
 extern "C" {
 #endif/*__cplusplus*/
 
+/**
+ * String of a stored invocation. The characters are zero terminated
+ * and kept in the single block of the invocation strings, arguments
+ * and data.
+ */
+typedef struct _StoredString {
+    const jchar*        data;    /**< The characters; NULL for a null string */
+    jsize               length;    /**< The number of the characters */
+} StoredString;
+
 /** Stored ApplicationID (CLDC version) */
 typedef struct _StoredCLDCAppID {
     javacall_suite_id   suiteID;    /**< The target MIDlet suiteID */
-    pcsl_string         className;    /**< The target classname */
+    StoredString        className;    /**< The target classname */
 } StoredCLDCAppID;
 
 /**
@@ -63,24 +73,24 @@ typedef struct _StoredInvoc {
     jint        tid;        /**< The assigned transaction id */
     jint        previousTid;    /**< The tid of a previous Invocation */
 
-    pcsl_string url;        /**< The URL of the request */
-    pcsl_string type;        /**< The type of the request */
-    pcsl_string action;        /**< The action of the request */
+    StoredString url;        /**< The URL of the request */
+    StoredString type;        /**< The type of the request */
+    StoredString action;        /**< The action of the request */
     int         argsLen;    /**< The length of the argument array */
-    pcsl_string* args;        /**< The arguments */
+    StoredString* args;        /**< The arguments */
     void*       data;        /**< The data; may be NULL */
     int         dataLen;    /**< The length of the data in bytes */
 
-    pcsl_string ID;        /**< The ID of the handler requested */
+    StoredString ID;        /**< The ID of the handler requested */
     StoredCLDCAppID destinationApp;  
 
-    pcsl_string invokingAuthority; /**< The invoking authority string */
-    pcsl_string invokingAppName; /**< The invoking name */
-    pcsl_string invokingID;    /**< The invoking Application ID */
+    StoredString invokingAuthority; /**< The invoking authority string */
+    StoredString invokingAppName; /**< The invoking name */
+    StoredString invokingID;    /**< The invoking Application ID */
     StoredCLDCAppID invokingApp;  
 
-    pcsl_string username;    /**< The username provided as credentials */
-    pcsl_string password;    /**< The password provided as credentials */
+    StoredString username;    /**< The username provided as credentials */
+    StoredString password;    /**< The password provided as credentials */
 } StoredInvoc;
 
 /**
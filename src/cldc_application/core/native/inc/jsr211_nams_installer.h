@@ -66,8 +66,9 @@ int jsr211_verify_handlers(MidpProperties jadsmp, MidpProperties mfsmp,
 
 /**
  * Stores installing Content Handlers in the JSR211 complaint registry.
+ * The handlers are stored all or none.
  * @param suiteID installing suite ID
- * @return 0 if handlers are stored successfully.
+ * @return 0 if handlers are stored successfully, -1 if none is stored.
  */
 int jsr211_store_handlers(SuiteIdType suiteId);
 
@@ -0,0 +1,81 @@
+/*
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation. 
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt). 
+ * 
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA 
+ * 
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions. 
+ */
+
+
+/**
+ * @file
+ * @defgroup chapi JSR 211 Content Handler API (CHAPI)
+ * @ingroup msa
+ * @brief Extensions of the POSIX javacall CHAPI registry.
+ * ##include <jsr211_posix_registry.h>
+ * @{
+ * <P>
+ * The reference registry journals every modification and synchronizes the
+ * journal every few records. The registry layer defers the sync while it
+ * stores a batch of handlers, so the batch costs one sync at its end.
+ * <P>
+ * The registry also keeps the content stamp, which combines the checksums
+ * of the live handler records. The stamp survives the restart and the
+ * journal compaction and changes with every modification, so the registry
+ * image can be validated against it.
+ * The functions are available if the reference registry is built, that is
+ * if ENABLE_JSR_211_POSIX_REGISTRY is set.
+ */
+
+#ifndef _JSR211_POSIX_REGISTRY_H_
+#define _JSR211_POSIX_REGISTRY_H_
+
+#include "javacall_chapi_registry.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif/*__cplusplus*/
+
+/**
+ * Defers the journal sync until @link jsr211_posix_registry_sync.
+ */
+void jsr211_posix_registry_defer_sync(void);
+
+/**
+ * Returns the content stamp of the registry. Registries with the same
+ * handlers have the same stamp.
+ *
+ * @return the content stamp
+ */
+unsigned int jsr211_posix_registry_stamp(void);
+
+/**
+ * Synchronizes the records appended to the journal and ends the deferral.
+ *
+ * @return JAVACALL_OK if the journal is synchronized
+ */
+javacall_result jsr211_posix_registry_sync(void);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif/*__cplusplus*/
+
+#endif  /* _JSR211_POSIX_REGISTRY_H_ */
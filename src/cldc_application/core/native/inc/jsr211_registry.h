@@ -196,6 +196,58 @@ jsr211_result jsr211_register_handler(const jsr211_content_handler* handler);
  */
 jsr211_result jsr211_unregister_handler(const jchar* handler_id);
 
+/**
+ * Registers the set of handlers as one unit. The whole set is validated
+ * before the first handler is stored: all mandatory fields are present and
+ * no ID conflicts with a registered handler or with another ID of the set.
+ * If any registration fails the handlers stored already are unregistered.
+ * The image log and the backend journal are written through once for the
+ * whole set.
+ *
+ * @param handlers registering handlers. Implementation MUST NOT retain
+ * pointed objects
+ * @param n number of handlers
+ * @return JSR211_OK if all handlers are registered
+ */
+jsr211_result jsr211_register_handlers_batch(const jsr211_content_handler* handlers, int n);
+
+/**
+ * Opens a registration batch. Handlers registered with
+ * @link jsr211_register_handler until @link jsr211_batch_commit or
+ * @link jsr211_batch_rollback form one unit: the registry generation is
+ * changed once at the end and the rollback unregisters all of them. The
+ * backend journal is synchronized once at the end of the batch.
+ * Batches can't be nested.
+ *
+ * @return JSR211_OK if the batch is opened
+ */
+jsr211_result jsr211_batch_begin(void);
+
+/**
+ * Commits the registration batch. If the backend journal can't be
+ * synchronized the batch is rolled back.
+ *
+ * @return JSR211_OK if the batch is committed
+ */
+jsr211_result jsr211_batch_commit(void);
+
+/**
+ * Rolls back the registration batch. The handlers registered in the batch
+ * are unregistered in the reverse order.
+ *
+ * @return JSR211_OK if all registrations are rolled back
+ */
+jsr211_result jsr211_batch_rollback(void);
+
+/**
+ * Returns the registry generation. The generation is changed by every
+ * successful registration or unregistration, so results of the registry
+ * queries may be reused while the generation stays the same.
+ *
+ * @return current registry generation
+ */
+int jsr211_get_generation(void);
+
 /**
  * Searches content handler using specified key and value.
  *
@@ -213,6 +265,47 @@ jsr211_result jsr211_find_handler(const jchar* caller_id,
                         jsr211_field key, const jchar* value,
                         /*OUT*/ JSR211_RESULT_CHARRAY result);
 
+/**
+ * Opens the cursor paging through the handlers registered for the given
+ * type, suffix or action, so that the memory used by a query is bounded
+ * by the page size. At most 8 cursors are open at a time, opening one
+ * more reclaims the least recently used cursor.
+ *
+ * @param caller_id calling application identifier
+ * @param key search field id: JSR211_FIELD_TYPES, JSR211_FIELD_SUFFIXES
+ * or JSR211_FIELD_ACTIONS
+ * @param value search value
+ * @param cursor output value - the cursor handle
+ * @return status of the operation
+ */
+jsr211_result jsr211_cursor_open(const jchar* caller_id,
+                        jsr211_field key, const jchar* value,
+                        /*OUT*/ int* cursor);
+
+/**
+ * Returns the next page of the cursor. The handlers are paged in the order
+ * of their IDs and a page continues after the last ID of the previous one,
+ * so handlers registered or unregistered between the pages are reflected
+ * by the following pages without skipping or repeating the others. The
+ * page is empty when the cursor is exhausted.
+ *
+ * @param cursor the cursor handle
+ * @param max_count maximum number of handlers in the page
+ * @param result output value - the found handlers array.
+ *  <br>Use @link jsr211_appendHandler function to fill this structure.
+ * @return status of the operation, JSR211_FAILED if the cursor is not open,
+ * e.g. it has been reclaimed, then the rest of the result is unavailable
+ */
+jsr211_result jsr211_cursor_next(int cursor, int max_count,
+                        /*OUT*/ JSR211_RESULT_CHARRAY result);
+
+/**
+ * Closes the cursor. Closing a cursor that is not open has no effect.
+ *
+ * @param cursor the cursor handle
+ */
+void jsr211_cursor_close(int cursor);
+
 /**
  * Fetches handlers registered for the given suite.
  *
@@ -225,12 +318,12 @@ jsr211_result jsr211_find_for_suite(SuiteIdType suiteId,
                         /*OUT*/ JSR211_RESULT_CHARRAY result);
 
 /**
- * Searches content handler using content URL. This function MUST define
- * content type and return default handler for this type if any.
+ * Searches content handler using content URL. The handler of the longest
+ * matching suffix is returned, see @link jsr211_handlers_by_URL.
  *
  * @param caller_id calling application identifier
  * @param url content URL
- * @param action requested action
+ * @param action requested action, NULL if any action is suitable
  * @param handler output value - requested handler.
  *  <br>Use @link jsr211_fillHandler function to fill this structure.
  * @return JSR211_OK if the appropriate handler found
@@ -239,6 +332,25 @@ jsr211_result jsr211_handler_by_URL(const jchar* caller_id,
                         const jchar* url, const jchar* action, 
                         /*OUT*/ JSR211_RESULT_CH handler);
 
+/**
+ * Searches content handlers using content URL. The suffix is taken from
+ * the last segment of the URL path and may contain several dots, e.g.
+ * <code>.tar.gz</code>. Suffixes are matched case-insensitively starting
+ * from the longest one, so the handlers of the longest matching suffix are
+ * ranked first. Only handlers supporting the action and accessible for the
+ * caller are returned.
+ *
+ * @param caller_id calling application identifier
+ * @param url content URL
+ * @param action requested action, NULL if any action is suitable
+ * @param result output value - the found handlers array.
+ *  <br>Use @link jsr211_appendHandler function to fill this structure.
+ * @return status of the operation
+ */
+jsr211_result jsr211_handlers_by_URL(const jchar* caller_id, 
+                        const jchar* url, const jchar* action, 
+                        /*OUT*/ JSR211_RESULT_CHARRAY result);
+
 /**
  * Returns all found values for specified field. The allowed fields are: <ul>
  *    <li> JSR211_FIELD_ID, <li> JSR211_FIELD_TYPES, <li> JSR211_FIELD_SUFFIXES,
@@ -0,0 +1,141 @@
+/*
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation. 
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt). 
+ * 
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA 
+ * 
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions. 
+ */
+
+/**
+ * @file
+ * @defgroup chapi JSR 211 Content Handler API (CHAPI)
+ * @ingroup msa
+ * @brief Binary image of the registry index.
+ * ##include <jsr211_registry_image.h>
+ * @{
+ * <P>
+ * The image is a compact read-only snapshot of the registry index kept
+ * in the internal storage. It consists of a header and the sections: <UL>
+ *  <LI> the string table - zero terminated UTF-16 strings,
+ *  <LI> the handler records - ID, suite ID, class name and flag,
+ *  <LI> the type, suffix and action sections - distinct values of the
+ *       field with the references to the handler lists,
+ *  <LI> the handler lists - handler record numbers. </UL>
+ * All numbers are 32 bit in the native byte order, the image is versioned
+ * and an image of another version or byte order is ignored.
+ * <P>
+ * At start the image is mapped to memory and the index is loaded from it,
+ * so the backend is not enumerated. The index strings point into the
+ * mapping, the index tables are still built in the heap.
+ * <P>
+ * The image header holds the stamp of the backend content it was written
+ * from, see jsr211_posix_registry_stamp(). Every registry modification is
+ * followed by a delta log entry with the changed handler IDs and the
+ * backend stamps before and after the change; a batch is one entry. The
+ * log is not synced. At start the logged handlers are read from the
+ * backend again while the entries continue the stamp chain from the image,
+ * and the image is trusted only if the chain ends at the current backend
+ * stamp. Otherwise, e.g. after a lost entry or a change made bypassing the
+ * index, the index is rebuilt from the backend.
+ * <P>
+ * The log is merged into the new image by @link jsr211_image_merge when
+ * it grows over a threshold, at idle time or on the registry
+ * finalization. The image is written to a temporary file which then
+ * replaces the previous image, so a crash leaves either of them intact.
+ * <P>
+ * The image is enabled by ENABLE_JSR_211_REGISTRY_IMAGE and requires the
+ * reference registry backend (ENABLE_JSR_211_POSIX_REGISTRY) providing the
+ * stamp. Otherwise the functions of this module do nothing and the index
+ * is built from the backend.
+ */
+
+#ifndef _JSR211_REGISTRY_IMAGE_H_
+#define _JSR211_REGISTRY_IMAGE_H_
+
+#include "jsr211_registry_index.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif/*__cplusplus*/
+
+/**
+ * Loads the index from the registry image. The index MUST be empty.
+ * The image stays mapped until jsr211_image_release(), the index strings
+ * point to it.
+ *
+ * @return JSR211_OK if the image is present, valid and loaded
+ */
+jsr211_result jsr211_image_load(void);
+
+/**
+ * Reads the handlers logged in the delta log from the backend and updates
+ * the loaded index. The log is replayed while its entries continue the
+ * stamp chain from the image, the rest of the log is dropped.
+ *
+ * @return JSR211_OK if the index matches the backend stamp
+ */
+jsr211_result jsr211_image_replay(void);
+
+/**
+ * Appends the handler ID to the delta log. MUST be called after the
+ * handler is changed in the backend. If the ID can't be logged the image
+ * is removed.
+ *
+ * @param id ID of the changed handler
+ */
+void jsr211_image_log(const jchar* id);
+
+/**
+ * Appends the handler IDs to the delta log as a single entry. MUST be
+ * called after the handlers are changed in the backend. If the IDs can't
+ * be logged the image is removed. The image is merged when the log grows
+ * over the threshold.
+ *
+ * @param ids IDs of the changed handlers
+ * @param n number of the IDs
+ */
+void jsr211_image_log_ids(const jchar* const* ids, int n);
+
+/**
+ * Checks whether the delta log has entries not merged into the image.
+ *
+ * @return JSR211_TRUE if the image should be merged
+ */
+jsr211_boolean jsr211_image_pending(void);
+
+/**
+ * Writes the image from the current index and clears the delta log.
+ *
+ * @return JSR211_OK if the image is written
+ */
+jsr211_result jsr211_image_merge(void);
+
+/**
+ * Closes the delta log and unmaps the image. MUST be called after the index
+ * strings pointing to the image are released.
+ */
+void jsr211_image_release(void);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif/*__cplusplus*/
+
+#endif  /* _JSR211_REGISTRY_IMAGE_H_ */
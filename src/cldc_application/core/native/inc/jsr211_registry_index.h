@@ -0,0 +1,352 @@
+/*
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation. 
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt). 
+ * 
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA 
+ * 
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions. 
+ */
+
+/**
+ * @file
+ * @defgroup chapi JSR 211 Content Handler API (CHAPI)
+ * @ingroup msa
+ * @brief In-memory index of the content handler registry.
+ * ##include <jsr211_registry_index.h>
+ * @{
+ * <P>
+ * The index keeps the registration info (ID, suite ID, class name and
+ * flag) of every handler and maps every type, suffix and action value to
+ * the list of handlers registered for it, so that registry queries are
+ * answered without enumeration of the javacall registry backend. The
+ * distinct values of every field are kept together with their reference
+ * counts (the number of handlers declaring the value). Handler
+ * IDs are also kept in the radix trie (see jsr211_id_trie.h) for the ID
+ * conflict and prefix queries.
+ * Types and suffixes are matched case-insensitively, actions are matched
+ * exactly. Every value is folded to its matching key once, when it is
+ * indexed or looked up, so keys are compared by the hash and memcmp.
+ * <P>
+ * The index is built from the backend by @link jsr211_index_build and
+ * then kept current by the registry layer on every registration and
+ * unregistration. When the registry image is present (see
+ * jsr211_registry_image.h) the index is loaded from the image and only
+ * the handlers changed since the image was written are read from the
+ * backend. Handlers registered directly in the backend, bypassing
+ * the registry layer, become visible after the next rebuild.
+ * <P>
+ * Access decisions of the backend are cached per (handler, caller) pair
+ * and dropped together with the handler record when the handler is
+ * registered again or unregistered. For every caller the set of handlers
+ * visible to it is computed once and reused until the index changes.
+ * The cache keeps a bounded number of callers, the least recently used
+ * one is evicted together with its decisions.
+ * <P>
+ * The module also owns the registry scratch arena: a few grow-only jchar
+ * buffers which the backend enumeration loops share between calls, so that
+ * a steady-state query does not allocate heap memory. A buffer is grown
+ * only when the backend reports JAVACALL_CHAPI_ERROR_BUFFER_TOO_SMALL.
+ */
+
+#ifndef _JSR211_REGISTRY_INDEX_H_
+#define _JSR211_REGISTRY_INDEX_H_
+
+#include "jsr211_registry.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif/*__cplusplus*/
+
+/**
+ * Cached access decision, opaque.
+ */
+struct _jsr211_access_decision;
+
+/**
+ * Indexed field value, opaque.
+ */
+struct _jsr211_index_key;
+
+/**
+ * Indexed content handler.
+ */
+typedef struct _jsr211_index_handler {
+    struct _jsr211_index_handler* next;  /**< Next handler in the hash chain */
+    unsigned int            hash;       /**< Hash code of the ID */
+    size_t                  id_len;     /**< Length of the ID in jchars */
+    jchar*                  id;         /**< Zero terminated handler ID */
+    size_t                  suite_id_len;   /**< Length of the suite ID in jchars */
+    jchar*                  suite_id;   /**< Zero terminated suite ID */
+    size_t                  class_name_len; /**< Length of the class name in jchars */
+    jchar*                  class_name; /**< Zero terminated class name */
+    jsr211_register_type    flag;       /**< Registration flag */
+    struct _jsr211_access_decision* access; /**< Cached access decisions */
+    JSR211_RESULT_BUFFER    action_map; /**< Cached action map or NULL */
+    struct _jsr211_index_key** keys;    /**< Values the handler is linked to */
+    int                     key_count;  /**< Number of the linked values */
+    int                     key_capacity;   /**< Capacity of the keys array */
+} jsr211_index_handler;
+
+/**
+ * Position of the indexed handlers enumeration.
+ */
+typedef struct {
+    int                     bucket;     /**< Next hash bucket to scan */
+    jsr211_index_handler*   next;       /**< Next handler to return */
+} jsr211_index_enum;
+
+#define JSR211_INDEX_ENUM_INITIALIZER   { 0, NULL }
+
+/**
+ * Builds the index from the registry backend. The previous index content,
+ * if any, is released.
+ *
+ * @return JSR211_OK if the index has been built successfully
+ */
+jsr211_result jsr211_index_build(void);
+
+/**
+ * Builds the index if it is not valid currently.
+ *
+ * @return JSR211_OK if the index is valid
+ */
+jsr211_result jsr211_index_assure(void);
+
+/**
+ * Releases all memory allocated by the index and marks it invalid.
+ */
+void jsr211_index_release(void);
+
+/**
+ * Adds the handler to the index. If a handler with the same ID is indexed
+ * already it is replaced.
+ *
+ * @param ch registered content handler
+ * @return JSR211_OK if the handler has been indexed, otherwise the index
+ * is released and will be rebuilt on the next query
+ */
+jsr211_result jsr211_index_add(const jsr211_content_handler* ch);
+
+/**
+ * Removes the handler from the index.
+ *
+ * @param id content handler ID
+ */
+void jsr211_index_remove(const jchar* id);
+
+/**
+ * Re-reads the handler from the backend. The handler is removed from the
+ * index and indexed again if it is still registered.
+ *
+ * @param id content handler ID
+ * @return JSR211_OK if the index is current for the handler, otherwise
+ * the index is released
+ */
+jsr211_result jsr211_index_refresh(const jchar* id);
+
+/**
+ * Creates indexed handler record referring to the zero terminated strings,
+ * which MUST stay valid until the index is released. Used to populate the
+ * index from the mapped registry image.
+ *
+ * @return the record or NULL if no memory available
+ */
+jsr211_index_handler* jsr211_index_put(const jchar* id, size_t id_len,
+                    const jchar* suite_id, size_t suite_id_len,
+                    const jchar* class_name, size_t class_name_len,
+                    jsr211_register_type flag);
+
+/**
+ * Adds the handler to the list of the field value. A new value refers to
+ * the string, which MUST stay valid until the index is released. Used to
+ * populate the index from the mapped registry image.
+ *
+ * @param field one of JSR211_FIELD_TYPES, JSR211_FIELD_SUFFIXES or
+ * JSR211_FIELD_ACTIONS
+ * @param value the zero terminated value
+ * @param len the value length in jchars
+ * @param h indexed handler
+ * @return JSR211_OK or JSR211_FAILED if no memory available
+ */
+jsr211_result jsr211_index_link(jsr211_field field, const jchar* value,
+                                    size_t len, jsr211_index_handler* h);
+
+/**
+ * Returns next indexed handler. Enumeration MUST NOT be interleaved with
+ * index modifications.
+ *
+ * @param pos enumeration position initialized with
+ * @link JSR211_INDEX_ENUM_INITIALIZER before the first call
+ * @return next handler or NULL if there are no more handlers
+ */
+jsr211_index_handler* jsr211_index_next(jsr211_index_enum* pos);
+
+/**
+ * Finds indexed handler by ID.
+ *
+ * @param id content handler ID
+ * @return the handler or NULL if it is not registered
+ */
+jsr211_index_handler* jsr211_index_get(const jchar* id);
+
+/**
+ * Looks up handlers registered for the given type, suffix or action.
+ *
+ * @param field one of JSR211_FIELD_TYPES, JSR211_FIELD_SUFFIXES or
+ * JSR211_FIELD_ACTIONS
+ * @param value requested value
+ * @param handlers output value - array of found handlers sorted by ID and
+ * owned by the index. The array is valid until the next index modification.
+ * @return number of found handlers
+ */
+int jsr211_index_lookup(jsr211_field field, const jchar* value,
+                        /*OUT*/ jsr211_index_handler* const** handlers);
+
+/**
+ * Finds the position after the handler ID in the handlers array returned
+ * by @link jsr211_index_lookup. The handler need not be registered.
+ *
+ * @param handlers handlers sorted by ID
+ * @param count number of handlers
+ * @param id handler ID
+ * @return the position of the first handler with a greater ID
+ */
+int jsr211_index_position_after(jsr211_index_handler* const* handlers,
+                                                int count, const jchar* id);
+
+/**
+ * Returns number of distinct values of the field.
+ *
+ * @param field one of JSR211_FIELD_TYPES, JSR211_FIELD_SUFFIXES or
+ * JSR211_FIELD_ACTIONS
+ * @return the number of values
+ */
+int jsr211_index_value_count(jsr211_field field);
+
+/**
+ * Returns distinct value of the field and the handlers declaring it.
+ * Values differing only in case are one value for the case-insensitive
+ * fields, it is returned as it was registered first.
+ *
+ * @param field one of JSR211_FIELD_TYPES, JSR211_FIELD_SUFFIXES or
+ * JSR211_FIELD_ACTIONS
+ * @param i value number, from 0 to @link jsr211_index_value_count - 1
+ * @param value output value - the value owned by the index
+ * @param len output value - the value length in jchars
+ * @param handlers output value - array of handlers declaring the value.
+ * The value and the array are valid until the next index modification.
+ * @return number of handlers declaring the value
+ */
+int jsr211_index_value(jsr211_field field, int i, /*OUT*/ const jchar** value,
+            /*OUT*/ size_t* len, /*OUT*/ jsr211_index_handler* const** handlers);
+
+/**
+ * Checks whether the caller is allowed to access the handler. The backend
+ * decision is cached until the handler is registered again or unregistered.
+ *
+ * @param h indexed handler
+ * @param caller_id calling application identifier, NULL caller is checked
+ * by the backend without caching
+ * @return JSR211_TRUE if the access is allowed
+ */
+jsr211_boolean jsr211_index_access_allowed(jsr211_index_handler* h,
+                                                const jchar* caller_id);
+
+/**
+ * Returns the cached action map of the handler and marks it as the most
+ * recently used one.
+ *
+ * @param h the handler
+ * @return the action map or NULL if it is not cached
+ */
+JSR211_RESULT_BUFFER jsr211_index_action_map(jsr211_index_handler* h);
+
+/**
+ * Caches the action map of the handler, the index takes the map over.
+ * Only a few maps are kept, if the cache is full the least recently used
+ * map is released.
+ *
+ * @param h the handler without cached action map
+ * @param map the action map
+ */
+void jsr211_index_cache_action_map(jsr211_index_handler* h, JSR211_RESULT_BUFFER map);
+
+/**
+ * Returns handlers accessible for the caller. The set is computed once per
+ * caller and reused until the next index modification.
+ *
+ * @param caller_id calling application identifier
+ * @param handlers output value - array of accessible handlers owned by the
+ * index. The array is valid until the next index modification or the
+ * next call with another caller.
+ * @return number of accessible handlers or -1 if no memory available
+ */
+int jsr211_index_visible(const jchar* caller_id,
+                        /*OUT*/ jsr211_index_handler* const** handlers);
+
+/**
+ * Scratch arena buffers. Nested enumeration loops MUST use different
+ * buffers.
+ */
+typedef enum {
+    JSR211_SCRATCH_PRIMARY = 0,     /**< Outer loop buffer */
+    JSR211_SCRATCH_SECONDARY,       /**< Inner loop buffer */
+    JSR211_SCRATCH_TERTIARY,        /**< Innermost loop buffer */
+    JSR211_SCRATCH_KEY,             /**< Folded matching keys of the index */
+    JSR211_SCRATCH_COUNT            /**< Total number of buffers */
+} jsr211_scratch_buffer;
+
+/**
+ * Returns the scratch buffer allocating it if necessary.
+ *
+ * @param buf requested buffer
+ * @param maxlen output value - the buffer capacity in jchars
+ * @return the buffer or NULL if no memory available
+ */
+jchar* jsr211_scratch_get(jsr211_scratch_buffer buf, /*OUT*/ int* maxlen);
+
+/**
+ * Grows the scratch buffer. The buffer content is not preserved.
+ *
+ * @param buf requested buffer
+ * @param len required capacity in jchars
+ * @param maxlen output value - the buffer capacity in jchars
+ * @return the buffer or NULL if no memory available
+ */
+jchar* jsr211_scratch_grow(jsr211_scratch_buffer buf, int len, /*OUT*/ int* maxlen);
+
+/**
+ * Releases all scratch buffers.
+ */
+void jsr211_scratch_release(void);
+
+/**
+ * Returns number of scratch buffer growths since the registry start.
+ * The initial allocation of a buffer is not counted.
+ *
+ * @return the number of growths
+ */
+int jsr211_scratch_growths(void);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif/*__cplusplus*/
+
+#endif  /* _JSR211_REGISTRY_INDEX_H_ */
@@ -38,6 +38,8 @@
 #include <stddef.h>
 #include <kni.h>
 
+#include "jsr211_jchars.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif/*__cplusplus*/
@@ -58,6 +60,17 @@ typedef enum {
   JSR211_TRUE      /**< True value */
 } jsr211_boolean;
 
+/**
+ * Encodings of the content handler record in the result buffer. The
+ * record is the ID, the suite ID, the class name and the registration flag
+ * elements, in this order.
+ */
+typedef enum {
+  JSR211_RECORD_HEX = 0,   /**< Suite ID and flag are hexadecimal strings */
+  JSR211_RECORD_BINARY     /**< Suite ID is two jchars, the high half first,
+                                and the flag is one jchar */
+} jsr211_record_format;
+
 /**
  * Common result buffer for serialized data storage.
  */
@@ -83,6 +96,13 @@ typedef JSR211_RESULT_BUFFER* JSR211_RESULT_STRARRAY;
 
 typedef const void * JSR211_BUFFER_DATA;
 
+/**
+ * The first character of the result passed to Java when the data is
+ * framed with 32-bit lengths (version 2). The version 1 framing with
+ * 16-bit byte lengths never starts with this value as its lengths are even.
+ */
+#define JSR211_RESULT_FRAMING_V2 0xFFFF
+
 /**
  * Creates and initialize new result buffer
  * @return pointer to new result buffer or zero if no memory available
@@ -96,6 +116,31 @@ JSR211_RESULT_BUFFER jsr211_create_result_buffer();
  */
 void jsr211_release_result_buffer(JSR211_RESULT_BUFFER resbuf);
 
+/**
+ * Frees the result buffers kept in the pool for reuse. Called when the
+ * registry is finalized.
+ */
+void jsr211_result_pool_release(void);
+
+/**
+ * Returns number of result buffers reused from the pool since the start.
+ * @return the number of pool hits
+ */
+int jsr211_result_pool_hits(void);
+
+/**
+ * Returns number of result buffers allocated since the start because the
+ * pool was empty.
+ * @return the number of pool misses
+ */
+int jsr211_result_pool_misses(void);
+
+/**
+ * Returns the largest capacity a result buffer has grown to.
+ * @return the capacity in bytes
+ */
+size_t jsr211_result_peak_capacity(void);
+
 /**
  * Retrieve data pointer from result buffer or zero if no result was allocated
  * @param resbuf result handle
@@ -118,6 +163,33 @@ JSR211_BUFFER_DATA jsr211_get_next( JSR211_ENUM_HANDLE * eh );
 
 //---------------------------------------------------------
 
+/**
+ * Folds the string to its matching key. Case-insensitive values are
+ * folded once, when they are registered or passed in as query
+ * parameters, and then matched by the key hash and memcmp.
+ * @param str folded string
+ * @param len the string length in jchars
+ * @param key output buffer for len jchars, may be the same as str
+ */
+void jsr211_fold_string(const jchar* str, size_t len, /*OUT*/ jchar* key);
+
+/**
+ * Computes the hash code of the matching key.
+ * @param key the key
+ * @param len the key length in jchars
+ * @return the hash code
+ */
+unsigned int jsr211_hash_key(const jchar* key, size_t len);
+
+/**
+ * Selects the content handler record encoding. The binary encoding is
+ * used only if the caller supports it, all records are encoded the same
+ * way afterwards.
+ * @param format the most compact encoding supported by the caller
+ * @return the selected encoding
+ */
+jsr211_record_format jsr211_set_record_format(jsr211_record_format format);
+
 /**
  * Appends string to output string array.
  * @param str appended string
@@ -127,6 +199,15 @@ JSR211_BUFFER_DATA jsr211_get_next( JSR211_ENUM_HANDLE * eh );
  */
 jsr211_result jsr211_appendString( const jchar* str, size_t str_size, /*OUT*/ JSR211_RESULT_STRARRAY array);
 
+/**
+ * Appends all strings of the source string array to output string array.
+ * The strings are copied at once, without parsing the source array.
+ * @param src source string array
+ * @param array string array.
+ * @return operation status.
+ */
+jsr211_result jsr211_appendStrings( JSR211_RESULT_BUFFER src, /*OUT*/ JSR211_RESULT_STRARRAY array);
+
 /**
  * Tests if the string is not identical to any of ones included in array.
  * @param str appended string
@@ -29,6 +29,7 @@
  */ 
 
 #include <jsr211_registry.h>
+#include <jsr211_registry_index.h>
 #include <jsrop_memory.h>
 #include <jsrop_suitestore.h>
 
@@ -207,7 +208,11 @@ static jsr211_result installHandler(int n) {
 jsr211_result jsr211_check_internal_handlers(void) {
     int i, found;
     for (i = 0; i < nHandlers; i++) {
-        found = javacall_chapi_is_access_allowed(handlerIds[i], NULL);
+        if (JSR211_OK == jsr211_index_assure()) {
+            found = (jsr211_index_get(handlerIds[i]) != NULL);
+        } else {
+            found = javacall_chapi_is_access_allowed(handlerIds[i], NULL);
+        }
         if (!found) {
             if (JSR211_OK != installHandler(i)) {
                 return JSR211_FAILED;
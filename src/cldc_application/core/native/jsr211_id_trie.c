@@ -0,0 +1,279 @@
+/*
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation. 
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt). 
+ * 
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA 
+ * 
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions. 
+ */
+
+
+/**
+ * @file
+ * @brief Radix trie of the registered content handler IDs.
+ */
+
+#include <string.h>
+
+#include <jsrop_memory.h>
+
+#include "jsr211_id_trie.h"
+
+/**
+ * Trie node. The node label is stored in the same memory block.
+ */
+typedef struct _TRIE_NODE {
+    struct _TRIE_NODE*      sibling;    /* next child of the parent */
+    struct _TRIE_NODE*      child;      /* first child */
+    jsr211_index_handler*   handler;    /* handler whose ID ends here */
+    size_t                  len;        /* label length in jchars */
+    jchar                   label[1];   /* label, not zero terminated */
+} TRIE_NODE;
+
+/** Root node with empty label */
+static TRIE_NODE trie_root;
+
+static TRIE_NODE* new_node(const jchar* label, size_t len) {
+    TRIE_NODE* node = (TRIE_NODE*)JAVAME_MALLOC(sizeof(*node) + len * sizeof(jchar));
+    if (node != NULL) {
+        node->sibling = node->child = NULL;
+        node->handler = NULL;
+        node->len = len;
+        memcpy(node->label, label, len * sizeof(jchar));
+    }
+    return node;
+}
+
+/**
+ * Returns the link to the child starting with the character or the
+ * link terminating the child list if there is no such child.
+ */
+static TRIE_NODE** find_child(TRIE_NODE* node, jchar c) {
+    TRIE_NODE** link = &node->child;
+    while (*link != NULL && (*link)->label[0] != c) {
+        link = &(*link)->sibling;
+    }
+    return link;
+}
+
+static size_t common_prefix(const jchar* s1, size_t len1, const jchar* s2, size_t len2) {
+    size_t k = 0, len = (len1 < len2)? len1: len2;
+    while (k < len && s1[k] == s2[k]) k++;
+    return k;
+}
+
+static void free_nodes(TRIE_NODE* node) {
+    while (node != NULL) {
+        TRIE_NODE* next = node->sibling;
+        free_nodes(node->child);
+        JAVAME_FREE(node);
+        node = next;
+    }
+}
+
+/**
+ * Visits the node and all its descendants.
+ */
+static jsr211_result visit_subtree(TRIE_NODE* node,
+                        jsr211_trie_visitor visitor, void* ctx) {
+    jsr211_result status;
+    if (node->handler != NULL) {
+        if (JSR211_OK != (status = visitor(node->handler, ctx))) return status;
+    }
+    for (node = node->child; node != NULL; node = node->sibling) {
+        if (JSR211_OK != (status = visit_subtree(node, visitor, ctx))) return status;
+    }
+    return JSR211_OK;
+}
+
+/**
+ * Inserts the handler ID into the trie.
+ *
+ * @param h indexed handler
+ * @return JSR211_OK or JSR211_FAILED if no memory available
+ */
+jsr211_result jsr211_trie_insert(jsr211_index_handler* h) {
+    TRIE_NODE* node = &trie_root;
+    const jchar* id = h->id;
+    size_t len = h->id_len;
+
+    while (len > 0) {
+        TRIE_NODE** link = find_child(node, *id);
+        TRIE_NODE* child = *link;
+        size_t k;
+
+        if (child == NULL) {
+            child = new_node(id, len);
+            if (child == NULL) return JSR211_FAILED;
+            *link = child;
+            node = child;
+            break;
+        }
+
+        k = common_prefix(child->label, child->len, id, len);
+        if (k < child->len) {
+            // split the child: its label tail becomes a new node
+            TRIE_NODE* tail = new_node(child->label + k, child->len - k);
+            if (tail == NULL) return JSR211_FAILED;
+            tail->child = child->child;
+            tail->handler = child->handler;
+            child->child = tail;
+            child->handler = NULL;
+            child->len = k;
+        }
+        node = child;
+        id += k;
+        len -= k;
+    }
+
+    node->handler = h;
+    return JSR211_OK;
+}
+
+/**
+ * Removes the ID from the subtree of the linked node. Nodes left without
+ * handler and children are deleted, a node left with the only child is
+ * merged with it.
+ */
+static void remove_at(TRIE_NODE** link, const jchar* id, size_t len) {
+    TRIE_NODE* node = *link;
+
+    if (node->len > len || memcmp(node->label, id, node->len * sizeof(jchar))) return;
+    id += node->len;
+    len -= node->len;
+
+    if (len == 0) {
+        node->handler = NULL;
+    } else {
+        TRIE_NODE** child = find_child(node, *id);
+        if (*child == NULL) return;
+        remove_at(child, id, len);
+    }
+
+    if (node->handler != NULL) return;
+
+    if (node->child == NULL) {
+        *link = node->sibling;
+        JAVAME_FREE(node);
+    } else if (node->child->sibling == NULL) {
+        TRIE_NODE* child = node->child;
+        TRIE_NODE* merged = (TRIE_NODE*)JAVAME_MALLOC(sizeof(*merged) +
+                                    (node->len + child->len) * sizeof(jchar));
+        // the trie stays valid, though not compact, if there is no memory
+        if (merged != NULL) {
+            memcpy(merged->label, node->label, node->len * sizeof(jchar));
+            memcpy(merged->label + node->len, child->label, child->len * sizeof(jchar));
+            merged->len = node->len + child->len;
+            merged->handler = child->handler;
+            merged->child = child->child;
+            merged->sibling = node->sibling;
+            *link = merged;
+            JAVAME_FREE(child);
+            JAVAME_FREE(node);
+        }
+    }
+}
+
+/**
+ * Removes the handler ID from the trie.
+ *
+ * @param id handler ID
+ * @param len ID length in jchars
+ */
+void jsr211_trie_remove(const jchar* id, size_t len) {
+    TRIE_NODE** link;
+    if (len == 0) return;
+    link = find_child(&trie_root, *id);
+    if (*link != NULL) {
+        remove_at(link, id, len);
+    }
+}
+
+/**
+ * Removes all IDs from the trie and releases its memory.
+ */
+void jsr211_trie_release(void) {
+    free_nodes(trie_root.child);
+    trie_root.child = NULL;
+}
+
+/**
+ * Visits all handlers conflicting with the ID, i.e. the handlers whose
+ * IDs are prefixes of the ID, equal to it or start with it.
+ *
+ * @param id tested ID
+ * @param len ID length in jchars
+ * @param visitor callback called for each conflicting handler
+ * @param ctx visitor context
+ * @return JSR211_OK or the first failed visitor status
+ */
+jsr211_result jsr211_trie_conflicts(const jchar* id, size_t len,
+                        jsr211_trie_visitor visitor, void* ctx) {
+    TRIE_NODE* node = &trie_root;
+    jsr211_result status;
+
+    while (len > 0) {
+        TRIE_NODE* child;
+        size_t k;
+
+        // IDs ending above are prefixes of the tested one
+        if (node->handler != NULL) {
+            if (JSR211_OK != (status = visitor(node->handler, ctx))) return status;
+        }
+
+        child = *find_child(node, *id);
+        if (child == NULL) return JSR211_OK;
+
+        k = common_prefix(child->label, child->len, id, len);
+        if (k == len) {
+            // all IDs below start with the tested one
+            return visit_subtree(child, visitor, ctx);
+        }
+        if (k < child->len) return JSR211_OK;
+
+        node = child;
+        id += k;
+        len -= k;
+    }
+
+    return visit_subtree(node, visitor, ctx);
+}
+
+/**
+ * Finds the handler with the longest ID being a prefix of the given ID.
+ *
+ * @param id requested ID
+ * @param len ID length in jchars
+ * @return found handler or NULL
+ */
+jsr211_index_handler* jsr211_trie_prefix_of(const jchar* id, size_t len) {
+    TRIE_NODE* node = &trie_root;
+    jsr211_index_handler* found = NULL;
+
+    while (1) {
+        if (node->handler != NULL) found = node->handler;
+        if (len == 0) break;
+
+        node = *find_child(node, *id);
+        if (node == NULL || node->len > len ||
+                memcmp(node->label, id, node->len * sizeof(jchar))) break;
+        id += node->len;
+        len -= node->len;
+    }
+    return found;
+}
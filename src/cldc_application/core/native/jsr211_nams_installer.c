@@ -565,28 +565,34 @@ int jsr211_verify_handlers(MidpProperties jadsmp, MidpProperties mfsmp,
 
 /**
  * Stores installing Content Handlers in the JSR211 complaint registry.
+ * The handlers are stored all or none.
  * @param suiteId installing suite Id
- * @return 0 if handlers are stored successfully.
+ * @return 0 if handlers are stored successfully, -1 if none is stored.
  */
 int jsr211_store_handlers(SuiteIdType suiteId) {
     int n = nHandlers;
     jsr211_content_handler *ptr = handlers;
+    int res = 0;
 
     while (n > 0) {
         ptr->suite_id = JAVAME_MALLOC((jsrop_suiteid_string_size(suiteId) + 1) * sizeof(jchar));
-        if( !jsrop_suiteid_to_string(suiteId, (jchar *)ptr->suite_id) )
-            return -1;
-
-        if (JSR211_OK != jsr211_register_handler(ptr)) {
-            n = 0;
+        if (ptr->suite_id == NULL ||
+                !jsrop_suiteid_to_string(suiteId, (jchar *)ptr->suite_id)) {
+            res = -1;
+            break;
         }
         ptr++;
         n--;
     }
+
+    // the suite handlers are registered all or none
+    if (res == 0 && JSR211_OK != jsr211_register_handlers_batch(handlers, nHandlers)) {
+        res = -1;
+    }
     jsr211_finalize();
     cleanup();
 
-    return n;
+    return res;
 }
 
 /**
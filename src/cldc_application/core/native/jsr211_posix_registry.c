@@ -0,0 +1,950 @@
+/*
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation. 
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt). 
+ * 
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA 
+ * 
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions. 
+ */
+
+
+/**
+ * @file
+ * @brief Reference implementation of the javacall CHAPI registry based
+ * on POSIX file calls.
+ * <P>
+ * Handlers are kept in memory and every modification is appended to the
+ * journal file in the internal storage. A journal record is a header
+ * (signature, record type, payload size and checksum) followed by the
+ * payload: the handler ID for an unregistration, the whole handler for a
+ * registration. At start the journal is replayed; a damaged tail, left by
+ * a crash during an append, is cut off. The journal is fsync'ed every
+ * JOURNAL_SYNC_BATCH records and on finalization, so a crash loses at most
+ * the last batch but never leaves the registry inconsistent. The registry
+ * layer may defer the sync to the end of its own batch, see
+ * jsr211_posix_registry.h. When most
+ * of the journal is taken by superseded records it is compacted: the live
+ * handlers are written to a new journal which replaces the old one.
+ * <P>
+ * The in-memory registry consists of the hash table of handlers by ID and
+ * the handler array used for enumeration.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <jsrop_memory.h>
+#include <midpStorage.h>
+
+#include "javacall_chapi_registry.h"
+#include "jsr211_posix_registry.h"
+
+/** Journal file names in the internal storage */
+#define JOURNAL_FILE        "_chapi_journal.dat"
+#define JOURNAL_TEMP_FILE   "_chapi_journal.tmp"
+
+/** Record signature, 'CHJR' */
+#define JOURNAL_MAGIC       0x43484A52
+
+/** Number of appended records between fsync calls */
+#define JOURNAL_SYNC_BATCH  16
+
+/** Minimal journal size to be compacted, in bytes */
+#define JOURNAL_COMPACT_MIN 0x4000
+
+/** Number of hash buckets, MUST be a power of two */
+#define REG_HASH_SIZE       0x100
+
+/** Bucket number for the hash code */
+#define REG_BUCKET(hash)    ((hash) & (REG_HASH_SIZE - 1))
+
+/**
+ * Journal record types.
+ */
+typedef enum {
+    RECORD_REGISTER = 1,    /* payload is the handler */
+    RECORD_UNREGISTER = 2   /* payload is the handler ID */
+} RECORD_TYPE;
+
+/**
+ * Journal record header.
+ */
+typedef struct {
+    unsigned int            magic;      /* JOURNAL_MAGIC */
+    unsigned int            type;       /* RECORD_TYPE */
+    unsigned int            size;       /* payload size in bytes */
+    unsigned int            checksum;   /* payload checksum */
+} RECORD_HEADER;
+
+/**
+ * Handler strings.
+ */
+typedef enum {
+    STR_ID = 0,
+    STR_APPNAME,
+    STR_SUITE_ID,
+    STR_CLASS_NAME,
+    STR_COUNT
+} HANDLER_STRING;
+
+/**
+ * Handler string lists.
+ */
+typedef enum {
+    LIST_TYPES = 0,
+    LIST_SUFFIXES,
+    LIST_ACTIONS,
+    LIST_LOCALES,
+    LIST_ACTION_NAMES,
+    LIST_ACCESSES,
+    LIST_COUNT
+} HANDLER_LIST;
+
+/**
+ * Registered handler. All strings are kept in the single memory block
+ * with the record.
+ */
+typedef struct _REG_HANDLER {
+    struct _REG_HANDLER*    next;       /* next handler in the hash chain */
+    unsigned int            hash;       /* hash code of the ID */
+    int                     slot;       /* position in the handler array */
+    unsigned int            record;     /* size of its journal record */
+    unsigned int            digest;     /* checksum of its journal record */
+    javacall_chapi_handler_registration_type flag;
+    javacall_utf16*         str[STR_COUNT];
+    int                     count[LIST_COUNT];
+    javacall_utf16**        list[LIST_COUNT];
+} REG_HANDLER;
+
+static REG_HANDLER* reg_hash[REG_HASH_SIZE];
+static REG_HANDLER** reg_handlers = NULL;
+static int reg_count = 0;
+static int reg_capacity = 0;
+
+/** Journal file descriptor, -1 if the registry is not loaded */
+static int journal = -1;
+
+/** Journal size and the size of its live records */
+static unsigned int journal_size = 0;
+static unsigned int live_size = 0;
+
+/** Records appended since the last fsync */
+static int unsynced = 0;
+
+/** Whether the fsync is deferred by the registry layer */
+static int sync_deferred = 0;
+
+/** Content stamp, the digests of the live handlers combined */
+static unsigned int registry_stamp = 0;
+
+/**
+ * Returns the full path of the file in the internal storage.
+ * The path MUST be released with JAVAME_FREE.
+ */
+static char* storage_path(const char* name) {
+    const pcsl_string* root = storage_get_root(INTERNAL_STORAGE_ID);
+    jint root_len = pcsl_string_utf8_length(root);
+    jint converted;
+    char* path;
+
+    if (root_len < 0) return NULL;
+    path = (char*)JAVAME_MALLOC(root_len + strlen(name) + 1);
+    if (path != NULL) {
+        if (PCSL_STRING_OK != pcsl_string_convert_to_utf8(root,
+                                (jbyte*)path, root_len + 1, &converted)) {
+            JAVAME_FREE(path);
+            return NULL;
+        }
+        strcpy(path + converted, name);
+    }
+    return path;
+}
+
+static size_t utf16_len(javacall_const_utf16_string str) {
+    size_t len = 0;
+    while (str[len]) len++;
+    return len;
+}
+
+static unsigned int hash_id(javacall_const_utf16_string id) {
+    unsigned int hash = 0;
+    while (*id) hash = 31 * hash + *id++;
+    return hash;
+}
+
+static unsigned int checksum(const char* data, size_t size) {
+    unsigned int sum = 2166136261u;
+    while (size--) {
+        sum = (sum ^ (unsigned char)*data++) * 16777619u;
+    }
+    return sum;
+}
+
+static int write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n <= 0) return 0;
+        data += n;
+        size -= n;
+    }
+    return 1;
+}
+
+/**
+ * Finds the handler and returns the address of the link pointing to it.
+ */
+static REG_HANDLER** find_link(javacall_const_utf16_string id) {
+    unsigned int hash = hash_id(id);
+    REG_HANDLER** ph = &reg_hash[REG_BUCKET(hash)];
+    for (; *ph != NULL; ph = &(*ph)->next) {
+        const javacall_utf16* s1 = (*ph)->str[STR_ID];
+        const javacall_utf16* s2 = id;
+        if ((*ph)->hash != hash) continue;
+        while (*s1 && *s1 == *s2) {
+            s1++;
+            s2++;
+        }
+        if (*s1 == *s2) break;
+    }
+    return ph;
+}
+
+static REG_HANDLER* find_handler(javacall_const_utf16_string id) {
+    return (id != NULL)? *find_link(id): NULL;
+}
+
+/**
+ * Removes the handler from the registry and releases it.
+ */
+static void remove_handler(REG_HANDLER** link) {
+    REG_HANDLER* h = *link;
+    REG_HANDLER* last = reg_handlers[--reg_count];
+
+    *link = h->next;
+    reg_handlers[h->slot] = last;
+    last->slot = h->slot;
+    live_size -= h->record;
+    registry_stamp ^= h->digest;
+    JAVAME_FREE(h);
+}
+
+/**
+ * Adds the handler to the registry replacing the handler with the same ID.
+ */
+static javacall_result add_handler(REG_HANDLER* h) {
+    REG_HANDLER** link;
+
+    // grow first, so a failure leaves the replaced handler in place
+    if (reg_count == reg_capacity) {
+        int capacity = reg_capacity? 2 * reg_capacity: 32;
+        REG_HANDLER** tmp = (REG_HANDLER**)JAVAME_REALLOC(reg_handlers,
+                                                capacity * sizeof(*tmp));
+        if (tmp == NULL) return JAVACALL_CHAPI_ERROR_NO_MEMORY;
+        reg_handlers = tmp;
+        reg_capacity = capacity;
+    }
+    link = find_link(h->str[STR_ID]);
+    if (*link != NULL) {
+        remove_handler(link);
+        link = find_link(h->str[STR_ID]);
+    }
+    h->hash = hash_id(h->str[STR_ID]);
+    h->next = *link;
+    *link = h;
+    h->slot = reg_count;
+    reg_handlers[reg_count++] = h;
+    live_size += h->record;
+    registry_stamp ^= h->digest;
+    return JAVACALL_OK;
+}
+
+/**
+ * Payload writer. If the buffer is NULL only the size is counted.
+ */
+typedef struct {
+    char*                   data;
+    size_t                  size;
+} PAYLOAD;
+
+static void put_word(PAYLOAD* p, unsigned int w) {
+    if (p->data != NULL) memcpy(p->data + p->size, &w, sizeof(w));
+    p->size += sizeof(w);
+}
+
+/**
+ * Puts the string: the length in jchars, the characters and the padding
+ * to the word boundary.
+ */
+static void put_string(PAYLOAD* p, javacall_const_utf16_string str) {
+    size_t len = (str != NULL)? utf16_len(str): 0;
+    put_word(p, len);
+    if (p->data != NULL) {
+        memset(p->data + p->size, 0, (len * sizeof(javacall_utf16) + 3) & ~3);
+        memcpy(p->data + p->size, str, len * sizeof(javacall_utf16));
+    }
+    p->size += (len * sizeof(javacall_utf16) + 3) & ~3;
+}
+
+static void put_list(PAYLOAD* p, javacall_const_utf16_string* list, int n) {
+    int i;
+    put_word(p, n);
+    for (i = 0; i < n; i++) {
+        put_string(p, list[i]);
+    }
+}
+
+/**
+ * Payload reader.
+ */
+typedef struct {
+    const char*             data;
+    size_t                  size;
+    size_t                  pos;
+} READER;
+
+static int get_word(READER* r, unsigned int* w) {
+    if (r->size - r->pos < sizeof(*w)) return 0;
+    memcpy(w, r->data + r->pos, sizeof(*w));
+    r->pos += sizeof(*w);
+    return 1;
+}
+
+/**
+ * Reads the string. If the destination is not NULL the string is copied
+ * and terminated with zero.
+ */
+static int get_string(READER* r, javacall_utf16* dst, unsigned int* len) {
+    size_t size;
+    if (!get_word(r, len) || *len > (r->size - r->pos) / sizeof(javacall_utf16)) {
+        return 0;
+    }
+    size = (*len * sizeof(javacall_utf16) + 3) & ~3;
+    if (size > r->size - r->pos) return 0;
+    if (dst != NULL) {
+        memcpy(dst, r->data + r->pos, *len * sizeof(javacall_utf16));
+        dst[*len] = 0;
+    }
+    r->pos += size;
+    return 1;
+}
+
+/**
+ * Creates the handler from the registration payload. The payload is
+ * parsed twice: to check it and count the memory, then to fill the record.
+ *
+ * @param handler receives the created handler
+ * @return JAVACALL_OK if the handler is created,
+ *         JAVACALL_FAIL if the payload is malformed,
+ *         JAVACALL_CHAPI_ERROR_NO_MEMORY if the handler can't be allocated
+ */
+static javacall_result parse_handler(const char* data, size_t size,
+                                     REG_HANDLER** handler) {
+    READER r;
+    REG_HANDLER* h = NULL;
+    javacall_utf16** strings = NULL;
+    javacall_utf16* chars = NULL;
+    unsigned int flag, n, len;
+    size_t nstrings = 0, nchars = 0;
+    int pass, i, l;
+
+    for (pass = 0; pass < 2; pass++) {
+        r.data = data;
+        r.size = size;
+        r.pos = 0;
+        if (!get_word(&r, &flag)) return JAVACALL_FAIL;
+        for (i = 0; i < STR_COUNT; i++) {
+            if (!get_string(&r, chars, &len)) return JAVACALL_FAIL;
+            if (h != NULL) {
+                h->str[i] = chars;
+                chars += len + 1;
+            }
+            nchars += len + 1;
+        }
+        for (l = 0; l < LIST_COUNT; l++) {
+            if (!get_word(&r, &n) || n > size) return JAVACALL_FAIL;
+            if (h != NULL) {
+                h->count[l] = n;
+                h->list[l] = strings;
+            }
+            for (; n > 0; n--) {
+                if (!get_string(&r, chars, &len)) return JAVACALL_FAIL;
+                if (h != NULL) {
+                    *strings++ = chars;
+                    chars += len + 1;
+                }
+                nchars += len + 1;
+                nstrings++;
+            }
+        }
+        if (r.pos != size) return JAVACALL_FAIL;
+
+        if (h == NULL) {
+            h = (REG_HANDLER*)JAVAME_MALLOC(sizeof(*h) +
+                    nstrings * sizeof(javacall_utf16*) + nchars * sizeof(javacall_utf16));
+            if (h == NULL) return JAVACALL_CHAPI_ERROR_NO_MEMORY;
+            memset(h, 0, sizeof(*h));
+            h->flag = (javacall_chapi_handler_registration_type)flag;
+            h->record = sizeof(RECORD_HEADER) + size;
+            h->digest = checksum(data, size);
+            strings = (javacall_utf16**)(h + 1);
+            chars = (javacall_utf16*)(strings + nstrings);
+        }
+    }
+    *handler = h;
+    return JAVACALL_OK;
+}
+
+/**
+ * Applies the journal record to the in-memory registry.
+ */
+static javacall_result apply_record(unsigned int type, const char* payload, size_t size) {
+    if (type == RECORD_REGISTER) {
+        REG_HANDLER* h;
+        javacall_result res = parse_handler(payload, size, &h);
+        if (res != JAVACALL_OK) return res;
+        res = add_handler(h);
+        if (res != JAVACALL_OK) JAVAME_FREE(h);
+        return res;
+    }
+    if (type == RECORD_UNREGISTER) {
+        javacall_utf16 id[64];
+        javacall_utf16* buf = id;
+        READER r;
+        unsigned int len;
+        REG_HANDLER** link;
+
+        r.data = payload;
+        r.size = size;
+        r.pos = 0;
+        if (!get_word(&r, &len)) return JAVACALL_FAIL;
+        if (len >= sizeof(id) / sizeof(id[0])) {
+            buf = (javacall_utf16*)JAVAME_MALLOC((len + 1) * sizeof(javacall_utf16));
+            if (buf == NULL) return JAVACALL_CHAPI_ERROR_NO_MEMORY;
+        }
+        r.pos = 0;
+        if (get_string(&r, buf, &len) && r.pos == size) {
+            link = find_link(buf);
+            if (*link != NULL) remove_handler(link);
+        }
+        if (buf != id) JAVAME_FREE(buf);
+        return JAVACALL_OK;
+    }
+    return JAVACALL_FAIL;
+}
+
+/**
+ * Writes the record to the journal.
+ */
+static int write_record(int fd, unsigned int type, const char* payload, size_t size) {
+    RECORD_HEADER hdr;
+    hdr.magic = JOURNAL_MAGIC;
+    hdr.type = type;
+    hdr.size = size;
+    hdr.checksum = checksum(payload, size);
+    return write_all(fd, (const char*)&hdr, sizeof(hdr)) && write_all(fd, payload, size);
+}
+
+/**
+ * Serializes the registration payload of the handler.
+ */
+static int serialize_handler(const REG_HANDLER* h, PAYLOAD* p) {
+    int l;
+    put_word(p, h->flag);
+    for (l = 0; l < STR_COUNT; l++) {
+        put_string(p, h->str[l]);
+    }
+    for (l = 0; l < LIST_COUNT; l++) {
+        put_list(p, (javacall_const_utf16_string*)h->list[l], h->count[l]);
+    }
+    return 1;
+}
+
+/**
+ * Synchronizes the internal storage directory, so a renamed journal
+ * survives a crash.
+ */
+static void sync_storage_dir(void) {
+    char* dir = storage_path("");
+    int fd;
+
+    if (dir == NULL) return;
+    fd = open(dir, O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    JAVAME_FREE(dir);
+}
+
+/**
+ * Rewrites the journal with the live handlers only. The new journal is
+ * opened before it replaces the old one, so the registry never keeps
+ * appending to an unlinked file.
+ */
+static void compact_journal(void) {
+    char* temp = storage_path(JOURNAL_TEMP_FILE);
+    char* path = storage_path(JOURNAL_FILE);
+    char* buffer = NULL;
+    size_t capacity = 0;
+    unsigned int size = 0;
+    int fd = -1, ok = 0, i;
+
+    if (temp != NULL && path != NULL) {
+        fd = open(temp, O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0600);
+    }
+    if (fd >= 0) {
+        ok = 1;
+        for (i = 0; ok && i < reg_count; i++) {
+            PAYLOAD p;
+            p.data = NULL;
+            p.size = 0;
+            serialize_handler(reg_handlers[i], &p);
+            if (p.size > capacity) {
+                char* tmp = (char*)JAVAME_REALLOC(buffer, p.size);
+                if (tmp == NULL) {
+                    ok = 0;
+                    break;
+                }
+                buffer = tmp;
+                capacity = p.size;
+            }
+            p.data = buffer;
+            p.size = 0;
+            serialize_handler(reg_handlers[i], &p);
+            ok = write_record(fd, RECORD_REGISTER, p.data, p.size);
+            size += sizeof(RECORD_HEADER) + p.size;
+        }
+        ok = ok && fsync(fd) == 0;
+        // the descriptor follows the file through the rename
+        ok = ok && rename(temp, path) == 0;
+        if (!ok) {
+            close(fd);
+            unlink(temp);
+        }
+    }
+
+    if (ok) {
+        sync_storage_dir();
+        close(journal);
+        journal = fd;
+        journal_size = live_size = size;
+        unsynced = 0;
+    }
+
+    if (buffer != NULL) JAVAME_FREE(buffer);
+    if (temp != NULL) JAVAME_FREE(temp);
+    if (path != NULL) JAVAME_FREE(path);
+}
+
+/**
+ * Cuts the journal back to the size, dropping the bytes of a failed or
+ * undone append. Otherwise the following records would be appended after
+ * them and lost with them when the damaged tail is cut off at start.
+ */
+static void truncate_journal(unsigned int size) {
+    if (ftruncate(journal, size) == 0) {
+        journal_size = size;
+    }
+}
+
+/**
+ * Appends the record to the journal. The journal is synchronized every
+ * JOURNAL_SYNC_BATCH records and compacted when superseded records take
+ * more than a half of it.
+ */
+static javacall_result append_record(unsigned int type, const char* payload, size_t size) {
+    if (!write_record(journal, type, payload, size)) {
+        truncate_journal(journal_size);
+        return JAVACALL_FAIL;
+    }
+    journal_size += sizeof(RECORD_HEADER) + size;
+    if (++unsynced >= JOURNAL_SYNC_BATCH && !sync_deferred) {
+        fsync(journal);
+        unsynced = 0;
+    }
+    return JAVACALL_OK;
+}
+
+void jsr211_posix_registry_defer_sync(void) {
+    sync_deferred = 1;
+}
+
+javacall_result jsr211_posix_registry_sync(void) {
+    sync_deferred = 0;
+    if (unsynced > 0 && journal >= 0) {
+        if (fsync(journal) != 0) return JAVACALL_FAIL;
+        unsynced = 0;
+    }
+    return JAVACALL_OK;
+}
+
+static void compact_if_needed(void) {
+    if (journal_size >= JOURNAL_COMPACT_MIN && journal_size > 2 * live_size) {
+        compact_journal();
+    }
+}
+
+/**
+ * Reads the journal and replays its records. The damaged tail is cut off.
+ */
+static javacall_result replay_journal(int fd) {
+    struct stat st;
+    char* data;
+    size_t pos = 0;
+    javacall_result res = JAVACALL_OK;
+
+    if (fstat(fd, &st) != 0) return JAVACALL_FAIL;
+    if (st.st_size == 0) return JAVACALL_OK;
+
+    data = (char*)JAVAME_MALLOC(st.st_size);
+    if (data == NULL) return JAVACALL_CHAPI_ERROR_NO_MEMORY;
+    if (pread(fd, data, st.st_size, 0) != st.st_size) {
+        JAVAME_FREE(data);
+        return JAVACALL_FAIL;
+    }
+
+    while (res == JAVACALL_OK && st.st_size - pos >= sizeof(RECORD_HEADER)) {
+        RECORD_HEADER hdr;
+        memcpy(&hdr, data + pos, sizeof(hdr));
+        if (hdr.magic != JOURNAL_MAGIC ||
+                hdr.size > st.st_size - pos - sizeof(hdr) ||
+                hdr.checksum != checksum(data + pos + sizeof(hdr), hdr.size)) {
+            break;
+        }
+        res = apply_record(hdr.type, data + pos + sizeof(hdr), hdr.size);
+        if (res == JAVACALL_FAIL) break; // unknown or malformed record, treated as the damaged tail
+        pos += sizeof(hdr) + hdr.size;
+    }
+    JAVAME_FREE(data);
+
+    if (res == JAVACALL_CHAPI_ERROR_NO_MEMORY) return res;
+    if (pos < (size_t)st.st_size) {
+        // the record was being written when the device went down
+        if (ftruncate(fd, pos) != 0) return JAVACALL_FAIL;
+    }
+    journal_size = pos;
+    return JAVACALL_OK;
+}
+
+static void release_registry(void) {
+    int i;
+    for (i = 0; i < reg_count; i++) {
+        JAVAME_FREE(reg_handlers[i]);
+    }
+    if (reg_handlers != NULL) JAVAME_FREE(reg_handlers);
+    reg_handlers = NULL;
+    reg_count = reg_capacity = 0;
+    memset(reg_hash, 0, sizeof(reg_hash));
+    journal_size = live_size = 0;
+    registry_stamp = 0;
+}
+
+/**
+ * Loads the registry on the first use after the initialization or the
+ * finalization.
+ */
+static javacall_result assure_loaded(void) {
+    return (journal >= 0)? JAVACALL_OK: javacall_chapi_init_registry();
+}
+
+unsigned int jsr211_posix_registry_stamp(void) {
+    assure_loaded();
+    return registry_stamp ^ (reg_count * 0x9E3779B9u);
+}
+
+/**
+ * Copies the string to the output buffer.
+ */
+static javacall_result copy_out(javacall_const_utf16_string str,
+                                javacall_utf16* out, int* length) {
+    int len = utf16_len(str) + 1;
+    if (*length < len) {
+        *length = len;
+        return JAVACALL_CHAPI_ERROR_BUFFER_TOO_SMALL;
+    }
+    memcpy(out, str, len * sizeof(javacall_utf16));
+    *length = len;
+    return JAVACALL_OK;
+}
+
+/**
+ * Enumerates the string list of the handler.
+ */
+static javacall_result enum_list(javacall_const_utf16_string id, HANDLER_LIST l,
+                        int* pos_id, javacall_utf16* out, int* length) {
+    REG_HANDLER* h;
+    javacall_result res;
+
+    if (JAVACALL_OK != assure_loaded()) return JAVACALL_FAIL;
+    h = find_handler(id);
+    if (h == NULL) return JAVACALL_FAIL;
+    if (*pos_id >= h->count[l]) return JAVACALL_CHAPI_ERROR_NO_MORE_ELEMENTS;
+    res = copy_out(h->list[l][*pos_id], out, length);
+    if (res == JAVACALL_OK) (*pos_id)++;
+    return res;
+}
+
+static int find_string(javacall_utf16** list, int n, javacall_const_utf16_string str) {
+    int i;
+    for (i = 0; i < n; i++) {
+        const javacall_utf16* s1 = list[i];
+        const javacall_utf16* s2 = str;
+        while (*s1 && *s1 == *s2) {
+            s1++;
+            s2++;
+        }
+        if (*s1 == *s2) return i;
+    }
+    return -1;
+}
+
+javacall_result javacall_chapi_init_registry(void) {
+    char* path;
+    int fd;
+    javacall_result res;
+
+    if (journal >= 0) return JAVACALL_OK;
+
+    path = storage_path(JOURNAL_FILE);
+    if (path == NULL) return JAVACALL_CHAPI_ERROR_NO_MEMORY;
+    fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0600);
+    JAVAME_FREE(path);
+    if (fd < 0) return JAVACALL_FAIL;
+
+    res = replay_journal(fd);
+    if (res != JAVACALL_OK) {
+        release_registry();
+        close(fd);
+        return res;
+    }
+    journal = fd;
+    unsynced = 0;
+    compact_if_needed();
+    return JAVACALL_OK;
+}
+
+void javacall_chapi_finalize_registry(void) {
+    if (journal < 0) return;
+    compact_if_needed();
+    fsync(journal);
+    sync_deferred = 0;
+    close(journal);
+    journal = -1;
+    release_registry();
+}
+
+javacall_result javacall_chapi_register_handler(
+        javacall_const_utf16_string content_handler_id,
+        javacall_const_utf16_string content_handler_friendly_appname,
+        javacall_const_utf16_string suite_id,
+        javacall_const_utf16_string class_name,
+        javacall_chapi_handler_registration_type flag,
+        javacall_const_utf16_string* content_types, int nTypes,
+        javacall_const_utf16_string* suffixes, int nSuffixes,
+        javacall_const_utf16_string* actions, int nActions,
+        javacall_const_utf16_string* locales, int nLocales,
+        javacall_const_utf16_string* action_names, int nActionNames,
+        javacall_const_utf16_string* access_allowed_ids, int nAccesses) {
+    PAYLOAD p;
+    REG_HANDLER* h;
+    javacall_result res;
+    int pass;
+
+    if (content_handler_id == NULL || *content_handler_id == 0) return JAVACALL_FAIL;
+    if (JAVACALL_OK != assure_loaded()) return JAVACALL_FAIL;
+
+    p.data = NULL;
+    for (pass = 0; pass < 2; pass++) {
+        p.size = 0;
+        put_word(&p, flag);
+        put_string(&p, content_handler_id);
+        put_string(&p, content_handler_friendly_appname);
+        put_string(&p, suite_id);
+        put_string(&p, class_name);
+        put_list(&p, content_types, nTypes);
+        put_list(&p, suffixes, nSuffixes);
+        put_list(&p, actions, nActions);
+        put_list(&p, locales, nLocales);
+        put_list(&p, action_names, nActionNames);
+        put_list(&p, access_allowed_ids, nAccesses);
+        if (p.data == NULL) {
+            p.data = (char*)JAVAME_MALLOC(p.size);
+            if (p.data == NULL) return JAVACALL_CHAPI_ERROR_NO_MEMORY;
+        }
+    }
+
+    // the record is parsed back, so the journal and the memory can't differ
+    res = parse_handler(p.data, p.size, &h);
+    if (res == JAVACALL_OK) {
+        unsigned int size = journal_size;
+        res = append_record(RECORD_REGISTER, p.data, p.size);
+        if (res == JAVACALL_OK) {
+            res = add_handler(h);
+            // the handler is not in memory, so it must not be replayed
+            if (res != JAVACALL_OK) truncate_journal(size);
+        }
+        if (res != JAVACALL_OK) JAVAME_FREE(h);
+    }
+    JAVAME_FREE(p.data);
+
+    if (res == JAVACALL_OK) compact_if_needed();
+    return res;
+}
+
+javacall_result javacall_chapi_unregister_handler(
+        javacall_const_utf16_string content_handler_id) {
+    REG_HANDLER** link;
+    PAYLOAD p;
+    javacall_result res;
+
+    if (JAVACALL_OK != assure_loaded()) return JAVACALL_FAIL;
+    link = find_link(content_handler_id);
+    if (*link == NULL) return JAVACALL_FAIL;
+
+    p.data = NULL;
+    p.size = 0;
+    put_string(&p, content_handler_id);
+    p.data = (char*)JAVAME_MALLOC(p.size);
+    if (p.data == NULL) return JAVACALL_CHAPI_ERROR_NO_MEMORY;
+    p.size = 0;
+    put_string(&p, content_handler_id);
+
+    res = append_record(RECORD_UNREGISTER, p.data, p.size);
+    JAVAME_FREE(p.data);
+    if (res == JAVACALL_OK) {
+        remove_handler(link);
+        compact_if_needed();
+    }
+    return res;
+}
+
+javacall_result javacall_chapi_enum_handlers(int* pos_id,
+                        /*OUT*/ javacall_utf16* handler_id_out, int* length) {
+    javacall_result res;
+
+    if (JAVACALL_OK != assure_loaded()) return JAVACALL_FAIL;
+    if (*pos_id >= reg_count) return JAVACALL_CHAPI_ERROR_NO_MORE_ELEMENTS;
+    res = copy_out(reg_handlers[*pos_id]->str[STR_ID], handler_id_out, length);
+    if (res == JAVACALL_OK) (*pos_id)++;
+    return res;
+}
+
+javacall_result javacall_chapi_enum_types(javacall_const_utf16_string content_handler_id,
+                        int* pos_id, /*OUT*/ javacall_utf16* type_out, int* length) {
+    return enum_list(content_handler_id, LIST_TYPES, pos_id, type_out, length);
+}
+
+javacall_result javacall_chapi_enum_suffixes(javacall_const_utf16_string content_handler_id,
+                        int* pos_id, /*OUT*/ javacall_utf16* suffix_out, int* length) {
+    return enum_list(content_handler_id, LIST_SUFFIXES, pos_id, suffix_out, length);
+}
+
+javacall_result javacall_chapi_enum_actions(javacall_const_utf16_string content_handler_id,
+                        int* pos_id, /*OUT*/ javacall_utf16* action_out, int* length) {
+    return enum_list(content_handler_id, LIST_ACTIONS, pos_id, action_out, length);
+}
+
+javacall_result javacall_chapi_enum_action_locales(javacall_const_utf16_string content_handler_id,
+                        int* pos_id, /*OUT*/ javacall_utf16* locale_out, int* length) {
+    return enum_list(content_handler_id, LIST_LOCALES, pos_id, locale_out, length);
+}
+
+javacall_result javacall_chapi_enum_access_allowed_callers(
+                        javacall_const_utf16_string content_handler_id,
+                        int* pos_id, /*OUT*/ javacall_utf16* access_allowed_out, int* length) {
+    return enum_list(content_handler_id, LIST_ACCESSES, pos_id, access_allowed_out, length);
+}
+
+javacall_result javacall_chapi_get_local_action_name(
+                        javacall_const_utf16_string content_handler_id,
+                        javacall_const_utf16_string action,
+                        javacall_const_utf16_string locale,
+                        /*OUT*/ javacall_utf16* local_action_out, int* length) {
+    REG_HANDLER* h;
+    int a, l, n;
+
+    if (JAVACALL_OK != assure_loaded()) return JAVACALL_FAIL;
+    h = find_handler(content_handler_id);
+    if (h == NULL) return JAVACALL_FAIL;
+
+    a = find_string(h->list[LIST_ACTIONS], h->count[LIST_ACTIONS], action);
+    l = find_string(h->list[LIST_LOCALES], h->count[LIST_LOCALES], locale);
+    // the names are ordered by locales, then by actions
+    n = l * h->count[LIST_ACTIONS] + a;
+    if (a < 0 || l < 0 || n >= h->count[LIST_ACTION_NAMES]) return JAVACALL_FAIL;
+    return copy_out(h->list[LIST_ACTION_NAMES][n], local_action_out, length);
+}
+
+javacall_result javacall_chapi_get_handler_info(
+                        javacall_const_utf16_string content_handler_id,
+                        /*OUT*/ javacall_utf16* suite_id_out, int* suite_id_len,
+                        /*OUT*/ javacall_utf16* classname_out, int* classname_len,
+                        /*OUT*/ javacall_chapi_handler_registration_type* flag_out) {
+    REG_HANDLER* h;
+    int suite_len, class_len;
+
+    if (JAVACALL_OK != assure_loaded()) return JAVACALL_FAIL;
+    h = find_handler(content_handler_id);
+    if (h == NULL) return JAVACALL_FAIL;
+
+    suite_len = utf16_len(h->str[STR_SUITE_ID]) + 1;
+    class_len = utf16_len(h->str[STR_CLASS_NAME]) + 1;
+    if (*suite_id_len < suite_len || *classname_len < class_len) {
+        *suite_id_len = suite_len;
+        *classname_len = class_len;
+        return JAVACALL_CHAPI_ERROR_BUFFER_TOO_SMALL;
+    }
+    copy_out(h->str[STR_SUITE_ID], suite_id_out, suite_id_len);
+    copy_out(h->str[STR_CLASS_NAME], classname_out, classname_len);
+    if (flag_out != NULL) *flag_out = h->flag;
+    return JAVACALL_OK;
+}
+
+javacall_bool javacall_chapi_is_access_allowed(
+                        javacall_const_utf16_string content_handler_id,
+                        javacall_const_utf16_string caller_id) {
+    REG_HANDLER* h;
+    int i;
+
+    if (JAVACALL_OK != assure_loaded()) return JAVACALL_FALSE;
+    h = find_handler(content_handler_id);
+    if (h == NULL) return JAVACALL_FALSE;
+    if (caller_id == NULL || *caller_id == 0 || h->count[LIST_ACCESSES] == 0) {
+        return JAVACALL_TRUE;
+    }
+
+    // the caller ID starts with one of the allowed IDs
+    for (i = 0; i < h->count[LIST_ACCESSES]; i++) {
+        const javacall_utf16* allowed = h->list[LIST_ACCESSES][i];
+        const javacall_utf16* caller = caller_id;
+        while (*allowed && *allowed == *caller) {
+            allowed++;
+            caller++;
+        }
+        if (*allowed == 0) return JAVACALL_TRUE;
+    }
+    return JAVACALL_FALSE;
+}
+
+void javacall_chapi_enum_finish(int pos_id) {
+    (void)pos_id;
+}
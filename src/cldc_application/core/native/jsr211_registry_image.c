@@ -0,0 +1,742 @@
+/*
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation. 
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt). 
+ * 
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA 
+ * 
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions. 
+ */
+
+
+/**
+ * @file
+ * @brief Binary image of the registry index.
+ */
+
+#include "jsr211_registry_image.h"
+
+#if ENABLE_JSR_211_REGISTRY_IMAGE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <jsrop_memory.h>
+#include <midpStorage.h>
+
+#if !ENABLE_JSR_211_POSIX_REGISTRY
+#error The registry image is validated with the reference registry stamp
+#endif
+
+#include "jsr211_posix_registry.h"
+
+/** Image signature, 'JRIM' */
+#define IMAGE_MAGIC     0x4A52494D
+
+/** Image format version */
+#define IMAGE_VERSION   2
+
+/** File names in the internal storage */
+#define IMAGE_FILE      "_chapi_registry.img"
+#define IMAGE_TEMP_FILE "_chapi_registry.tmp"
+#define IMAGE_LOG_FILE  "_chapi_registry.log"
+
+/** Number of the logged handlers that triggers the merge */
+#define IMAGE_MERGE_LOG 64
+
+/**
+ * Image sections in the order they are laid out.
+ */
+typedef enum {
+    SECTION_HANDLERS = 0,   /* handler records */
+    SECTION_TYPES,          /* type values */
+    SECTION_SUFFIXES,       /* suffix values */
+    SECTION_ACTIONS,        /* action values */
+    SECTION_LISTS,          /* handler lists of the values */
+    SECTION_STRINGS,        /* string table */
+    SECTION_COUNT
+} IMAGE_SECTION_ID;
+
+/**
+ * Section location.
+ */
+typedef struct {
+    unsigned int            offset;     /* offset from the image start in bytes */
+    unsigned int            count;      /* number of elements */
+} IMAGE_SECTION;
+
+/**
+ * Image header.
+ */
+typedef struct {
+    unsigned int            magic;      /* IMAGE_MAGIC */
+    unsigned int            version;    /* IMAGE_VERSION */
+    unsigned int            size;       /* image size in bytes */
+    unsigned int            stamp;      /* backend stamp of the content */
+    IMAGE_SECTION           sections[SECTION_COUNT];
+} IMAGE_HEADER;
+
+/**
+ * Reference to the string table. The string is zero terminated.
+ */
+typedef struct {
+    unsigned int            offset;     /* offset in jchars */
+    unsigned int            len;        /* length in jchars */
+} IMAGE_STRING;
+
+/**
+ * Handler record.
+ */
+typedef struct {
+    IMAGE_STRING            id;
+    IMAGE_STRING            suite_id;
+    IMAGE_STRING            class_name;
+    unsigned int            flag;
+} IMAGE_HANDLER;
+
+/**
+ * Distinct field value and its handler list.
+ */
+typedef struct {
+    IMAGE_STRING            value;
+    unsigned int            list;       /* first element in the lists section */
+    unsigned int            count;      /* number of handlers */
+} IMAGE_VALUE;
+
+/**
+ * Delta log entry followed by the handler IDs. An ID is its length, the
+ * zero terminated ID and the padding. The entries chain the backend stamps
+ * starting from the image stamp.
+ */
+typedef struct {
+    unsigned int            prev;       /* backend stamp before the change */
+    unsigned int            stamp;      /* backend stamp after the change */
+    unsigned int            count;      /* number of the IDs */
+} LOG_ENTRY;
+
+/** Element sizes of the sections */
+static const size_t section_element[SECTION_COUNT] = {
+    sizeof(IMAGE_HANDLER),
+    sizeof(IMAGE_VALUE),
+    sizeof(IMAGE_VALUE),
+    sizeof(IMAGE_VALUE),
+    sizeof(unsigned int),
+    sizeof(jchar)
+};
+
+/** Fields of the value sections */
+static const jsr211_field section_field[SECTION_COUNT] = {
+    JSR211_FIELD_COUNT,
+    JSR211_FIELD_TYPES,
+    JSR211_FIELD_SUFFIXES,
+    JSR211_FIELD_ACTIONS,
+    JSR211_FIELD_COUNT,
+    JSR211_FIELD_COUNT
+};
+
+/** Whether the image file exists, i.e. modifications should be logged */
+static int image_present = 0;
+
+/** Number of the handlers in the delta log */
+static int log_count = 0;
+
+/** Backend stamp the image and the delta log lead to */
+static unsigned int log_stamp = 0;
+
+/** Delta log opened for appending or -1 */
+static int log_fd = -1;
+
+/** Image mapping the index strings point to */
+static const char* image_map = NULL;
+static size_t image_map_size = 0;
+
+/**
+ * Returns the full path of the file in the internal storage.
+ * The path MUST be released with JAVAME_FREE.
+ */
+static char* storage_path(const char* name) {
+    const pcsl_string* root = storage_get_root(INTERNAL_STORAGE_ID);
+    jint root_len = pcsl_string_utf8_length(root);
+    jint converted;
+    char* path;
+
+    if (root_len < 0) return NULL;
+    path = (char*)JAVAME_MALLOC(root_len + strlen(name) + 1);
+    if (path != NULL) {
+        if (PCSL_STRING_OK != pcsl_string_convert_to_utf8(root,
+                                (jbyte*)path, root_len + 1, &converted)) {
+            JAVAME_FREE(path);
+            return NULL;
+        }
+        strcpy(path + converted, name);
+    }
+    return path;
+}
+
+static void remove_file(const char* name) {
+    char* path = storage_path(name);
+    if (path != NULL) {
+        unlink(path);
+        JAVAME_FREE(path);
+    }
+}
+
+/**
+ * Maps the file to memory for reading.
+ *
+ * @param size output value - the file size
+ * @return the mapping or NULL if the file is missing or empty
+ */
+static const char* map_file(const char* name, /*OUT*/ size_t* size) {
+    char* path = storage_path(name);
+    const char* map = NULL;
+    struct stat st;
+    int fd;
+
+    if (path == NULL) return NULL;
+    fd = open(path, O_RDONLY);
+    JAVAME_FREE(path);
+    if (fd < 0) return NULL;
+
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            map = (const char*)p;
+            *size = st.st_size;
+        }
+    }
+    close(fd);
+    return map;
+}
+
+/**
+ * Returns the size of the ID in the delta log.
+ */
+static size_t log_id_size(size_t len) {
+    return (sizeof(unsigned int) + len * sizeof(jchar) + 3) & ~3;
+}
+
+/**
+ * Checks the delta log entry.
+ *
+ * @return the end of the entry or 0 if the entry is torn
+ */
+static size_t log_entry_end(const char* log, size_t size, size_t pos) {
+    const LOG_ENTRY* entry = (const LOG_ENTRY*)(log + pos);
+    unsigned int i;
+    size_t len;
+
+    pos += sizeof(LOG_ENTRY);
+    for (i = 0; i < entry->count; i++) {
+        const jchar* id = (const jchar*)(log + pos + sizeof(unsigned int));
+        if (size - pos < sizeof(unsigned int)) return 0;
+        len = *(const unsigned int*)(log + pos);
+        if (len == 0 || len > (size - pos - sizeof(unsigned int)) / sizeof(jchar) ||
+                                                            id[len - 1] != 0) {
+            return 0;
+        }
+        pos += log_id_size(len);
+        if (pos > size) return 0;
+    }
+    return pos;
+}
+
+static int write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n <= 0) return 0;
+        data += n;
+        size -= n;
+    }
+    return 1;
+}
+
+/**
+ * Checks the string reference and returns the string.
+ */
+static const jchar* image_string(const jchar* strings, unsigned int count,
+                                                    const IMAGE_STRING* s) {
+    if (s->offset >= count || s->len >= count - s->offset ||
+                                strings[s->offset + s->len] != 0) {
+        return NULL;
+    }
+    return strings + s->offset;
+}
+
+/**
+ * Populates the index from the mapped image.
+ */
+static jsr211_result load_index(const char* image, size_t size) {
+    const IMAGE_HEADER* hdr = (const IMAGE_HEADER*)image;
+    const IMAGE_HANDLER* records;
+    const unsigned int* lists;
+    const jchar* strings;
+    unsigned int nstrings, nlists, nhandlers;
+    jsr211_index_handler** handlers;
+    jsr211_result status = JSR211_OK;
+    unsigned int i, j;
+    int s;
+
+    if (size < sizeof(*hdr) || hdr->magic != IMAGE_MAGIC ||
+            hdr->version != IMAGE_VERSION || hdr->size != size) {
+        return JSR211_FAILED;
+    }
+    for (s = 0; s < SECTION_COUNT; s++) {
+        const IMAGE_SECTION* sec = hdr->sections + s;
+        if (sec->offset < sizeof(*hdr) || sec->offset > size ||
+                sec->offset % sizeof(unsigned int) != 0 ||
+                sec->count > (size - sec->offset) / section_element[s]) {
+            return JSR211_FAILED;
+        }
+    }
+
+    records = (const IMAGE_HANDLER*)(image + hdr->sections[SECTION_HANDLERS].offset);
+    nhandlers = hdr->sections[SECTION_HANDLERS].count;
+    lists = (const unsigned int*)(image + hdr->sections[SECTION_LISTS].offset);
+    nlists = hdr->sections[SECTION_LISTS].count;
+    strings = (const jchar*)(image + hdr->sections[SECTION_STRINGS].offset);
+    nstrings = hdr->sections[SECTION_STRINGS].count;
+
+    handlers = (jsr211_index_handler**)JAVAME_MALLOC(
+                                    (nhandlers + 1) * sizeof(*handlers));
+    if (handlers == NULL) return JSR211_FAILED;
+
+    // records are inserted backwards to keep the enumeration order
+    for (i = nhandlers; i-- > 0 && status == JSR211_OK;) {
+        const jchar* id = image_string(strings, nstrings, &records[i].id);
+        const jchar* suite_id = image_string(strings, nstrings, &records[i].suite_id);
+        const jchar* class_name = image_string(strings, nstrings, &records[i].class_name);
+
+        handlers[i] = NULL;
+        if (id != NULL && suite_id != NULL && class_name != NULL) {
+            handlers[i] = jsr211_index_put(id, records[i].id.len,
+                        suite_id, records[i].suite_id.len,
+                        class_name, records[i].class_name.len,
+                        (jsr211_register_type)records[i].flag);
+        }
+        if (handlers[i] == NULL) status = JSR211_FAILED;
+    }
+
+    for (s = SECTION_TYPES; s <= SECTION_ACTIONS && status == JSR211_OK; s++) {
+        const IMAGE_VALUE* values = (const IMAGE_VALUE*)(image + hdr->sections[s].offset);
+        for (i = 0; i < hdr->sections[s].count && status == JSR211_OK; i++) {
+            const jchar* value = image_string(strings, nstrings, &values[i].value);
+            if (value == NULL || values[i].list > nlists ||
+                                values[i].count > nlists - values[i].list) {
+                status = JSR211_FAILED;
+                break;
+            }
+            for (j = 0; j < values[i].count && status == JSR211_OK; j++) {
+                unsigned int n = lists[values[i].list + j];
+                status = (n < nhandlers)? jsr211_index_link(section_field[s],
+                        value, values[i].value.len, handlers[n]): JSR211_FAILED;
+            }
+        }
+    }
+
+    JAVAME_FREE(handlers);
+    return status;
+}
+
+/**
+ * Loads the index from the registry image. The index MUST be empty.
+ * The image stays mapped until jsr211_image_release(), the index strings
+ * point to it.
+ *
+ * @return JSR211_OK if the image is present, valid and loaded
+ */
+jsr211_result jsr211_image_load(void) {
+    size_t size;
+    const char* image;
+    jsr211_result status;
+
+    jsr211_image_release();
+    image_present = 0;
+    image = map_file(IMAGE_FILE, &size);
+    if (image == NULL) return JSR211_FAILED;
+
+    // a partially loaded index points to the image too
+    image_map = image;
+    image_map_size = size;
+    status = load_index(image, size);
+
+    if (status == JSR211_OK) {
+        log_stamp = ((const IMAGE_HEADER*)image)->stamp;
+        image_present = 1;
+    }
+    return status;
+}
+
+/**
+ * Reads the handlers logged in the delta log from the backend and updates
+ * the loaded index. The log is replayed while its entries continue the
+ * stamp chain from the image, the rest of the log is dropped.
+ *
+ * @return JSR211_OK if the index matches the backend stamp
+ */
+jsr211_result jsr211_image_replay(void) {
+    size_t size, pos = 0, end, len;
+    const char* log = map_file(IMAGE_LOG_FILE, &size);
+    jsr211_result status = JSR211_OK;
+    unsigned int i;
+
+    log_count = 0;
+    if (log != NULL) {
+        while (status == JSR211_OK && size - pos >= sizeof(LOG_ENTRY)) {
+            const LOG_ENTRY* entry = (const LOG_ENTRY*)(log + pos);
+            end = log_entry_end(log, size, pos);
+            if (end == 0 || entry->prev != log_stamp) {
+                break; // the entry is torn or stale
+            }
+            for (pos += sizeof(LOG_ENTRY), i = 0;
+                        i < entry->count && status == JSR211_OK; i++) {
+                len = *(const unsigned int*)(log + pos);
+                status = jsr211_index_refresh(
+                            (const jchar*)(log + pos + sizeof(unsigned int)));
+                pos += log_id_size(len);
+            }
+            log_stamp = entry->stamp;
+            log_count += entry->count;
+        }
+        munmap((void*)log, size);
+
+        if (status == JSR211_OK && pos < size) {
+            // the next entries continue the valid part
+            char* path = storage_path(IMAGE_LOG_FILE);
+            if (path == NULL || truncate(path, pos) != 0) status = JSR211_FAILED;
+            if (path != NULL) JAVAME_FREE(path);
+        }
+    }
+
+    if (status == JSR211_OK && log_stamp != jsr211_posix_registry_stamp()) {
+        // the backend was changed bypassing the log
+        status = JSR211_FAILED;
+    }
+    if (status != JSR211_OK) {
+        // the entries logged from now on must not extend the stale image
+        remove_file(IMAGE_FILE);
+        image_present = 0;
+    }
+    return status;
+}
+
+/**
+ * Appends the handler ID to the delta log. MUST be called after the
+ * handler is changed in the backend. If the ID can't be logged the image
+ * is removed.
+ *
+ * @param id ID of the changed handler
+ */
+void jsr211_image_log(const jchar* id) {
+    jsr211_image_log_ids(&id, 1);
+}
+
+/**
+ * Appends the handler IDs to the delta log as a single entry. MUST be
+ * called after the handlers are changed in the backend. The log is not
+ * synced: an entry lost in a crash breaks the stamp chain and the index is
+ * rebuilt. If the IDs can't be logged the image is removed. The image is
+ * merged when the log grows over IMAGE_MERGE_LOG handlers.
+ *
+ * @param ids IDs of the changed handlers
+ * @param n number of the IDs
+ */
+void jsr211_image_log_ids(const jchar* const* ids, int n) {
+    size_t len, size = sizeof(LOG_ENTRY);
+    LOG_ENTRY* entry;
+    int i, ok = 0;
+
+    if (!image_present || n <= 0) return;
+
+    for (i = 0; i < n; i++) {
+        size += log_id_size(wcslen(ids[i]) + 1);
+    }
+
+    entry = (LOG_ENTRY*)JAVAME_MALLOC(size);
+    if (entry != NULL) {
+        char* p = (char*)(entry + 1);
+        memset(entry, 0, size);
+        entry->prev = log_stamp;
+        entry->stamp = jsr211_posix_registry_stamp();
+        entry->count = n;
+        for (i = 0; i < n; i++) {
+            len = wcslen(ids[i]) + 1;
+            *(unsigned int*)p = len;
+            memcpy(p + sizeof(unsigned int), ids[i], len * sizeof(jchar));
+            p += log_id_size(len);
+        }
+        if (log_fd < 0) {
+            char* path = storage_path(IMAGE_LOG_FILE);
+            if (path != NULL) {
+                log_fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0600);
+                JAVAME_FREE(path);
+            }
+        }
+        ok = log_fd >= 0 && write_all(log_fd, (const char*)entry, size);
+        if (ok) log_stamp = entry->stamp;
+        JAVAME_FREE(entry);
+    }
+
+    if (!ok) {
+        // the image can't be trusted any more, the index is rebuilt from the backend
+        remove_file(IMAGE_FILE);
+        image_present = 0;
+    } else if ((log_count += n) >= IMAGE_MERGE_LOG) {
+        jsr211_image_merge();
+    }
+}
+
+/**
+ * Checks whether the delta log has entries not merged into the image.
+ *
+ * @return JSR211_TRUE if the image should be merged
+ */
+jsr211_boolean jsr211_image_pending(void) {
+    return log_count > 0? JSR211_TRUE: JSR211_FALSE;
+}
+
+/**
+ * Handler record number for the handler lists.
+ */
+typedef struct {
+    const jsr211_index_handler* h;
+    unsigned int n;
+} ORDINAL;
+
+static int compare_ordinals(const void* o1, const void* o2) {
+    const jsr211_index_handler* h1 = ((const ORDINAL*)o1)->h;
+    const jsr211_index_handler* h2 = ((const ORDINAL*)o2)->h;
+    return (h1 < h2)? -1: (h1 > h2)? 1: 0;
+}
+
+/**
+ * Appends the string to the string table of the image.
+ */
+static void put_string(jchar* strings, unsigned int* pos,
+                    const jchar* str, size_t len, /*OUT*/ IMAGE_STRING* ref) {
+    ref->offset = *pos;
+    ref->len = len;
+    memcpy(strings + *pos, str, len * sizeof(jchar));
+    strings[*pos + len] = 0;
+    *pos += len + 1;
+}
+
+/**
+ * Serializes the index to the image.
+ *
+ * @param size output value - the image size
+ * @return the image allocated with JAVAME_MALLOC or NULL if no memory
+ * available
+ */
+static char* serialize_index(/*OUT*/ size_t* size) {
+    jsr211_index_enum pos = JSR211_INDEX_ENUM_INITIALIZER;
+    jsr211_index_handler* const* list;
+    const jsr211_index_handler* h;
+    const jchar* value;
+    size_t len;
+    ORDINAL* ordinals;
+    ORDINAL key, *found;
+    IMAGE_HEADER* hdr;
+    IMAGE_HANDLER* records;
+    IMAGE_VALUE* values;
+    unsigned int* lists;
+    jchar* strings;
+    unsigned int nhandlers = 0, nlists = 0, nstrings = 0, nlist = 0, nstr = 0;
+    unsigned int offset, i, j, n;
+    char* image;
+    int s;
+
+    while ((h = jsr211_index_next(&pos)) != NULL) {
+        nhandlers++;
+        nstrings += h->id_len + h->suite_id_len + h->class_name_len + 3;
+    }
+    for (s = SECTION_TYPES; s <= SECTION_ACTIONS; s++) {
+        for (i = 0; i < (unsigned int)jsr211_index_value_count(section_field[s]); i++) {
+            nlists += jsr211_index_value(section_field[s], i, &value, &len, &list);
+            nstrings += len + 1;
+        }
+    }
+
+    ordinals = (ORDINAL*)JAVAME_MALLOC((nhandlers + 1) * sizeof(*ordinals));
+    if (ordinals == NULL) return NULL;
+
+    offset = sizeof(IMAGE_HEADER);
+    offset += nhandlers * sizeof(IMAGE_HANDLER);
+    for (s = SECTION_TYPES; s <= SECTION_ACTIONS; s++) {
+        offset += jsr211_index_value_count(section_field[s]) * sizeof(IMAGE_VALUE);
+    }
+    offset += nlists * sizeof(unsigned int);
+    *size = offset + nstrings * sizeof(jchar);
+
+    image = (char*)JAVAME_MALLOC(*size);
+    if (image == NULL) {
+        JAVAME_FREE(ordinals);
+        return NULL;
+    }
+    memset(image, 0, *size);
+
+    hdr = (IMAGE_HEADER*)image;
+    hdr->magic = IMAGE_MAGIC;
+    hdr->version = IMAGE_VERSION;
+    hdr->size = *size;
+    hdr->stamp = jsr211_posix_registry_stamp();
+    offset = sizeof(IMAGE_HEADER);
+    hdr->sections[SECTION_HANDLERS].offset = offset;
+    hdr->sections[SECTION_HANDLERS].count = nhandlers;
+    offset += nhandlers * sizeof(IMAGE_HANDLER);
+    for (s = SECTION_TYPES; s <= SECTION_ACTIONS; s++) {
+        hdr->sections[s].offset = offset;
+        hdr->sections[s].count = jsr211_index_value_count(section_field[s]);
+        offset += hdr->sections[s].count * sizeof(IMAGE_VALUE);
+    }
+    hdr->sections[SECTION_LISTS].offset = offset;
+    hdr->sections[SECTION_LISTS].count = nlists;
+    offset += nlists * sizeof(unsigned int);
+    hdr->sections[SECTION_STRINGS].offset = offset;
+    hdr->sections[SECTION_STRINGS].count = nstrings;
+
+    records = (IMAGE_HANDLER*)(image + hdr->sections[SECTION_HANDLERS].offset);
+    lists = (unsigned int*)(image + hdr->sections[SECTION_LISTS].offset);
+    strings = (jchar*)(image + hdr->sections[SECTION_STRINGS].offset);
+
+    pos.bucket = 0;
+    pos.next = NULL;
+    for (n = 0; (h = jsr211_index_next(&pos)) != NULL; n++) {
+        put_string(strings, &nstr, h->id, h->id_len, &records[n].id);
+        put_string(strings, &nstr, h->suite_id, h->suite_id_len, &records[n].suite_id);
+        put_string(strings, &nstr, h->class_name, h->class_name_len, &records[n].class_name);
+        records[n].flag = h->flag;
+        ordinals[n].h = h;
+        ordinals[n].n = n;
+    }
+    qsort(ordinals, nhandlers, sizeof(*ordinals), compare_ordinals);
+
+    for (s = SECTION_TYPES; s <= SECTION_ACTIONS; s++) {
+        values = (IMAGE_VALUE*)(image + hdr->sections[s].offset);
+        for (i = 0; i < hdr->sections[s].count; i++) {
+            n = jsr211_index_value(section_field[s], i, &value, &len, &list);
+            put_string(strings, &nstr, value, len, &values[i].value);
+            values[i].list = nlist;
+            values[i].count = n;
+            for (j = 0; j < n; j++) {
+                key.h = list[j];
+                found = (ORDINAL*)bsearch(&key, ordinals, nhandlers,
+                                            sizeof(*ordinals), compare_ordinals);
+                lists[nlist++] = found->n;
+            }
+        }
+    }
+
+    JAVAME_FREE(ordinals);
+    return image;
+}
+
+/**
+ * Writes the image from the current index and clears the delta log.
+ *
+ * @return JSR211_OK if the image is written
+ */
+jsr211_result jsr211_image_merge(void) {
+    char* image;
+    char* temp;
+    char* path;
+    size_t size;
+    int fd, ok = 0;
+
+    if (JSR211_OK != jsr211_index_assure()) return JSR211_FAILED;
+
+    image = serialize_index(&size);
+    temp = storage_path(IMAGE_TEMP_FILE);
+    path = storage_path(IMAGE_FILE);
+    if (image != NULL && temp != NULL && path != NULL) {
+        fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (fd >= 0) {
+            ok = write_all(fd, image, size) && fsync(fd) == 0;
+            close(fd);
+            ok = ok && rename(temp, path) == 0;
+            if (!ok) unlink(temp);
+        }
+    }
+    if (image != NULL) JAVAME_FREE(image);
+    if (temp != NULL) JAVAME_FREE(temp);
+    if (path != NULL) JAVAME_FREE(path);
+
+    if (!ok) return JSR211_FAILED;
+
+    // entries logged before are in the image now
+    if (log_fd >= 0) {
+        close(log_fd);
+        log_fd = -1;
+    }
+    remove_file(IMAGE_LOG_FILE);
+    log_stamp = jsr211_posix_registry_stamp();
+    log_count = 0;
+    image_present = 1;
+    return JSR211_OK;
+}
+
+/**
+ * Closes the delta log and unmaps the image. MUST be called after the index
+ * strings pointing to the image are released.
+ */
+void jsr211_image_release(void) {
+    if (log_fd >= 0) {
+        close(log_fd);
+        log_fd = -1;
+    }
+    if (image_map != NULL) {
+        munmap((void*)image_map, image_map_size);
+        image_map = NULL;
+    }
+}
+
+#else /* ENABLE_JSR_211_REGISTRY_IMAGE */
+
+jsr211_result jsr211_image_load(void) {
+    return JSR211_FAILED;
+}
+
+jsr211_result jsr211_image_replay(void) {
+    return JSR211_OK;
+}
+
+void jsr211_image_log(const jchar* id) {
+    (void)id;
+}
+
+void jsr211_image_log_ids(const jchar* const* ids, int n) {
+    (void)ids;
+    (void)n;
+}
+
+jsr211_boolean jsr211_image_pending(void) {
+    return JSR211_FALSE;
+}
+
+jsr211_result jsr211_image_merge(void) {
+    return JSR211_OK;
+}
+
+void jsr211_image_release(void) {
+}
+
+#endif /* ENABLE_JSR_211_REGISTRY_IMAGE */
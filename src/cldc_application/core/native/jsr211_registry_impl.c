@@ -37,8 +37,13 @@
 #include "javacall_chapi_registry.h"
 #include "javacall_chapi_invoke.h"
 #include "jsr211_registry.h"
+#include "jsr211_registry_index.h"
+#include "jsr211_id_trie.h"
+#include "jsr211_registry_image.h"
 
-#define MAX_BUFFER 128
+#if ENABLE_JSR_211_POSIX_REGISTRY
+#include "jsr211_posix_registry.h"
+#endif
 
 /**
  * Status code [javacall_result -> jsr211_result] transformation.
@@ -46,72 +51,146 @@
 #define JSR211_STATUS(status) ((status) == JAVACALL_OK? JSR211_OK: JSR211_FAILED)
 
 /**
- * Check that getter method called in loop returned res = ERROR_BUFFER_TOO_SMALL and try to realocate this buffer
+ * Backend journal sync control for the registration batch. Other backends
+ * have no such control and sync every modification themselves.
  */
-#define ASSURE_BUF(buffer, len, maxlen) \
+#if ENABLE_JSR_211_POSIX_REGISTRY
+#define BACKEND_DEFER_SYNC()    jsr211_posix_registry_defer_sync()
+#define BACKEND_SYNC()          jsr211_posix_registry_sync()
+#else
+#define BACKEND_DEFER_SYNC()
+#define BACKEND_SYNC()          JAVACALL_OK
+#endif
+
+/**
+ * Check that getter method called in loop returned res = ERROR_BUFFER_TOO_SMALL and try to grow
+ * the scratch buffer
+ */
+#define ASSURE_BUF(scratch, buffer, len, maxlen) \
     if (res == JAVACALL_CHAPI_ERROR_BUFFER_TOO_SMALL){ \
-        JAVAME_FREE(buffer); \
-        maxlen = len; \
-        buffer = (jchar*) JAVAME_MALLOC(maxlen*sizeof(*buffer)); \
+        buffer = jsr211_scratch_grow(scratch, len, &maxlen); \
         continue; \
     }
 
 /**
- * Append handler to single handler result buffer by handler ID
+ * Append handler to single handler result buffer
  */
-#define fill_handler(id, result)  put_handler(id, result, 0);
+#define fill_handler(h, result)  put_handler(h, result, 0)
 
 /**
- * Append handler to array of handlers result buffer by handler ID
+ * Append handler to array of handlers result buffer
  */
-#define append_handler(id, result)  put_handler(id, result, 1);
+#define append_handler(h, result)  put_handler(h, result, 1)
 
-static int put_handler(const jchar* id, JSR211_RESULT_BUFFER * result, int append) {
+static int put_handler(const jsr211_index_handler* h, JSR211_RESULT_BUFFER * result, int append) {
+    if (append) {
+        return jsr211_appendHandler(h->id, h->id_len, h->suite_id, h->suite_id_len,
+                h->class_name, h->class_name_len, h->flag, (JSR211_RESULT_CHARRAY)result);
+    }
+    return jsr211_fillHandler(h->id, h->id_len, h->suite_id, h->suite_id_len,
+                h->class_name, h->class_name_len, h->flag, (JSR211_RESULT_CH)result);
+}
 
-    int id_sz = wcslen( id );
 
-    jchar* classname = NULL;
-    int classname_len = MAX_BUFFER;
+/**
+ * Registry generation, incremented on every registration and unregistration.
+ */
+static int registry_generation = 0;
 
-    jchar* suite_id = NULL;
-    int suite_id_len = MAX_BUFFER;
-    javacall_chapi_handler_registration_type flag;
-    int res;
+/**
+ * Open registration batch. IDs of the handlers registered in the batch are
+ * journaled in the registration order, so the batch can be rolled back.
+ */
+typedef struct {
+    int     open;       /**< Whether the batch is open */
+    int     count;      /**< Number of journaled IDs */
+    int     capacity;   /**< Capacity of the journal */
+    jchar** ids;        /**< Journaled IDs */
+} REGISTRATION_BATCH;
 
-    while (1) {
-        classname = JAVAME_MALLOC(classname_len * sizeof(*classname));
-        if (!classname) break;
+static REGISTRATION_BATCH batch = { 0, 0, 0, NULL };
 
-        suite_id = JAVAME_MALLOC(suite_id_len  * sizeof(*suite_id));
-        if (!suite_id) break;
+/**
+ * Maximum number of open find cursors. When all of them are open the least
+ * recently used one is reclaimed.
+ */
+#define CURSOR_COUNT 8
 
-        res = javacall_chapi_get_handler_info(id, suite_id, &suite_id_len,
-                                            classname, &classname_len, &flag);
+/**
+ * Find cursor: the query and the position of the next page. The position
+ * is the index in the handlers list of the value, which is sorted by ID;
+ * after the registry has changed the position is restored as the first
+ * handler with the ID greater than the last passed one.
+ */
+typedef struct {
+    int             handle;     /**< Cursor handle, 0 if the slot is free */
+    int             used;       /**< Time of the last use, for reclaiming */
+    jsr211_field    field;      /**< Searched field */
+    jchar*          value;      /**< Searched value */
+    jchar*          caller_id;  /**< Calling application or NULL */
+    int             generation; /**< Registry generation of the position */
+    int             next;       /**< Index of the next handler */
+    jchar*          last_id;    /**< ID of the last passed handler or NULL */
+} FIND_CURSOR;
+
+static FIND_CURSOR cursors[CURSOR_COUNT];
+static int cursor_serial = 0;
+static int cursor_clock = 0;
 
-        if (res == JAVACALL_CHAPI_ERROR_BUFFER_TOO_SMALL){
-            JAVAME_FREE(classname); classname = NULL;
-            JAVAME_FREE(suite_id); suite_id = NULL;
-            continue;
-        }
+/**
+ * Appends a copy of the handler ID to the batch journal.
+ */
+static jsr211_result journal_id(const jchar* id) {
+    size_t len = wcslen(id);
+    jchar* copy;
+
+    if (batch.count == batch.capacity) {
+        int capacity = batch.capacity? batch.capacity * 2: 16;
+        jchar** ids = (jchar**)JAVAME_REALLOC(batch.ids, capacity * sizeof(jchar*));
+        if (ids == NULL) return JSR211_FAILED;
+        batch.ids = ids;
+        batch.capacity = capacity;
+    }
 
-        if (res) break;
+    copy = (jchar*)JAVAME_MALLOC((len + 1) * sizeof(jchar));
+    if (copy == NULL) return JSR211_FAILED;
+    memcpy(copy, id, (len + 1) * sizeof(jchar));
+    batch.ids[batch.count++] = copy;
+    return JSR211_OK;
+}
 
-        // assert( flag != 0 );
-        if (append) {
-            res = jsr211_appendHandler(id, id_sz, suite_id, suite_id_len - 1,
-                    classname, classname_len - 1, flag,    (JSR211_RESULT_CHARRAY)result);
-        } else {
-            res = jsr211_fillHandler(id, id_sz, suite_id, suite_id_len - 1,
-                    classname, classname_len - 1, flag,    (JSR211_RESULT_CH)result);
-        }
-        break;
-    }
+/**
+ * Returns a copy of the string or NULL if no memory available.
+ */
+static jchar* copy_string(const jchar* str) {
+    size_t size = (wcslen(str) + 1) * sizeof(jchar);
+    jchar* copy = (jchar*)JAVAME_MALLOC(size);
+    if (copy != NULL) memcpy(copy, str, size);
+    return copy;
+}
 
-    if (classname) JAVAME_FREE(classname); 
-    if (suite_id) JAVAME_FREE(suite_id);
-    return res;
+/**
+ * Releases the cursor strings and frees the slot.
+ */
+static void free_cursor(FIND_CURSOR* c) {
+    if (c->value != NULL) JAVAME_FREE(c->value);
+    if (c->caller_id != NULL) JAVAME_FREE(c->caller_id);
+    if (c->last_id != NULL) JAVAME_FREE(c->last_id);
+    memset(c, 0, sizeof(*c));
 }
 
+/**
+ * Releases the batch journal and closes the batch.
+ */
+static void close_batch(void) {
+    while (batch.count > 0) {
+        JAVAME_FREE(batch.ids[--batch.count]);
+    }
+    JAVAME_FREE(batch.ids);
+    batch.ids = NULL;
+    batch.capacity = 0;
+    batch.open = 0;
+}
 
 /**
  * Initializes content handler registry.
@@ -121,6 +200,8 @@ static int put_handler(const jchar* id, JSR211_RESULT_BUFFER * result, int appen
 jsr211_result jsr211_initialize(void){
     //return JSR211_STATUS(javacall_chapi_init_registry());
     javacall_chapi_init_registry();
+    // if the index can't be built now it is built on the first query
+    jsr211_index_build();
     return JSR211_OK;
 }
 
@@ -130,6 +211,19 @@ jsr211_result jsr211_initialize(void){
  * @return JAVACALL_OK if content handler registry finalized successfully
  */
 jsr211_result jsr211_finalize(void){
+    if (batch.open) {
+        jsr211_batch_rollback();
+    }
+    if (jsr211_image_pending()) {
+        jsr211_image_merge();
+    }
+    {
+        int i;
+        for (i = 0; i < CURSOR_COUNT; i++) free_cursor(&cursors[i]);
+    }
+    jsr211_index_release();
+    jsr211_scratch_release();
+    jsr211_result_pool_release();
     javacall_chapi_finalize_registry();
     return 0;
 }
@@ -143,7 +237,7 @@ jsr211_result jsr211_finalize(void){
  */
 jsr211_result jsr211_register_handler(const jsr211_content_handler* ch) {
 
-    jsr211_result status = JSR211_FAILED;
+    javacall_result status;
     javacall_utf16_string *types = NULL;
     javacall_utf16_string *suffixes = NULL;
     javacall_utf16_string *actions = NULL;
@@ -165,6 +259,19 @@ jsr211_result jsr211_register_handler(const jsr211_content_handler* ch) {
                         (javacall_const_utf16_string*)ch->action_map, n, 
                         (javacall_const_utf16_string*)ch->accesses, ch->access_num);
 
+    if (status == JAVACALL_OK) {
+        jsr211_index_add(ch);
+        if (!batch.open) {
+            registry_generation++;
+            jsr211_image_log(ch->id);
+        } else if (JSR211_OK != journal_id(ch->id)) {
+            // the registration could not be rolled back later
+            javacall_chapi_unregister_handler(ch->id);
+            jsr211_index_remove(ch->id);
+            jsr211_image_log(ch->id);
+            status = JAVACALL_FAIL;
+        }
+    }
     return JSR211_STATUS(status);
 }
 
@@ -175,7 +282,211 @@ jsr211_result jsr211_register_handler(const jsr211_content_handler* ch) {
  * @return JSR211_OK if content handler unregistered successfully
  */
 jsr211_result jsr211_unregister_handler(javacall_const_utf16_string handler_id) {
-    return JSR211_STATUS(javacall_chapi_unregister_handler(handler_id));
+    int status;
+
+    status = javacall_chapi_unregister_handler(handler_id);
+    if (status == JAVACALL_OK) {
+        jsr211_index_remove(handler_id);
+        registry_generation++;
+        jsr211_image_log(handler_id);
+    }
+    return JSR211_STATUS(status);
+}
+
+/**
+ * Opens a registration batch. Handlers registered with
+ * @link jsr211_register_handler until @link jsr211_batch_commit or
+ * @link jsr211_batch_rollback form one unit: the registry generation is
+ * changed once at the end and the rollback unregisters all of them. The
+ * backend journal is synchronized once at the end of the batch.
+ * Batches can't be nested.
+ *
+ * @return JSR211_OK if the batch is opened
+ */
+jsr211_result jsr211_batch_begin(void) {
+    if (batch.open) return JSR211_FAILED;
+    batch.open = 1;
+    BACKEND_DEFER_SYNC();
+    return JSR211_OK;
+}
+
+/**
+ * Commits the registration batch. If the backend journal can't be
+ * synchronized the batch is rolled back.
+ *
+ * @return JSR211_OK if the batch is committed
+ */
+jsr211_result jsr211_batch_commit(void) {
+    if (!batch.open) return JSR211_FAILED;
+    if (JAVACALL_OK != BACKEND_SYNC()) {
+        jsr211_batch_rollback();
+        return JSR211_FAILED;
+    }
+    if (batch.count > 0) {
+        registry_generation++;
+        jsr211_image_log_ids((const jchar* const*)batch.ids, batch.count);
+    }
+    close_batch();
+    return JSR211_OK;
+}
+
+/**
+ * Rolls back the registration batch. The handlers registered in the batch
+ * are unregistered in the reverse order.
+ *
+ * @return JSR211_OK if all registrations are rolled back
+ */
+jsr211_result jsr211_batch_rollback(void) {
+    jsr211_result status = JSR211_OK;
+    int i;
+
+    if (!batch.open) return JSR211_FAILED;
+    for (i = batch.count; i-- > 0;) {
+        if (JAVACALL_OK != javacall_chapi_unregister_handler(batch.ids[i])) {
+            status = JSR211_FAILED;
+        }
+        jsr211_index_remove(batch.ids[i]);
+    }
+    if (JAVACALL_OK != BACKEND_SYNC()) {
+        status = JSR211_FAILED;
+    }
+    if (batch.count > 0) {
+        // the handlers could be seen by queries while the batch was open
+        registry_generation++;
+        jsr211_image_log_ids((const jchar* const*)batch.ids, batch.count);
+    }
+    close_batch();
+    return status;
+}
+
+/**
+ * Trie visitor failing on any handler, i.e. on any ID conflict.
+ */
+static jsr211_result reject_conflict(jsr211_index_handler* h, void* ctx) {
+    (void)h;
+    (void)ctx;
+    return JSR211_FAILED;
+}
+
+/**
+ * Checks whether one of the IDs is a prefix of the other one.
+ */
+static int ids_conflict(const jchar* id1, const jchar* id2) {
+    while (*id1 && *id1 == *id2) {
+        id1++;
+        id2++;
+    }
+    return *id1 == 0 || *id2 == 0;
+}
+
+/**
+ * Validates the handler of the batch: the mandatory fields are present and
+ * the ID doesn't conflict with the registered handlers.
+ */
+static jsr211_result validate_handler(const jsr211_content_handler* ch) {
+    int i;
+
+    if (ch->id == NULL || *ch->id == 0 || ch->suite_id == NULL ||
+            ch->class_name == NULL || *ch->class_name == 0) {
+        return JSR211_FAILED;
+    }
+    if (ch->locale_num > 0 && ch->action_map == NULL) return JSR211_FAILED;
+    for (i = 0; i < ch->act_num * ch->locale_num; i++) {
+        if (ch->action_map[i] == NULL) return JSR211_FAILED;
+    }
+    return jsr211_trie_conflicts(ch->id, wcslen(ch->id), reject_conflict, NULL);
+}
+
+/**
+ * Registers the set of handlers as one unit. The whole set is validated
+ * before the first handler is stored: all mandatory fields are present and
+ * no ID conflicts with a registered handler or with another ID of the set.
+ * If any registration fails the handlers stored already are unregistered.
+ * The backend journal is synchronized and the image log is written once
+ * for the whole set.
+ *
+ * @param handlers registering handlers. Implementation MUST NOT retain
+ * pointed objects
+ * @param n number of handlers
+ * @return JSR211_OK if all handlers are registered
+ */
+jsr211_result jsr211_register_handlers_batch(const jsr211_content_handler* handlers, int n) {
+    int i, j;
+
+    if (JSR211_OK != jsr211_index_assure()) return JSR211_FAILED;
+
+    // suites declare a few dozens of handlers at most
+    for (i = 0; i < n; i++) {
+        if (JSR211_OK != validate_handler(handlers + i)) return JSR211_FAILED;
+        for (j = 0; j < i; j++) {
+            if (ids_conflict(handlers[i].id, handlers[j].id)) return JSR211_FAILED;
+        }
+    }
+
+    if (JSR211_OK != jsr211_batch_begin()) return JSR211_FAILED;
+
+    for (i = 0; i < n; i++) {
+        if (JSR211_OK != jsr211_register_handler(handlers + i)) {
+            jsr211_batch_rollback();
+            return JSR211_FAILED;
+        }
+    }
+    return jsr211_batch_commit();
+}
+
+/**
+ * Returns the registry generation. The generation is changed by every
+ * successful registration or unregistration, so results of the registry
+ * queries may be reused while the generation stays the same.
+ *
+ * @return current registry generation
+ */
+int jsr211_get_generation(void) {
+    return registry_generation;
+}
+
+/**
+ * Searches content handler by type, suffix or action using the registry index.
+ *
+ * @param caller_id calling application identifier
+ * @param key search field id
+ * @param value search value
+ * @param result the buffer for Content Handlers result array
+ * @return status of the operation
+ */
+static jsr211_result find_indexed_handler(javacall_const_utf16_string caller_id,
+                        jsr211_field key, javacall_const_utf16_string value,
+                        /*OUT*/ JSR211_RESULT_CHARRAY result) {
+    jsr211_index_handler* const* found;
+    int n = jsr211_index_lookup(key, value, &found);
+    int i;
+
+    for (i = 0; i < n; i++) {
+        if (caller_id && *caller_id) {
+            if (!jsr211_index_access_allowed(found[i], caller_id)) continue;
+        }
+        if (append_handler(found[i], result)) return JSR211_FAILED;
+    }
+    return JSR211_OK;
+}
+
+/**
+ * Context of the ID conflicts search.
+ */
+typedef struct {
+    javacall_const_utf16_string caller_id;
+    JSR211_RESULT_CHARRAY result;
+} FIND_CONTEXT;
+
+/**
+ * Trie visitor appending handlers accessible for the caller to the result.
+ */
+static jsr211_result append_accessible(jsr211_index_handler* h, void* ctx) {
+    FIND_CONTEXT* find = (FIND_CONTEXT*)ctx;
+    if (find->caller_id && *find->caller_id) {
+        if (!jsr211_index_access_allowed(h, find->caller_id)) return JSR211_OK;
+    }
+    return append_handler(h, find->result);
 }
 
 /**
@@ -195,59 +506,127 @@ jsr211_result jsr211_find_handler(javacall_const_utf16_string caller_id,
                         jsr211_field key, javacall_const_utf16_string value,
                         /*OUT*/ JSR211_RESULT_CHARRAY result) {
 
-    int pos = 0;
-    jchar* buffer = NULL;
-    int len, maxlen = MAX_BUFFER;
-    int res = JSR211_OK;
-    int enum_by_id_prefix = -1/*TRUE*/;
+    if (JSR211_OK != jsr211_index_assure()) return JSR211_FAILED;
 
-    buffer = (jchar*) JAVAME_MALLOC(maxlen*sizeof(*buffer));
+    if (key != JSR211_FIELD_ID) {
+        return find_indexed_handler(caller_id, key, value, result);
+    }
 
-    while (buffer){
-        len = maxlen;
-        if (key == JSR211_FIELD_TYPES) {
-            res = javacall_chapi_enum_handlers_by_type(value,&pos,buffer,&len);
-        } else if (key == JSR211_FIELD_SUFFIXES) {
-            res = javacall_chapi_enum_handlers_by_suffix(value,&pos,buffer,&len);
-        } else if (key == JSR211_FIELD_ACTIONS) {
-            res = javacall_chapi_enum_handlers_by_action(value,&pos,buffer,&len);
-        } else if (key == JSR211_FIELD_ID){
-            /* a special case: we should find all handlers names conflicted with value parameter.
-               caller_id parameter should be NULL in this case
-            */
-            if( enum_by_id_prefix ){
-                res = javacall_chapi_enum_handlers_by_prefix(value,&pos,buffer,&len);
-                if( JAVACALL_CHAPI_ERROR_NO_MORE_ELEMENTS == res ){
-                    javacall_chapi_enum_finish(pos);
-                    enum_by_id_prefix = 0/*FALSE*/;
-                    pos = 0;
-                    continue;
-                }
-            } else {
-                res = javacall_chapi_enum_handlers_prefixes_of(value,&pos,buffer,&len);
-            }
-        }
+    /* a special case: we should find all handlers names conflicted with value parameter,
+       i.e. the names which are prefixes of the value or have it as a prefix.
+       caller_id parameter should be NULL in this case
+    */
+    {
+        FIND_CONTEXT ctx;
+        ctx.caller_id = caller_id;
+        ctx.result = result;
+        return jsr211_trie_conflicts(value, wcslen(value), append_accessible, &ctx);
+    }
+}
 
-        ASSURE_BUF(buffer,len,maxlen);
+/**
+ * Opens the cursor paging through the handlers registered for the given
+ * type, suffix or action.
+ *
+ * @param caller_id calling application identifier
+ * @param key search field id: JSR211_FIELD_TYPES, JSR211_FIELD_SUFFIXES
+ * or JSR211_FIELD_ACTIONS
+ * @param value search value
+ * @param cursor output value - the cursor handle
+ * @return status of the operation
+ */
+jsr211_result jsr211_cursor_open(javacall_const_utf16_string caller_id,
+                        jsr211_field key, javacall_const_utf16_string value,
+                        /*OUT*/ int* cursor) {
+    FIND_CURSOR* c = &cursors[0];
+    int i;
 
-        if (res) break;
+    if (key != JSR211_FIELD_TYPES && key != JSR211_FIELD_SUFFIXES &&
+            key != JSR211_FIELD_ACTIONS) {
+        return JSR211_FAILED;
+    }
 
-        if (!jsr211_isUniqueHandler(buffer, len - 1, result)) continue;
+    // a free slot or the least recently used one
+    for (i = 0; i < CURSOR_COUNT && c->handle != 0; i++) {
+        if (cursors[i].handle == 0 || cursors[i].used < c->used) c = &cursors[i];
+    }
+    free_cursor(c);
 
-        if (caller_id && *caller_id) {
-            if (!javacall_chapi_is_access_allowed(buffer,caller_id)) continue;
-        }
+    c->value = copy_string(value);
+    c->caller_id = (caller_id && *caller_id)? copy_string(caller_id): NULL;
+    if (c->value == NULL || ((caller_id && *caller_id) && c->caller_id == NULL)) {
+        free_cursor(c);
+        return JSR211_FAILED;
+    }
+    c->field = key;
+    c->generation = registry_generation;
+    c->used = ++cursor_clock;
+    // the slot number is kept in the low bits, so stale handles are detected
+    c->handle = (++cursor_serial & 0xFFFFF) * CURSOR_COUNT + (c - cursors) + 1;
+    *cursor = c->handle;
+    return JSR211_OK;
+}
 
-        res = append_handler(buffer, result);
-        if (res) break;
-    } 
+/**
+ * Returns the next page of the cursor. The page is empty when the cursor
+ * is exhausted. The handlers are returned in the order of their IDs, so
+ * the handlers registered or unregistered between the pages neither
+ * shift nor repeat the rest of the result.
+ *
+ * @param cursor the cursor handle
+ * @param max_count maximum number of handlers in the page
+ * @param result output value - the found handlers array
+ * @return status of the operation, JSR211_FAILED if the cursor is not open,
+ * e.g. it has been reclaimed, or no memory available
+ */
+jsr211_result jsr211_cursor_next(int cursor, int max_count,
+                        /*OUT*/ JSR211_RESULT_CHARRAY result) {
+    FIND_CURSOR* c = &cursors[(cursor - 1) & (CURSOR_COUNT - 1)];
+    jsr211_index_handler* const* found;
+    int n, start, count = 0;
+
+    if (cursor <= 0 || c->handle != cursor) return JSR211_FAILED;
+    if (JSR211_OK != jsr211_index_assure()) return JSR211_FAILED;
+    c->used = ++cursor_clock;
+
+    n = jsr211_index_lookup(c->field, c->value, &found);
+    if (c->generation != registry_generation) {
+        // the list has changed: continue after the last passed handler,
+        // even if it is not registered any more
+        if (c->last_id != NULL) {
+            c->next = jsr211_index_position_after(found, n, c->last_id);
+        }
+        c->generation = registry_generation;
+    }
 
-    javacall_chapi_enum_finish(pos);
+    for (start = c->next; c->next < n && count < max_count; c->next++) {
+        if (c->caller_id != NULL) {
+            if (!jsr211_index_access_allowed(found[c->next], c->caller_id)) continue;
+        }
+        if (append_handler(found[c->next], result)) return JSR211_FAILED;
+        count++;
+    }
 
-    if (buffer == NULL) return JSR211_FAILED; //out of memory
-    JAVAME_FREE(buffer);
+    if (c->next > start) {
+        if (c->last_id != NULL) JAVAME_FREE(c->last_id);
+        c->last_id = copy_string(found[c->next - 1]->id);
+        if (c->last_id == NULL) {
+            // the position could not be restored later
+            free_cursor(c);
+            return JSR211_FAILED;
+        }
+    }
+    return JSR211_OK;
+}
 
-    return (res==JAVACALL_CHAPI_ERROR_NO_MORE_ELEMENTS)?JSR211_OK:JSR211_FAILED;
+/**
+ * Closes the cursor. Closing a cursor that is not open has no effect.
+ *
+ * @param cursor the cursor handle
+ */
+void jsr211_cursor_close(int cursor) {
+    FIND_CURSOR* c = &cursors[(cursor - 1) & (CURSOR_COUNT - 1)];
+    if (cursor > 0 && c->handle == cursor) free_cursor(c);
 }
 
 /**
@@ -260,101 +639,152 @@ jsr211_result jsr211_find_handler(javacall_const_utf16_string caller_id,
  * @return status of the operation
  */
 jsr211_result jsr211_find_for_suite( SuiteIdType suiteId, /*OUT*/ JSR211_RESULT_CHARRAY result){
-    int pos = 0;
-    jchar* buffer = NULL;
-    int len, maxlen = MAX_BUFFER;
-    int res;
+    jsr211_index_enum pos = JSR211_INDEX_ENUM_INITIALIZER;
+    jsr211_index_handler* h;
     jchar suiteID[ 0x20 ];  // enough
+    size_t len;
+
+    if (JSR211_OK != jsr211_index_assure()) return JSR211_FAILED;
+
     jsrop_suiteid_to_string(suiteId, suiteID);
+    len = wcslen(suiteID);
 
-    buffer = (jchar*) JAVAME_MALLOC(maxlen*sizeof(*buffer));
+    while ((h = jsr211_index_next(&pos)) != NULL) {
+        if (h->suite_id_len != len || memcmp(h->suite_id, suiteID, len * sizeof(jchar))) continue;
+        if (append_handler(h, result)) return JSR211_FAILED;
+    }
 
-    pos=0;
-    while (buffer){
-        len = maxlen;
-        res = javacall_chapi_enum_handlers_by_suite_id( suiteID, &pos, buffer, &len );
+    return JSR211_OK;
+}
 
-        ASSURE_BUF(buffer, len, maxlen);
-        if (res) break;
 
-        if (!jsr211_isUniqueHandler(buffer,len - 1, result)) continue;
+/**
+ * Checks whether the handler is in the array.
+ */
+static int contains_handler(jsr211_index_handler* const* handlers, int n,
+                                        const jsr211_index_handler* h) {
+    while (n--) {
+        if (*handlers++ == h) return 1;
+    }
+    return 0;
+}
 
-        res = append_handler(buffer, result);
-        if (res) break;
-    } 
+/**
+ * Matches the URL suffixes against the registered handlers, the longest
+ * suffix first. If the result array is NULL the search stops at the first
+ * suitable handler, which is returned in <code>first</code>.
+ */
+static jsr211_result match_URL(
+        javacall_const_utf16_string caller_id,
+        javacall_const_utf16_string url,
+        javacall_const_utf16_string action,
+        /*OUT*/ jsr211_index_handler** first,
+        /*OUT*/ JSR211_RESULT_CHARRAY result){
+    jsr211_index_handler* const* found;
+    jsr211_index_handler* const* actions = NULL;
+    int nactions = 0;
+    javacall_const_utf16_string name, end;
+    jchar* path;
+    int len, maxlen;
+    int i, n, pos;
+
+    if (JSR211_OK != jsr211_index_assure()) return JSR211_FAILED;
+
+    // the file name is the last segment of the path, the query and the fragment are skipped
+    for (name = end = url; *end && *end != '?' && *end != '#'; end++) {
+        if (*end == '/') name = end + 1;
+    }
+    len = end - name;
 
-    javacall_chapi_enum_finish(pos);
+    path = jsr211_scratch_get(JSR211_SCRATCH_PRIMARY, &maxlen);
+    if (path != NULL && len >= maxlen) {
+        path = jsr211_scratch_grow(JSR211_SCRATCH_PRIMARY, len + 1, &maxlen);
+    }
+    if (path == NULL) return JSR211_FAILED;
+    memcpy(path, name, len * sizeof(jchar));
+    path[len] = 0;
+
+    if (action != NULL) {
+        nactions = jsr211_index_lookup(JSR211_FIELD_ACTIONS, action, &actions);
+    }
 
-    if (!buffer) return JSR211_FAILED; //out of memory
-    JAVAME_FREE(buffer);
+    for (pos = 0; pos < len; pos++) {
+        if (path[pos] != '.') continue;
 
-    return (res==JAVACALL_CHAPI_ERROR_NO_MORE_ELEMENTS)?JSR211_OK:JSR211_FAILED;
-}
+        n = jsr211_index_lookup(JSR211_FIELD_SUFFIXES, path + pos, &found);
+        for (i = 0; i < n; i++) {
+            if (action != NULL && !contains_handler(actions, nactions, found[i])) continue;
+            if (caller_id && *caller_id) {
+                if (!jsr211_index_access_allowed(found[i], caller_id)) continue;
+            }
+            if (result == NULL) {
+                *first = found[i];
+                return JSR211_OK;
+            }
+            // the handler is ranked already by a longer suffix
+            if (!jsr211_isUniqueHandler(found[i]->id, found[i]->id_len, result)) continue;
+            if (append_handler(found[i], result)) return JSR211_FAILED;
+        }
+    }
 
+    return JSR211_OK;
+}
 
-/* *
- * Searches content handler using content URL. This function MUST define
- * content type and return default handler for this type if any.
+/**
+ * Searches content handler using content URL. The handler of the longest
+ * matching suffix is returned.
  *
  * @param caller_id calling application identifier
  * @param url content URL
- * @param action requested action
+ * @param action requested action, NULL if any action is suitable
  * @param handler output parameter - the handler conformed with requested URL 
  * and action.
  *  <br>Use the @link jsr211_fillHandler() jsr211_fillHandler function to fill this structure.
- * @return status of the operation
- * /
+ * @return JSR211_OK if the appropriate handler found
+ */
 jsr211_result jsr211_handler_by_URL(
         javacall_const_utf16_string caller_id,
         javacall_const_utf16_string url,
         javacall_const_utf16_string action,
-        /*OUT* / JSR211_RESULT_CH result){
-    
-//find suffix
-int pos = 0;
-jchar* buffer = NULL;
-int len, maxlen = MAX_BUFFER;
-int res, found = 0;
-javacall_const_utf16_string suffix;
-
-buffer = (jchar*) JAVAME_MALLOC(maxlen*sizeof(*buffer));
-if (!buffer) return JSR211_FAILED;
-
-suffix=(javacall_const_utf16_string)wcsrchr(url,'.');
-
-// enum by suffix
-    while (buffer && suffix && !found){
-        len = maxlen;
-        res = javacall_chapi_enum_handlers_by_suffix(suffix,&pos,buffer,&len);
-
-        ASSURE_BUF(buffer, len,maxlen);
-
-        if (res) break;
-
-        if (caller_id && *caller_id) {
-            if (!javacall_chapi_is_access_allowed(buffer,caller_id)) continue;
-        }
-
-        if (action != NULL && !javacall_chapi_is_action_supported(buffer,action)) continue;
+        /*OUT*/ JSR211_RESULT_CH handler){
+    jsr211_index_handler* h = NULL;
 
-        res = fill_handler(buffer, result);
-        if (res) break;
-
-        found = 1;
-    } 
-    javacall_chapi_enum_finish(pos);
-
-    if (buffer) JAVAME_FREE(buffer);
+    if (JSR211_OK != match_URL(caller_id, url, action, &h, NULL) || h == NULL) {
+        return JSR211_FAILED;
+    }
+    return fill_handler(h, handler);
+}
 
-    return (found)?JSR211_OK:JSR211_FAILED;
+/**
+ * Searches content handlers using content URL. The suffix is taken from
+ * the last segment of the URL path and may contain several dots, e.g.
+ * <code>.tar.gz</code>. Suffixes are matched case-insensitively starting
+ * from the longest one, so the handlers of the longest matching suffix are
+ * ranked first.
+ *
+ * @param caller_id calling application identifier
+ * @param url content URL
+ * @param action requested action, NULL if any action is suitable
+ * @param result output value - the handlers conformed with requested URL
+ * and action.
+ *  <br>Use the @link jsr211_appendHandler() jsr211_appendHandler function to fill this structure.
+ * @return status of the operation
+ */
+jsr211_result jsr211_handlers_by_URL(
+        javacall_const_utf16_string caller_id,
+        javacall_const_utf16_string url,
+        javacall_const_utf16_string action,
+        /*OUT*/ JSR211_RESULT_CHARRAY result){
+    return match_URL(caller_id, url, action, NULL, result);
 }
-*/
 
 /**
  * Returns all found values for specified field. Tha allowed fields are: <ul>
  *    <li> JSR211_CHAPI_FIELD_ID, <li> JSR211_CHAPI_FIELD_TYPES, <li> JSR211_CHAPI_FIELD_SUFFIXES,
  *    <li> and JSR211_CHAPI_FIELD_ACTIONS. </ul>
  * Values should be selected only from handlers accessible for given caller_id.
+ * The distinct values are kept by the registry index, so the values are
+ * serialized without deduplication.
  *
  * @param caller_id calling application identifier.
  * @param field search field id
@@ -367,85 +797,44 @@ jsr211_result jsr211_get_all(
         jsr211_field field, 
         /*OUT*/ JSR211_RESULT_STRARRAY result){
 
-    int res = JSR211_OK;
-
-    int handlerlen, handlermaxlen = MAX_BUFFER;
-    jchar* handler=NULL;
-    int hpos = 0;
-
-    int valuelen, valuemaxlen = MAX_BUFFER;
-    jchar* value=NULL;
-    int vpos;
-
-    if (caller_id || (field == JSR211_FIELD_ID)){
-        handler = (jchar*) JAVAME_REALLOC(
-            handler,handlermaxlen * sizeof(*handler));
-        if (!handler) {
-            return JSR211_FAILED;
-        }
-    }
-
-    if (field != JSR211_FIELD_ID){
-        value = JAVAME_MALLOC(valuemaxlen*sizeof(*value));
-        if (!value) {
-            if(handler) JAVAME_FREE(handler);
-            return JSR211_FAILED;
-        }
-    }
-
-    while (1){
-        if (caller_id || (field == JSR211_FIELD_ID)){
-
-            handlerlen = handlermaxlen;
-
-            res = javacall_chapi_enum_handlers(&hpos,handler,&handlerlen);
-
-            ASSURE_BUF(handler, handlerlen,handlermaxlen);
-            if (!handler) break;
-
-            if (res) break;
-
-            if (caller_id) {
-                if (!javacall_chapi_is_access_allowed(handler,caller_id)) continue;
+    jsr211_result status = JSR211_OK;
+    jsr211_index_handler* const* handlers;
+    jsr211_index_handler* h;
+    const jchar* value;
+    size_t len;
+    int i, j, n;
+
+    if (JSR211_OK != jsr211_index_assure()) return JSR211_FAILED;
+
+    if (field == JSR211_FIELD_ID) {
+        if (caller_id) {
+            n = jsr211_index_visible(caller_id, &handlers);
+            if (n < 0) return JSR211_FAILED;
+            for (i = 0; i < n && status == JSR211_OK; i++) {
+                status = jsr211_appendString(handlers[i]->id, handlers[i]->id_len, result);
             }
-
-            if (field == JSR211_FIELD_ID) {
-                res = jsr211_appendUniqueString(handler,handlerlen - 1, 0 ,result);
-                continue;
+        } else {
+            jsr211_index_enum pos = JSR211_INDEX_ENUM_INITIALIZER;
+            while (status == JSR211_OK && (h = jsr211_index_next(&pos)) != NULL) {
+                status = jsr211_appendString(h->id, h->id_len, result);
             }
         }
+        return status;
+    }
 
-        vpos = 0;
-        if (!res) while (1){
-
-            valuelen = valuemaxlen;
-
-            if (field == JSR211_FIELD_ACTIONS) {
-                res = javacall_chapi_enum_actions(handler,&vpos, value, &valuelen);
-            } else if (field == JSR211_FIELD_TYPES) {
-                res = javacall_chapi_enum_types(handler,&vpos, value, &valuelen);
-            } else if (field == JSR211_FIELD_SUFFIXES) {
-                res = javacall_chapi_enum_suffixes(handler,&vpos, value, &valuelen);
+    for (i = 0; i < jsr211_index_value_count(field) && status == JSR211_OK; i++) {
+        n = jsr211_index_value(field, i, &value, &len, &handlers);
+        if (caller_id) {
+            // the value is visible if any of its handlers is accessible
+            for (j = 0; j < n; j++) {
+                if (jsr211_index_access_allowed(handlers[j], caller_id)) break;
             }
-
-            ASSURE_BUF(value, valuelen,valuemaxlen);            
-            if (!value) break;
-
-            if (res) break;
-
-            res = jsr211_appendUniqueString(value,valuelen - 1,field == JSR211_FIELD_ACTIONS, result);
-            if (res) break;
+            if (j == n) continue;
         }
-        javacall_chapi_enum_finish(vpos);
-
-        if (!handler) break;
-    } 
-    javacall_chapi_enum_finish(hpos);
-
-    if(handler) JAVAME_FREE(handler);
-    if(value) JAVAME_FREE(value);
+        status = jsr211_appendString(value, len, result);
+    }
 
-    return (handler && value && (res==JAVACALL_CHAPI_ERROR_NO_MORE_ELEMENTS))?JSR211_OK:JSR211_FAILED;
+    return status;
 }
 
 /**
@@ -469,112 +858,130 @@ jsr211_result jsr211_get_handler(
         jsr211_search_flag search_flag,
         /*OUT*/ JSR211_RESULT_CH result){
 
-    int res = JAVACALL_CHAPI_ERROR_NOT_FOUND;
+    jsr211_index_handler* h = NULL;
+
+    if (JSR211_OK != jsr211_index_assure()) return JSR211_FAILED;
 
     if (search_flag==JSR211_SEARCH_EXACT){
-        if (javacall_chapi_is_access_allowed(id,caller_id)){
-            res = fill_handler(id, result);
-        }
+        h = jsr211_index_get(id);
     } else {
-        int pos = 0;
-        int len, maxlen = MAX_BUFFER;
-        jchar* buffer = (jchar*) JAVAME_MALLOC(maxlen * sizeof(*buffer));
-        while (buffer){
-            len = maxlen;
-            res = javacall_chapi_enum_handlers_prefixes_of(id, &pos, buffer, &len);
-            ASSURE_BUF(buffer,len,maxlen);
-            if (res) break;
-            if (javacall_chapi_is_access_allowed(buffer, caller_id)){
-                res = fill_handler(buffer, result);
-            }
-            break;
-        }
-        javacall_chapi_enum_finish(pos);
-        if (buffer) JAVAME_FREE(buffer);
+        h = jsr211_trie_prefix_of(id, wcslen(id));
     }
 
-    return (res==JAVACALL_OK)?JSR211_OK:JSR211_FAILED;
-}
-
+    if (h == NULL || !jsr211_index_access_allowed(h, caller_id)) {
+        return JSR211_FAILED;
+    }
 
-static int get_action_map(javacall_const_utf16_string id, /*OUT*/ JSR211_RESULT_STRARRAY result){
-    int apos = 0;
-    jchar* abuffer = NULL;
-    int alen, alenmax =MAX_BUFFER;
+    return fill_handler(h, result);
+}
 
-    int lpos;
-    jchar* lbuffer = NULL;
-    int llen, llenmax = MAX_BUFFER;
 
-    jchar* lnbuffer = NULL;
-    int lnlen, lnlenmax = MAX_BUFFER;
+/**
+ * Copies the string of the result array to the scratch buffer and
+ * terminates it with zero.
+ */
+static const jchar* scratch_string(jsr211_scratch_buffer scratch, JSR211_BUFFER_DATA item){
+    const void* data;
+    size_t length;
+    int maxlen;
+    jchar* str = jsr211_scratch_get(scratch, &maxlen);
+
+    jsr211_get_data(item, &data, &length);
+    length /= sizeof(jchar);
+    if (str != NULL && (int)length >= maxlen) {
+        str = jsr211_scratch_grow(scratch, length + 1, &maxlen);
+    }
+    if (str != NULL) {
+        memcpy(str, data, length * sizeof(jchar));
+        str[length] = 0;
+    }
+    return str;
+}
 
+/**
+ * Reads the handler action map from the backend. The map is the locales
+ * by actions table of the action names, the locales and the actions are
+ * ordered as the JSR211_FIELD_LOCALES and JSR211_FIELD_ACTIONS values of
+ * the handler. An action without localized name is named by itself.
+ */
+static jsr211_result load_action_map(javacall_const_utf16_string id,
+                                        /*OUT*/ JSR211_RESULT_STRARRAY map){
+    JSR211_RESULT_BUFFER locales = jsr211_create_result_buffer();
+    JSR211_RESULT_BUFFER actions = jsr211_create_result_buffer();
+    JSR211_ENUM_HANDLE leh, aeh;
+    JSR211_BUFFER_DATA l, a;
+    const jchar *locale, *action;
+    jchar* name;
+    int len, maxlen;
     int res;
+    jsr211_result status = JSR211_FAILED;
 
-    JSR211_RESULT_BUFFER locales_array = jsr211_create_result_buffer(), actions_array;
-    
-    abuffer = (jchar*) JAVAME_MALLOC(alenmax * sizeof(*abuffer));
-    lbuffer = (jchar*) JAVAME_MALLOC(llenmax * sizeof(*lbuffer));
-    lnbuffer = (jchar*) JAVAME_MALLOC(lnlenmax * sizeof(*lnbuffer));
-
-    lpos=0;
-    while (locales_array && abuffer && lbuffer && lnbuffer){
-        llen = llenmax;
-        res = javacall_chapi_enum_action_locales(id,&lpos,lbuffer,&llen);
-        ASSURE_BUF(lbuffer,llen,llenmax);
-        if (res) break;
-        if (!jsr211_isUniqueString(lbuffer,llen - 1,0, &locales_array)){
-            continue;
+    if (locales && actions &&
+            JSR211_OK == jsr211_get_handler_field(id, JSR211_FIELD_LOCALES, &locales) &&
+            JSR211_OK == jsr211_get_handler_field(id, JSR211_FIELD_ACTIONS, &actions)) {
+        status = JSR211_OK;
+        leh = jsr211_get_enum_handle(jsr211_get_result_data(locales));
+        while (status == JSR211_OK && (l = jsr211_get_next(&leh)) != NULL) {
+            aeh = jsr211_get_enum_handle(jsr211_get_result_data(actions));
+            while (status == JSR211_OK && (a = jsr211_get_next(&aeh)) != NULL) {
+                locale = scratch_string(JSR211_SCRATCH_PRIMARY, l);
+                action = scratch_string(JSR211_SCRATCH_SECONDARY, a);
+                name = jsr211_scratch_get(JSR211_SCRATCH_TERTIARY, &maxlen);
+                while (locale && action && name) {
+                    len = maxlen;
+                    res = javacall_chapi_get_local_action_name(id, action, locale, name, &len);
+                    ASSURE_BUF(JSR211_SCRATCH_TERTIARY, name, len, maxlen);
+                    break;
+                }
+                if (!locale || !action || !name) {
+                    status = JSR211_FAILED;
+                } else if (res == JAVACALL_OK) {
+                    status = jsr211_appendString(name, len - 1, map);
+                } else {
+                    status = jsr211_appendString(action, wcslen(action), map);
+                }
+            }
         }
-        res = jsr211_appendString(lbuffer,llen - 1, &locales_array);
+    }
 
-        actions_array = jsr211_create_result_buffer();
-        if (!actions_array){
-            res = JAVACALL_CHAPI_ERROR_NO_MEMORY;
-            break;
-        }
-        apos=0;
-        while (abuffer && lnbuffer){
-            alen = alenmax;
-            res = javacall_chapi_enum_actions(id,&apos,abuffer,&alen);
-            ASSURE_BUF(abuffer,alen,alenmax);
-            if (res) {
-                if (res==JAVACALL_CHAPI_ERROR_NO_MORE_ELEMENTS) res = JAVACALL_OK;
-                break;
-            }
-            if (!jsr211_isUniqueString(abuffer,alen - 1 ,0, &actions_array)){
-                continue;
-            }
-            res = jsr211_appendString(abuffer,alen - 1, &actions_array);
-            if (res) break; 
-
-            while (lnbuffer){
-                lnlen = lnlenmax;
-                res = javacall_chapi_get_local_action_name(id,abuffer,lbuffer,lnbuffer,&lnlen);
-                ASSURE_BUF(lnbuffer,lnlen,lnlenmax);
-                break;
-            }
+    if (locales) jsr211_release_result_buffer(locales);
+    if (actions) jsr211_release_result_buffer(actions);
 
-            if (!res) 
-                res = jsr211_appendString(lnbuffer,lnlen - 1, result);
-            else 
-                res = jsr211_appendString(abuffer,alen - 1, result);
-        }
+    return status;
+}
 
-        javacall_chapi_enum_finish(apos);
-        if (actions_array) jsr211_release_result_buffer(actions_array);
-        if (res) break;
+/**
+ * Returns the handler action map. The map read from the backend is cached
+ * by the index for the few recently used handlers, next requests for them
+ * are served with a single copy.
+ */
+static jsr211_result get_action_map(javacall_const_utf16_string id,
+                                        /*OUT*/ JSR211_RESULT_STRARRAY result){
+    jsr211_index_handler* h = NULL;
+    JSR211_RESULT_BUFFER map;
+    jsr211_result status;
+
+    if (JSR211_OK == jsr211_index_assure()) {
+        h = jsr211_index_get(id);
+        if (h != NULL && (map = jsr211_index_action_map(h)) != NULL) {
+            return jsr211_appendStrings(map, result);
+        }
     }
 
-    javacall_chapi_enum_finish(lpos);
-
-    if (abuffer) JAVAME_FREE(abuffer);
-    if (lbuffer) JAVAME_FREE(lbuffer);
-    if (lnbuffer) JAVAME_FREE(lnbuffer);
+    map = jsr211_create_result_buffer();
+    if (map == NULL) return JSR211_FAILED;
 
-    if (locales_array) jsr211_release_result_buffer(locales_array);
+    status = load_action_map(id, &map);
+    if (status == JSR211_OK) {
+        status = jsr211_appendStrings(map, result);
+    }
 
-    return (res==JAVACALL_CHAPI_ERROR_NO_MORE_ELEMENTS)?JSR211_OK:JSR211_FAILED;
+    if (status == JSR211_OK && h != NULL) {
+        jsr211_index_cache_action_map(h, map);
+    } else {
+        jsr211_release_result_buffer(map);
+    }
+    return status;
 }
 
 /**
@@ -594,14 +1001,14 @@ jsr211_result jsr211_get_handler_field(javacall_const_utf16_string id,
                              /*OUT*/ JSR211_RESULT_STRARRAY result){
     int pos = 0;
     jchar* buffer;
-    int len, maxlen = MAX_BUFFER;
+    int len, maxlen;
     int res;
 
     if (field_id == JSR211_FIELD_ACTION_MAP) {
         return get_action_map(id,result);
     }
 
-    buffer = (jchar*) JAVAME_MALLOC(maxlen * sizeof(*buffer));
+    buffer = jsr211_scratch_get(JSR211_SCRATCH_PRIMARY, &maxlen);
 
     pos=0;
     while (buffer){
@@ -619,7 +1026,7 @@ jsr211_result jsr211_get_handler_field(javacall_const_utf16_string id,
             res = javacall_chapi_enum_access_allowed_callers(id,&pos,buffer,&len);
         }
 
-        ASSURE_BUF(buffer,len, maxlen);
+        ASSURE_BUF(JSR211_SCRATCH_PRIMARY, buffer, len, maxlen);
         if (res) break;
         if (field_id == JSR211_FIELD_ACCESSES){
             res = jsr211_appendString(buffer,len - 1, result);
@@ -631,7 +1038,6 @@ jsr211_result jsr211_get_handler_field(javacall_const_utf16_string id,
     javacall_chapi_enum_finish(pos);
 
     if (!buffer) return JSR211_FAILED;
-    JAVAME_FREE(buffer);
 
     return (res==JAVACALL_CHAPI_ERROR_NO_MORE_ELEMENTS)?JSR211_OK:JSR211_FAILED;
 }
@@ -0,0 +1,1035 @@
+/*
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation. 
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt). 
+ * 
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA 
+ * 
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions. 
+ */
+
+
+/**
+ * @file
+ * @brief In-memory index of the content handler registry.
+ */
+
+#include <string.h>
+
+#include <jsrop_memory.h>
+
+#include "javacall_chapi_registry.h"
+#include "jsr211_registry_index.h"
+#include "jsr211_id_trie.h"
+#include "jsr211_registry_image.h"
+#include "jsr211_jchars.h"
+
+/** Number of hash buckets, MUST be a power of two */
+#define INDEX_HASH_SIZE 0x100
+
+/** Bucket number for the hash code */
+#define INDEX_BUCKET(hash) ((hash) & (INDEX_HASH_SIZE - 1))
+
+/** Granularity of the handler list growth */
+#define INDEX_LIST_GRANULARITY 4
+
+/** Initial size of the scratch buffers */
+#define SCRATCH_BUFFER 128
+
+/** Maximum number of callers in the access cache */
+#define ACCESS_CALLER_MAX 16
+
+/** Maximum number of cached action maps */
+#define ACTION_MAP_MAX 8
+
+/**
+ * Indexed value of a handler field and the list of handlers declaring it.
+ * Every key is also kept in the array of distinct values of its field.
+ */
+typedef struct _jsr211_index_key {
+    struct _jsr211_index_key* next;     /* next key in the hash chain */
+    jsr211_field            field;      /* field the value belongs to */
+    int                     slot;       /* position in the distinct values array */
+    unsigned int            hash;       /* hash code of the value */
+    size_t                  len;        /* value length in jchars */
+    jchar*                  value;      /* the value as first registered */
+    jchar*                  key;        /* the matching key of the value */
+    int                     count;      /* number of handlers, the reference count */
+    int                     capacity;   /* capacity of the handlers array */
+    jsr211_index_handler**  handlers;   /* handlers declaring the value, sorted by ID */
+} INDEX_KEY;
+
+/**
+ * Calling application known to the access cache. The slot is reused for
+ * another caller when the least recently used one is evicted.
+ */
+typedef struct _ACCESS_CALLER {
+    int                     serial;     /* changed when the slot is reused */
+    int                     used;       /* time of the last use, for eviction */
+    unsigned int            hash;       /* hash code of the ID */
+    size_t                  len;        /* ID length in jchars */
+    jchar*                  id;         /* the caller ID, NULL if the slot is free */
+    int                     visible_stamp;  /* index stamp of the visible set */
+    int                     visible_count;  /* number of visible handlers */
+    int                     visible_capacity;
+    jsr211_index_handler**  visible;    /* handlers accessible for the caller */
+} ACCESS_CALLER;
+
+/**
+ * Access decision cached in the handler record.
+ */
+struct _jsr211_access_decision {
+    struct _jsr211_access_decision* next;
+    ACCESS_CALLER*          caller;
+    int                     serial;     /* caller serial, stale if it differs */
+    jsr211_boolean          allowed;
+};
+
+static INDEX_KEY* index_keys[INDEX_HASH_SIZE];
+static jsr211_index_handler* index_handlers[INDEX_HASH_SIZE];
+static ACCESS_CALLER access_callers[ACCESS_CALLER_MAX];
+static int access_clock = 0;
+/** Handlers with cached action maps, the most recently used is the last */
+static jsr211_index_handler* action_map_owners[ACTION_MAP_MAX];
+static int action_map_count = 0;
+static INDEX_KEY** value_keys[JSR211_FIELD_COUNT];
+static int value_count[JSR211_FIELD_COUNT];
+static int value_capacity[JSR211_FIELD_COUNT];
+static int index_valid = 0;
+
+/** Incremented on every index modification */
+static int index_stamp = 0;
+
+static jchar* scratch[JSR211_SCRATCH_COUNT];
+static int scratch_len[JSR211_SCRATCH_COUNT];
+static int scratch_growths = 0;
+
+/**
+ * Only actions are matched case sensitively.
+ */
+#define IS_CASE_SENSITIVE(field) ((field) == JSR211_FIELD_ACTIONS)
+
+/**
+ * Returns the matching key of the field value: the value itself for the
+ * case-sensitive field, otherwise the value folded to the key scratch
+ * buffer.
+ */
+static const jchar* match_key(jsr211_field field, const jchar* value, size_t len) {
+    jchar* key;
+    int maxlen;
+
+    if (IS_CASE_SENSITIVE(field)) return value;
+    key = jsr211_scratch_get(JSR211_SCRATCH_KEY, &maxlen);
+    if (key != NULL && (int)len > maxlen) {
+        key = jsr211_scratch_grow(JSR211_SCRATCH_KEY, len, &maxlen);
+    }
+    if (key != NULL) {
+        jsr211_fold_string(value, len, key);
+    }
+    return key;
+}
+
+static INDEX_KEY* find_key(jsr211_field field, const jchar* match,
+                                            size_t len, unsigned int hash) {
+    INDEX_KEY* key = index_keys[INDEX_BUCKET(hash)];
+    for (; key != NULL; key = key->next) {
+        if (key->hash == hash && key->field == field && key->len == len &&
+                memcmp(key->key, match, len * sizeof(jchar)) == 0) {
+            break;
+        }
+    }
+    return key;
+}
+
+static void free_key(INDEX_KEY* key) {
+    if (key->handlers) JAVAME_FREE(key->handlers);
+    JAVAME_FREE(key);
+}
+
+/**
+ * Appends the new key to the distinct values of its field.
+ */
+static jsr211_result add_value(INDEX_KEY* key) {
+    jsr211_field f = key->field;
+    if (value_count[f] == value_capacity[f]) {
+        int capacity = value_capacity[f]? 2 * value_capacity[f]: 4 * INDEX_LIST_GRANULARITY;
+        INDEX_KEY** tmp = (INDEX_KEY**)JAVAME_REALLOC(value_keys[f], capacity * sizeof(*tmp));
+        if (tmp == NULL) return JSR211_FAILED;
+        value_keys[f] = tmp;
+        value_capacity[f] = capacity;
+    }
+    key->slot = value_count[f];
+    value_keys[f][value_count[f]++] = key;
+    return JSR211_OK;
+}
+
+/**
+ * Removes the key from the distinct values of its field. The last value
+ * takes the vacated slot.
+ */
+static void remove_value(INDEX_KEY* key) {
+    jsr211_field f = key->field;
+    INDEX_KEY* last = value_keys[f][--value_count[f]];
+    value_keys[f][key->slot] = last;
+    last->slot = key->slot;
+}
+
+/**
+ * Finds the handler in the action map owners.
+ */
+static int action_map_slot(jsr211_index_handler* h) {
+    int i = action_map_count;
+    while (--i >= 0 && action_map_owners[i] != h);
+    return i;
+}
+
+/**
+ * Removes the owner from the given position and releases its action map.
+ */
+static void drop_action_map(int slot) {
+    jsr211_index_handler* h = action_map_owners[slot];
+    jsr211_release_result_buffer(h->action_map);
+    h->action_map = NULL;
+    memmove(action_map_owners + slot, action_map_owners + slot + 1,
+                (--action_map_count - slot) * sizeof(action_map_owners[0]));
+}
+
+static void free_handler(jsr211_index_handler* h) {
+    while (h->access != NULL) {
+        struct _jsr211_access_decision* d = h->access;
+        h->access = d->next;
+        JAVAME_FREE(d);
+    }
+    if (h->action_map != NULL) drop_action_map(action_map_slot(h));
+    if (h->keys != NULL) JAVAME_FREE(h->keys);
+    JAVAME_FREE(h);
+}
+
+/**
+ * Finds the caller in the access cache, adds it if it is not known yet.
+ * When the cache is full the least recently used caller is evicted; its
+ * decisions become stale and are dropped when the handlers are checked.
+ */
+static ACCESS_CALLER* intern_caller(const jchar* caller_id) {
+    size_t len = wcslen(caller_id);
+    unsigned int hash = jsr211_hash_key(caller_id, len);
+    ACCESS_CALLER* victim = NULL;
+    jchar* id;
+    int i;
+
+    for (i = 0; i < ACCESS_CALLER_MAX; i++) {
+        ACCESS_CALLER* c = &access_callers[i];
+        if (c->id != NULL && c->hash == hash && c->len == len &&
+                !memcmp(c->id, caller_id, len * sizeof(jchar))) {
+            c->used = ++access_clock;
+            return c;
+        }
+        if (victim == NULL || (victim->id != NULL &&
+                (c->id == NULL || c->used < victim->used))) {
+            victim = c;
+        }
+    }
+
+    id = (jchar*)JAVAME_MALLOC((len + 1) * sizeof(jchar));
+    if (id == NULL) return NULL;
+    memcpy(id, caller_id, (len + 1) * sizeof(jchar));
+    if (victim->id != NULL) JAVAME_FREE(victim->id);
+    victim->id = id;
+    victim->len = len;
+    victim->hash = hash;
+    victim->serial++;
+    victim->used = ++access_clock;
+    victim->visible_count = 0;
+    victim->visible_stamp = index_stamp - 1;
+    return victim;
+}
+
+/**
+ * Finds indexed handler by ID and returns the address of the link
+ * pointing to it.
+ */
+static jsr211_index_handler** find_handler(const jchar* id, size_t len) {
+    unsigned int hash = jsr211_hash_key(id, len);
+    jsr211_index_handler** ph = &index_handlers[INDEX_BUCKET(hash)];
+    for (; *ph != NULL; ph = &(*ph)->next) {
+        if ((*ph)->hash == hash && (*ph)->id_len == len &&
+                !memcmp((*ph)->id, id, len * sizeof(jchar))) {
+            break;
+        }
+    }
+    return ph;
+}
+
+/**
+ * Creates indexed handler record and inserts it in the hash table.
+ * All strings are kept in the single memory block with the record.
+ */
+static jsr211_index_handler* new_handler(const jchar* id, size_t id_len,
+                    const jchar* suite_id, size_t suite_id_len,
+                    const jchar* class_name, size_t class_name_len, int flag,
+                    int borrow) {
+    jsr211_index_handler* h = (jsr211_index_handler*)JAVAME_MALLOC(sizeof(*h) +
+        (borrow? 0: (id_len + suite_id_len + class_name_len + 3) * sizeof(jchar)));
+    if (h != NULL) {
+        h->id_len = id_len;
+        h->suite_id_len = suite_id_len;
+        h->class_name_len = class_name_len;
+        if (borrow) {
+            // zero terminated strings of the mapped image
+            h->id = (jchar*)id;
+            h->suite_id = (jchar*)suite_id;
+            h->class_name = (jchar*)class_name;
+        } else {
+            h->id = (jchar*)(h + 1);
+            memcpy(h->id, id, id_len * sizeof(jchar));
+            h->id[id_len] = 0;
+
+            h->suite_id = h->id + id_len + 1;
+            memcpy(h->suite_id, suite_id, suite_id_len * sizeof(jchar));
+            h->suite_id[suite_id_len] = 0;
+
+            h->class_name = h->suite_id + suite_id_len + 1;
+            memcpy(h->class_name, class_name, class_name_len * sizeof(jchar));
+            h->class_name[class_name_len] = 0;
+        }
+
+        h->flag = (jsr211_register_type)flag;
+        h->access = NULL;
+        h->action_map = NULL;
+        h->keys = NULL;
+        h->key_count = h->key_capacity = 0;
+        h->hash = jsr211_hash_key(id, id_len);
+        h->next = index_handlers[INDEX_BUCKET(h->hash)];
+        index_handlers[INDEX_BUCKET(h->hash)] = h;
+    }
+    return h;
+}
+
+/**
+ * Finds the position of the ID in the handlers list sorted by ID.
+ *
+ * @return the first position whose handler ID is not less than the ID
+ */
+static int handler_position(jsr211_index_handler* const* handlers, int count,
+                                                const jchar* id, size_t len) {
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (jsr211_jchars_compare(handlers[mid]->id, handlers[mid]->id_len, id, len) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/**
+ * Adds the handler to the list of the field value. A new key refers to the
+ * borrowed value instead of its copy.
+ */
+static jsr211_result link_key(jsr211_field field, const jchar* value, size_t len,
+                                        jsr211_index_handler* h, int borrow) {
+    int casesens = IS_CASE_SENSITIVE(field);
+    const jchar* match = match_key(field, value, len);
+    unsigned int hash;
+    INDEX_KEY* key;
+    int pos;
+
+    if (match == NULL) return JSR211_FAILED;
+    hash = jsr211_hash_key(match, len);
+    key = find_key(field, match, len, hash);
+
+    if (key == NULL) {
+        // the folded key follows the value for the case-insensitive field
+        key = (INDEX_KEY*)JAVAME_MALLOC(sizeof(*key) +
+                    ((borrow? 0: 1) + (casesens? 0: 1)) * (len + 1) * sizeof(jchar));
+        if (key == NULL) return JSR211_FAILED;
+        memset(key, 0, sizeof(*key));
+        key->field = field;
+        key->hash = hash;
+        key->len = len;
+        if (borrow) {
+            key->value = (jchar*)value;
+        } else {
+            key->value = (jchar*)(key + 1);
+            memcpy(key->value, value, len * sizeof(jchar));
+            key->value[len] = 0;
+        }
+        key->key = key->value;
+        if (!casesens) {
+            key->key = borrow? (jchar*)(key + 1): key->value + len + 1;
+            memcpy(key->key, match, len * sizeof(jchar));
+            key->key[len] = 0;
+        }
+        if (JSR211_OK != add_value(key)) {
+            free_key(key);
+            return JSR211_FAILED;
+        }
+        key->next = index_keys[INDEX_BUCKET(hash)];
+        index_keys[INDEX_BUCKET(hash)] = key;
+    }
+
+    pos = handler_position(key->handlers, key->count, h->id, h->id_len);
+    if (pos < key->count && key->handlers[pos] == h) {
+        return JSR211_OK; // duplicated value
+    }
+
+    if (key->count == key->capacity) {
+        jsr211_index_handler** tmp = (jsr211_index_handler**)JAVAME_REALLOC(key->handlers,
+                (key->capacity + INDEX_LIST_GRANULARITY) * sizeof(*tmp));
+        if (tmp == NULL) return JSR211_FAILED;
+        key->handlers = tmp;
+        key->capacity += INDEX_LIST_GRANULARITY;
+    }
+    // the handler keeps its keys, so it is unlinked without the table scan
+    if (h->key_count == h->key_capacity) {
+        INDEX_KEY** tmp = (INDEX_KEY**)JAVAME_REALLOC(h->keys,
+                (h->key_capacity + INDEX_LIST_GRANULARITY) * sizeof(*tmp));
+        if (tmp == NULL) return JSR211_FAILED;
+        h->keys = tmp;
+        h->key_capacity += INDEX_LIST_GRANULARITY;
+    }
+    memmove(key->handlers + pos + 1, key->handlers + pos,
+                        (key->count - pos) * sizeof(*key->handlers));
+    key->handlers[pos] = h;
+    key->count++;
+    h->keys[h->key_count++] = key;
+    return JSR211_OK;
+}
+
+/**
+ * Removes the handler from all value lists. Keys left without handlers
+ * are deleted.
+ */
+static void unlink_keys(jsr211_index_handler* h) {
+    int k, i;
+    for (k = 0; k < h->key_count; k++) {
+        INDEX_KEY* key = h->keys[k];
+        i = handler_position(key->handlers, key->count, h->id, h->id_len);
+        if (i < key->count && key->handlers[i] == h) {
+            memmove(key->handlers + i, key->handlers + i + 1,
+                    (key->count - i - 1) * sizeof(*key->handlers));
+            key->count--;
+        }
+        if (key->count == 0) {
+            INDEX_KEY** pkey = &index_keys[INDEX_BUCKET(key->hash)];
+            while (*pkey != key) pkey = &(*pkey)->next;
+            *pkey = key->next;
+            remove_value(key);
+            free_key(key);
+        }
+    }
+    h->key_count = 0;
+}
+
+/**
+ * Reads registration info of the handler from the backend and creates
+ * its index record.
+ */
+static jsr211_index_handler* read_handler(const jchar* id, size_t id_len, /*OUT*/ int* res) {
+    jsr211_index_handler* h = NULL;
+    int maxlen;
+    jchar* buffer = jsr211_scratch_get(JSR211_SCRATCH_SECONDARY, &maxlen);
+    jchar* class_name;
+    int suite_id_len, class_name_len;
+    javacall_chapi_handler_registration_type flag;
+
+    *res = JAVACALL_CHAPI_ERROR_NO_MEMORY;
+    while (buffer) {
+        // the buffer is shared between the suite ID and the class name
+        suite_id_len = class_name_len = maxlen / 2;
+        class_name = buffer + suite_id_len;
+        *res = javacall_chapi_get_handler_info(id, buffer, &suite_id_len,
+                                        class_name, &class_name_len, &flag);
+        if (*res == JAVACALL_CHAPI_ERROR_BUFFER_TOO_SMALL) {
+            buffer = jsr211_scratch_grow(JSR211_SCRATCH_SECONDARY, 2 *
+                (suite_id_len > class_name_len? suite_id_len: class_name_len), &maxlen);
+            *res = JAVACALL_CHAPI_ERROR_NO_MEMORY;
+            continue;
+        }
+        if (*res == JAVACALL_OK) {
+            h = new_handler(id, id_len, buffer, suite_id_len - 1,
+                                class_name, class_name_len - 1, flag, 0);
+            if (h == NULL) *res = JAVACALL_CHAPI_ERROR_NO_MEMORY;
+        }
+        break;
+    }
+    return h;
+}
+
+/**
+ * Indexes all values of the handler field stored in the backend.
+ */
+static jsr211_result index_values(jsr211_index_handler* h, jsr211_field field) {
+    int pos = 0;
+    int len, maxlen;
+    jchar* buffer = jsr211_scratch_get(JSR211_SCRATCH_SECONDARY, &maxlen);
+    int res = JAVACALL_CHAPI_ERROR_NO_MEMORY;
+
+    while (buffer) {
+        len = maxlen;
+        if (field == JSR211_FIELD_TYPES) {
+            res = javacall_chapi_enum_types(h->id, &pos, buffer, &len);
+        } else if (field == JSR211_FIELD_SUFFIXES) {
+            res = javacall_chapi_enum_suffixes(h->id, &pos, buffer, &len);
+        } else {
+            res = javacall_chapi_enum_actions(h->id, &pos, buffer, &len);
+        }
+
+        if (res == JAVACALL_CHAPI_ERROR_BUFFER_TOO_SMALL) {
+            buffer = jsr211_scratch_grow(JSR211_SCRATCH_SECONDARY, len, &maxlen);
+            res = JAVACALL_CHAPI_ERROR_NO_MEMORY;
+            continue;
+        }
+        if (res) break;
+
+        if (JSR211_OK != link_key(field, buffer, len - 1, h, 0)) {
+            res = JAVACALL_CHAPI_ERROR_NO_MEMORY;
+            break;
+        }
+    }
+    javacall_chapi_enum_finish(pos);
+
+    return (res == JAVACALL_CHAPI_ERROR_NO_MORE_ELEMENTS)? JSR211_OK: JSR211_FAILED;
+}
+
+/**
+ * Indexes the handler stored in the backend: its registration info, ID
+ * and all values.
+ *
+ * @return JAVACALL_OK, JAVACALL_CHAPI_ERROR_NO_MEMORY or the backend
+ * status if the handler could not be read
+ */
+static int index_stored_handler(const jchar* id, size_t id_len) {
+    int res;
+    jsr211_index_handler* h = read_handler(id, id_len, &res);
+    if (h == NULL) return res;
+    if (JSR211_OK != jsr211_trie_insert(h) ||
+            JSR211_OK != index_values(h, JSR211_FIELD_TYPES) ||
+            JSR211_OK != index_values(h, JSR211_FIELD_SUFFIXES) ||
+            JSR211_OK != index_values(h, JSR211_FIELD_ACTIONS)) {
+        return JAVACALL_CHAPI_ERROR_NO_MEMORY;
+    }
+    return JAVACALL_OK;
+}
+
+/**
+ * Builds the index from the registry backend. The previous index content,
+ * if any, is released. The registry image, if it is present, is used
+ * instead of the backend enumeration; otherwise the image is written from
+ * the built index.
+ *
+ * @return JSR211_OK if the index has been built successfully
+ */
+jsr211_result jsr211_index_build(void) {
+    int pos = 0;
+    int len, maxlen;
+    jchar* buffer;
+    int res = JAVACALL_CHAPI_ERROR_NO_MEMORY;
+
+    jsr211_index_release();
+
+    if (JSR211_OK == jsr211_image_load()) {
+        index_valid = 1;
+        if (JSR211_OK == jsr211_image_replay()) {
+            return JSR211_OK;
+        }
+    }
+    // the image is missing or damaged, the index might be loaded partially
+    jsr211_index_release();
+
+    buffer = jsr211_scratch_get(JSR211_SCRATCH_PRIMARY, &maxlen);
+    while (buffer) {
+        len = maxlen;
+        res = javacall_chapi_enum_handlers(&pos, buffer, &len);
+        if (res == JAVACALL_CHAPI_ERROR_BUFFER_TOO_SMALL) {
+            buffer = jsr211_scratch_grow(JSR211_SCRATCH_PRIMARY, len, &maxlen);
+            res = JAVACALL_CHAPI_ERROR_NO_MEMORY;
+            continue;
+        }
+        if (res) break;
+
+        if (JAVACALL_OK != index_stored_handler(buffer, len - 1)) {
+            res = JAVACALL_CHAPI_ERROR_NO_MEMORY;
+            break;
+        }
+    }
+    javacall_chapi_enum_finish(pos);
+
+    if (res != JAVACALL_CHAPI_ERROR_NO_MORE_ELEMENTS) {
+        jsr211_index_release();
+        return JSR211_FAILED;
+    }
+
+    index_valid = 1;
+    // the next start is served from the image
+    jsr211_image_merge();
+    return JSR211_OK;
+}
+
+/**
+ * Re-reads the handler from the backend. The handler is removed from the
+ * index and indexed again if it is still registered.
+ *
+ * @param id content handler ID
+ * @return JSR211_OK if the index is current for the handler, otherwise
+ * the index is released
+ */
+jsr211_result jsr211_index_refresh(const jchar* id) {
+    int res;
+
+    if (!index_valid) return JSR211_OK;
+
+    jsr211_index_remove(id);
+    res = index_stored_handler(id, wcslen(id));
+    if (res == JAVACALL_CHAPI_ERROR_NO_MEMORY) {
+        jsr211_index_release();
+        return JSR211_FAILED;
+    }
+    // other backend statuses mean the handler is not registered
+    return JSR211_OK;
+}
+
+/**
+ * Creates indexed handler record referring to the strings, which MUST stay
+ * valid until the index is released. Used to populate the index from the
+ * mapped registry image.
+ *
+ * @return the record or NULL if no memory available
+ */
+jsr211_index_handler* jsr211_index_put(const jchar* id, size_t id_len,
+                    const jchar* suite_id, size_t suite_id_len,
+                    const jchar* class_name, size_t class_name_len,
+                    jsr211_register_type flag) {
+    jsr211_index_handler* h = new_handler(id, id_len, suite_id, suite_id_len,
+                                            class_name, class_name_len, flag, 1);
+    if (h != NULL && JSR211_OK != jsr211_trie_insert(h)) {
+        return NULL;
+    }
+    return h;
+}
+
+/**
+ * Adds the handler to the list of the field value. A new value refers to
+ * the string, which MUST stay valid until the index is released. Used to
+ * populate the index from the mapped registry image.
+ *
+ * @return JSR211_OK or JSR211_FAILED if no memory available
+ */
+jsr211_result jsr211_index_link(jsr211_field field, const jchar* value,
+                                    size_t len, jsr211_index_handler* h) {
+    return link_key(field, value, len, h, 1);
+}
+
+/**
+ * Builds the index if it is not valid currently.
+ *
+ * @return JSR211_OK if the index is valid
+ */
+jsr211_result jsr211_index_assure(void) {
+    return index_valid? JSR211_OK: jsr211_index_build();
+}
+
+/**
+ * Releases all memory allocated by the index and marks it invalid.
+ */
+void jsr211_index_release(void) {
+    int b;
+    for (b = 0; b < INDEX_HASH_SIZE; b++) {
+        while (index_keys[b] != NULL) {
+            INDEX_KEY* key = index_keys[b];
+            index_keys[b] = key->next;
+            free_key(key);
+        }
+        while (index_handlers[b] != NULL) {
+            jsr211_index_handler* h = index_handlers[b];
+            index_handlers[b] = h->next;
+            free_handler(h);
+        }
+    }
+    for (b = 0; b < ACCESS_CALLER_MAX; b++) {
+        ACCESS_CALLER* c = &access_callers[b];
+        if (c->id != NULL) JAVAME_FREE(c->id);
+        if (c->visible != NULL) JAVAME_FREE(c->visible);
+        memset(c, 0, sizeof(*c));
+    }
+    for (b = 0; b < JSR211_FIELD_COUNT; b++) {
+        if (value_keys[b] != NULL) {
+            JAVAME_FREE(value_keys[b]);
+            value_keys[b] = NULL;
+        }
+        value_count[b] = value_capacity[b] = 0;
+    }
+    jsr211_trie_release();
+    // the index does not refer to the image strings any more
+    jsr211_image_release();
+    index_valid = 0;
+    index_stamp++;
+}
+
+/**
+ * Adds the handler to the index. If a handler with the same ID is indexed
+ * already it is replaced.
+ *
+ * @param ch registered content handler
+ * @return JSR211_OK if the handler has been indexed, otherwise the index
+ * is released and will be rebuilt on the next query
+ */
+jsr211_result jsr211_index_add(const jsr211_content_handler* ch) {
+    jsr211_index_handler* h;
+    int i;
+
+    if (!index_valid) {
+        // the handler will be read from the backend with the whole index
+        return JSR211_OK;
+    }
+
+    jsr211_index_remove(ch->id);
+    index_stamp++;
+
+    do {
+        h = new_handler(ch->id, wcslen(ch->id), ch->suite_id, wcslen(ch->suite_id),
+                        ch->class_name, wcslen(ch->class_name), ch->flag, 0);
+        if (h == NULL || JSR211_OK != jsr211_trie_insert(h)) break;
+
+        for (i = 0; i < ch->type_num; i++) {
+            if (JSR211_OK != link_key(JSR211_FIELD_TYPES, ch->types[i],
+                                                wcslen(ch->types[i]), h, 0)) break;
+        }
+        if (i < ch->type_num) break;
+
+        for (i = 0; i < ch->suff_num; i++) {
+            if (JSR211_OK != link_key(JSR211_FIELD_SUFFIXES, ch->suffixes[i],
+                                                wcslen(ch->suffixes[i]), h, 0)) break;
+        }
+        if (i < ch->suff_num) break;
+
+        for (i = 0; i < ch->act_num; i++) {
+            if (JSR211_OK != link_key(JSR211_FIELD_ACTIONS, ch->actions[i],
+                                                wcslen(ch->actions[i]), h, 0)) break;
+        }
+        if (i < ch->act_num) break;
+
+        return JSR211_OK;
+    } while (0);
+
+    jsr211_index_release();
+    return JSR211_FAILED;
+}
+
+/**
+ * Removes the handler from the index.
+ *
+ * @param id content handler ID
+ */
+void jsr211_index_remove(const jchar* id) {
+    jsr211_index_handler** ph;
+    jsr211_index_handler* h;
+
+    if (!index_valid) return;
+
+    ph = find_handler(id, wcslen(id));
+    h = *ph;
+    if (h != NULL) {
+        unlink_keys(h);
+        jsr211_trie_remove(h->id, h->id_len);
+        *ph = h->next;
+        free_handler(h);
+        index_stamp++;
+    }
+}
+
+/**
+ * Returns next indexed handler. Enumeration MUST NOT be interleaved with
+ * index modifications.
+ *
+ * @param pos enumeration position initialized with
+ * @link JSR211_INDEX_ENUM_INITIALIZER before the first call
+ * @return next handler or NULL if there are no more handlers
+ */
+jsr211_index_handler* jsr211_index_next(jsr211_index_enum* pos) {
+    jsr211_index_handler* h;
+    while (pos->next == NULL) {
+        if (pos->bucket >= INDEX_HASH_SIZE) return NULL;
+        pos->next = index_handlers[pos->bucket++];
+    }
+    h = pos->next;
+    pos->next = h->next;
+    return h;
+}
+
+/**
+ * Finds indexed handler by ID.
+ *
+ * @param id content handler ID
+ * @return the handler or NULL if it is not registered
+ */
+jsr211_index_handler* jsr211_index_get(const jchar* id) {
+    return *find_handler(id, wcslen(id));
+}
+
+/**
+ * Looks up handlers registered for the given type, suffix or action.
+ *
+ * @param field one of JSR211_FIELD_TYPES, JSR211_FIELD_SUFFIXES or
+ * JSR211_FIELD_ACTIONS
+ * @param value requested value
+ * @param handlers output value - array of found handlers owned by the
+ * index. The array is valid until the next index modification.
+ * @return number of found handlers
+ */
+int jsr211_index_lookup(jsr211_field field, const jchar* value,
+                        /*OUT*/ jsr211_index_handler* const** handlers) {
+    size_t len = wcslen(value);
+    const jchar* match = match_key(field, value, len);
+    INDEX_KEY* key = (match == NULL)? NULL:
+                        find_key(field, match, len, jsr211_hash_key(match, len));
+    if (key == NULL) {
+        *handlers = NULL;
+        return 0;
+    }
+    *handlers = key->handlers;
+    return key->count;
+}
+
+/**
+ * Finds the position after the handler ID in the handlers array returned
+ * by @link jsr211_index_lookup. The handler need not be registered.
+ *
+ * @param handlers handlers sorted by ID
+ * @param count number of handlers
+ * @param id handler ID
+ * @return the position of the first handler with a greater ID
+ */
+int jsr211_index_position_after(jsr211_index_handler* const* handlers,
+                                                int count, const jchar* id) {
+    size_t len = wcslen(id);
+    int pos = handler_position(handlers, count, id, len);
+    if (pos < count && handlers[pos]->id_len == len &&
+            jsr211_jchars_equal(handlers[pos]->id, id, len)) {
+        pos++;
+    }
+    return pos;
+}
+
+/**
+ * Returns number of distinct values of the field.
+ *
+ * @param field one of JSR211_FIELD_TYPES, JSR211_FIELD_SUFFIXES or
+ * JSR211_FIELD_ACTIONS
+ * @return the number of values
+ */
+int jsr211_index_value_count(jsr211_field field) {
+    return value_count[field];
+}
+
+/**
+ * Returns distinct value of the field and the handlers declaring it.
+ * Values differing only in case are one value for the case-insensitive
+ * fields, it is returned as it was registered first.
+ *
+ * @param field one of JSR211_FIELD_TYPES, JSR211_FIELD_SUFFIXES or
+ * JSR211_FIELD_ACTIONS
+ * @param i value number, from 0 to @link jsr211_index_value_count - 1
+ * @param value output value - the value owned by the index
+ * @param len output value - the value length in jchars
+ * @param handlers output value - array of handlers declaring the value.
+ * The value and the array are valid until the next index modification.
+ * @return number of handlers declaring the value
+ */
+int jsr211_index_value(jsr211_field field, int i, /*OUT*/ const jchar** value,
+            /*OUT*/ size_t* len, /*OUT*/ jsr211_index_handler* const** handlers) {
+    INDEX_KEY* key = value_keys[field][i];
+    *value = key->value;
+    *len = key->len;
+    *handlers = key->handlers;
+    return key->count;
+}
+
+/**
+ * Checks whether the caller is allowed to access the handler. The backend
+ * decision is cached until the handler is registered again or unregistered.
+ *
+ * @param h indexed handler
+ * @param caller_id calling application identifier, NULL caller is checked
+ * by the backend without caching
+ * @return JSR211_TRUE if the access is allowed
+ */
+jsr211_boolean jsr211_index_access_allowed(jsr211_index_handler* h,
+                                                const jchar* caller_id) {
+    struct _jsr211_access_decision *d, **pd;
+    ACCESS_CALLER* c;
+    jsr211_boolean allowed;
+
+    if (caller_id == NULL || (c = intern_caller(caller_id)) == NULL) {
+        return javacall_chapi_is_access_allowed(h->id, caller_id)? JSR211_TRUE: JSR211_FALSE;
+    }
+
+    for (pd = &h->access; (d = *pd) != NULL; ) {
+        if (d->serial != d->caller->serial) {
+            // the caller has been evicted
+            *pd = d->next;
+            JAVAME_FREE(d);
+            continue;
+        }
+        if (d->caller == c) return d->allowed;
+        pd = &d->next;
+    }
+
+    allowed = javacall_chapi_is_access_allowed(h->id, caller_id)? JSR211_TRUE: JSR211_FALSE;
+    d = (struct _jsr211_access_decision*)JAVAME_MALLOC(sizeof(*d));
+    if (d != NULL) {
+        d->caller = c;
+        d->serial = c->serial;
+        d->allowed = allowed;
+        d->next = h->access;
+        h->access = d;
+    }
+    return allowed;
+}
+
+/**
+ * Returns the cached action map of the handler and marks it as the most
+ * recently used one.
+ *
+ * @param h the handler
+ * @return the action map or NULL if it is not cached
+ */
+JSR211_RESULT_BUFFER jsr211_index_action_map(jsr211_index_handler* h) {
+    int slot;
+    if (h->action_map == NULL) return NULL;
+    slot = action_map_slot(h);
+    memmove(action_map_owners + slot, action_map_owners + slot + 1,
+                (action_map_count - slot - 1) * sizeof(action_map_owners[0]));
+    action_map_owners[action_map_count - 1] = h;
+    return h->action_map;
+}
+
+/**
+ * Caches the action map of the handler, the index takes the map over.
+ * If the cache is full the least recently used map is released.
+ *
+ * @param h the handler without cached action map
+ * @param map the action map
+ */
+void jsr211_index_cache_action_map(jsr211_index_handler* h, JSR211_RESULT_BUFFER map) {
+    if (action_map_count == ACTION_MAP_MAX) drop_action_map(0);
+    h->action_map = map;
+    action_map_owners[action_map_count++] = h;
+}
+
+/**
+ * Returns handlers accessible for the caller. The set is computed once per
+ * caller and reused until the next index modification.
+ *
+ * @param caller_id calling application identifier
+ * @param handlers output value - array of accessible handlers owned by the
+ * index. The array is valid until the next index modification.
+ * @return number of accessible handlers or -1 if no memory available
+ */
+int jsr211_index_visible(const jchar* caller_id,
+                        /*OUT*/ jsr211_index_handler* const** handlers) {
+    ACCESS_CALLER* c = intern_caller(caller_id);
+    jsr211_index_enum pos = JSR211_INDEX_ENUM_INITIALIZER;
+    jsr211_index_handler* h;
+
+    if (c == NULL) return -1;
+
+    if (c->visible_stamp != index_stamp) {
+        c->visible_count = 0;
+        while ((h = jsr211_index_next(&pos)) != NULL) {
+            if (!jsr211_index_access_allowed(h, caller_id)) continue;
+            if (c->visible_count == c->visible_capacity) {
+                int capacity = c->visible_capacity? 2 * c->visible_capacity: 4 * INDEX_LIST_GRANULARITY;
+                jsr211_index_handler** tmp = (jsr211_index_handler**)JAVAME_REALLOC(c->visible,
+                                                            capacity * sizeof(*tmp));
+                if (tmp == NULL) return -1;
+                c->visible = tmp;
+                c->visible_capacity = capacity;
+            }
+            c->visible[c->visible_count++] = h;
+        }
+        c->visible_stamp = index_stamp;
+    }
+
+    *handlers = c->visible;
+    return c->visible_count;
+}
+
+/**
+ * Returns the scratch buffer allocating it if necessary.
+ *
+ * @param buf requested buffer
+ * @param maxlen output value - the buffer capacity in jchars
+ * @return the buffer or NULL if no memory available
+ */
+jchar* jsr211_scratch_get(jsr211_scratch_buffer buf, /*OUT*/ int* maxlen) {
+    if (scratch[buf] == NULL) {
+        scratch[buf] = (jchar*)JAVAME_MALLOC(SCRATCH_BUFFER * sizeof(jchar));
+        scratch_len[buf] = (scratch[buf] != NULL)? SCRATCH_BUFFER: 0;
+    }
+    *maxlen = scratch_len[buf];
+    return scratch[buf];
+}
+
+/**
+ * Grows the scratch buffer. The buffer content is not preserved.
+ *
+ * @param buf requested buffer
+ * @param len required capacity in jchars
+ * @param maxlen output value - the buffer capacity in jchars
+ * @return the buffer or NULL if no memory available
+ */
+jchar* jsr211_scratch_grow(jsr211_scratch_buffer buf, int len, /*OUT*/ int* maxlen) {
+    if (len <= scratch_len[buf]) {
+        // the backend insists on a bigger buffer without telling its size
+        len = 2 * scratch_len[buf];
+    }
+    if (scratch[buf] != NULL) {
+        JAVAME_FREE(scratch[buf]);
+        scratch_growths++;
+    }
+    scratch[buf] = (jchar*)JAVAME_MALLOC(len * sizeof(jchar));
+    scratch_len[buf] = (scratch[buf] != NULL)? len: 0;
+    *maxlen = scratch_len[buf];
+    return scratch[buf];
+}
+
+/**
+ * Releases all scratch buffers.
+ */
+void jsr211_scratch_release(void) {
+    int i;
+    for (i = 0; i < JSR211_SCRATCH_COUNT; i++) {
+        if (scratch[i] != NULL) {
+            JAVAME_FREE(scratch[i]);
+            scratch[i] = NULL;
+        }
+        scratch_len[i] = 0;
+    }
+}
+
+/**
+ * Returns number of scratch buffer growths since the registry start.
+ * The initial allocation of a buffer is not counted.
+ *
+ * @return the number of growths
+ */
+int jsr211_scratch_growths(void) {
+    return scratch_growths;
+}
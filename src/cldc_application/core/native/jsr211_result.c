@@ -36,8 +36,8 @@
 #include <jsrop_memory.h> 
 #include <jsrop_suitestore.h> 
 
-#include "javautil_string.h"
 #include "jsr211_result.h"
+#include "jsr211_jchars.h"
 
 #ifdef _DEBUG
 //#define TRACE_DATA_OPS
@@ -46,10 +46,39 @@
 
 #define BUFFER_GRANULARITY 0x100
 #define LEVELS_COUNT       0x4
+#define DEDUP_INITIAL_SIZE 0x20     /* must be a power of 2 */
+#define POOL_SIZE          0x4
+#define POOL_MAX_CAPACITY  0x10000    /* bigger buffers are not pooled */
 
 #define CHECKRC( e ) \
     if( JSR211_OK != (rc = (e)) ) return rc \
 
+/**
+ * Kinds of the deduplicated entries.
+ */
+typedef enum {
+    DEDUP_STRINGS = 0,          /* case-sensitive strings */
+    DEDUP_FOLDED_STRINGS,       /* case-insensitive strings */
+    DEDUP_HANDLERS              /* content handlers keyed by ID */
+} dedup_kind;
+
+/**
+ * Internal structure.
+ * Open-addressing hash table over the top level entries of the result
+ * buffer, built on the first uniqueness test. Entries are referred to by
+ * offsets into the buffer data, so the table survives buffer reallocation.
+ * The entries appended since the previous test are indexed lazily, thus
+ * the plain appends need not know about the table.
+ */
+typedef struct _DEDUP_TABLE_ {
+    dedup_kind      kind;
+    size_t          size;       /* slots count, a power of 2 */
+    size_t          count;      /* used slots */
+    size_t          indexed;    /* data offset of the first entry not indexed */
+    unsigned int*   hashes;
+    size_t*         offsets;    /* 0 marks an empty slot */
+} DEDUP_TABLE;
+
 /**
  * Internal structure.
  * Handle to result buffer for serialized data storage.
@@ -59,31 +88,111 @@ typedef struct _DATA_BUFFER_{
     size_t  bytes_used;
     size_t  level;
     size_t  size_offset[ LEVELS_COUNT ];
+    DEDUP_TABLE*    dedup;
     unsigned char   data[1];
 } DATA_BUFFER;
 
-typedef unsigned short size_type;
+/*
+ * Framing of the serialized data (version 2). Every element and level is
+ * preceded by its length in bytes. The length is 32-bit and is stored as
+ * two jchars, the high half first, so the Java side reads it by chars.
+ * Level lengths are written when the level is closed (or its data is
+ * requested), thus an append does not touch the enclosing levels.
+ */
+#define LENGTH_SIZE         (2 * sizeof(jchar))
+#define MAX_DATA_LENGTH     0x7FFFFFFFUL
+
+static void put_length( unsigned char * p, size_t length ) {
+    jchar halves[2];
+    halves[0] = (jchar)(length >> 16);
+    halves[1] = (jchar)(length & 0xFFFF);
+    memcpy( p, halves, LENGTH_SIZE );
+}
+
+static size_t get_length( const unsigned char * p ) {
+    jchar halves[2];
+    memcpy( halves, p, LENGTH_SIZE );
+    return ((size_t)halves[0] << 16) | halves[1];
+}
 
 void jsr211_clean_buffer( DATA_BUFFER** buffer );
 jsr211_result jsr211_add_level( DATA_BUFFER ** buffer );
+static void dedup_release( DATA_BUFFER * buffer );
+
+/*
+ * Released buffers are kept in the pool with their capacity, so a steady
+ * stream of queries reuses a few buffers instead of allocating and growing
+ * a new one every time.
+ */
+static DATA_BUFFER* pool[ POOL_SIZE ];
+static int pool_count = 0;
+static int pool_hits = 0;
+static int pool_misses = 0;
+static size_t peak_capacity = 0;
 
 JSR211_RESULT_BUFFER jsr211_create_result_buffer(){
-    DATA_BUFFER* res = (DATA_BUFFER*)JAVAME_MALLOC( BUFFER_GRANULARITY );
+    DATA_BUFFER* res;
+    if (pool_count > 0) {
+        res = pool[ --pool_count ];
+        pool_hits++;
+    } else {
+        res = (DATA_BUFFER*)JAVAME_MALLOC( BUFFER_GRANULARITY );
+        pool_misses++;
+        if (res == NULL) return NULL;
+        memset( res, '\0', BUFFER_GRANULARITY );
+        res->size = BUFFER_GRANULARITY - sizeof(DATA_BUFFER);
+        if (res->size > peak_capacity) peak_capacity = res->size;
+    }
 #ifdef TRACE_DATA_OPS
     printf( "jsr211_result: create buffer %p\n", res );
 #endif
-    if (res == NULL) return NULL;
-    memset( res, '\0', BUFFER_GRANULARITY );
-    res->size = BUFFER_GRANULARITY - sizeof(DATA_BUFFER);
     jsr211_clean_buffer( &res );
     return (JSR211_RESULT_BUFFER)res;
 }
 
 void jsr211_release_result_buffer(JSR211_RESULT_BUFFER resbuf){
+    DATA_BUFFER* b = (DATA_BUFFER*)resbuf;
 #ifdef TRACE_DATA_OPS
     printf( "jsr211_result: release buffer %p\n", resbuf );
 #endif
-    if (resbuf != NULL) JAVAME_FREE( resbuf );
+    if (b != NULL) {
+        dedup_release( b );
+        if (pool_count < POOL_SIZE && b->size <= POOL_MAX_CAPACITY) {
+            pool[ pool_count++ ] = b;
+        } else {
+            JAVAME_FREE( b );
+        }
+    }
+}
+
+/**
+ * Frees the pooled result buffers.
+ */
+void jsr211_result_pool_release(void){
+    while (pool_count > 0) {
+        JAVAME_FREE( pool[ --pool_count ] );
+    }
+}
+
+/**
+ * Returns number of result buffers taken from the pool.
+ */
+int jsr211_result_pool_hits(void){
+    return pool_hits;
+}
+
+/**
+ * Returns number of result buffers allocated because the pool was empty.
+ */
+int jsr211_result_pool_misses(void){
+    return pool_misses;
+}
+
+/**
+ * Returns the largest result buffer capacity in bytes.
+ */
+size_t jsr211_result_peak_capacity(void){
+    return peak_capacity;
 }
 
 /**
@@ -96,48 +205,60 @@ static jsr211_result assureBufferCap(DATA_BUFFER** resbuf, size_t ext){
     ext += ALWAYS_RESERVED_TAIL_BYTES;
 #undef ALWAYS_RESERVED_TAIL_BYTES
 
+    if ((*resbuf)->bytes_used + ext > MAX_DATA_LENGTH) return JSR211_FAILED;
     if ((*resbuf)->bytes_used + ext > (*resbuf)->size) {
-        // calculate new size
+        // calculate new size, at least twice the current one
         size_t sz = ((sizeof(DATA_BUFFER) + (*resbuf)->bytes_used + ext) / BUFFER_GRANULARITY + 1) * 
                         BUFFER_GRANULARITY;
-        DATA_BUFFER* tmp = (DATA_BUFFER*)JAVAME_REALLOC(*resbuf, sz);
+        DATA_BUFFER* tmp;
+        if (sz < 2 * (sizeof(DATA_BUFFER) + (*resbuf)->size))
+            sz = 2 * (sizeof(DATA_BUFFER) + (*resbuf)->size);
+        tmp = (DATA_BUFFER*)JAVAME_REALLOC(*resbuf, sz);
 #ifdef TRACE_DATA_OPS
         printf( "jsr211_result: assureBufferCap %p -> %p\n", *resbuf, tmp );
 #endif
         if (tmp == NULL) return JSR211_FAILED;
         tmp->size = sz - sizeof(DATA_BUFFER);
+        if (tmp->size > peak_capacity) peak_capacity = tmp->size;
         *resbuf = tmp;
     }
     return JSR211_OK;
 }
 
 void jsr211_clean_buffer( DATA_BUFFER** buffer ) {
+    dedup_release( *buffer );
     (**buffer).bytes_used = 0;
     (**buffer).level = 0;
     jsr211_add_level( buffer );
 }
 
 static void jsr211_inc( DATA_BUFFER * buffer, size_t length ) {
-    size_t l;
     buffer->bytes_used += length;
-    // increase levels lengths
+}
+
+/**
+ * writes the lengths of the open levels
+ */
+static void patch_levels( DATA_BUFFER * buffer ) {
+    size_t l;
     for( l = buffer->level; l--; )
-        *(size_type *)(buffer->data + buffer->size_offset[ l ]) += length;
+        put_length( buffer->data + buffer->size_offset[ l ],
+            buffer->bytes_used - buffer->size_offset[ l ] - LENGTH_SIZE );
 }
 
 /**
  * append data on the current level
  */
 jsr211_result jsr211_append_data(DATA_BUFFER** buffer, const void * data, size_t length ) {
-    jsr211_result rc = assureBufferCap(buffer, sizeof(size_type) + length);
+    jsr211_result rc = assureBufferCap(buffer, LENGTH_SIZE + length);
     if( rc == JSR211_OK ){
         DATA_BUFFER * b = *buffer; 
 #ifdef TRACE_DATA_OPS
         printf( "jsr211_result: append data %p, length = %d", 
                         *buffer, length );
 #endif
-        *(size_type *)(b->data + b->bytes_used) = (size_type)length;
-        jsr211_inc( b, sizeof(size_type) );
+        put_length( b->data + b->bytes_used, length );
+        jsr211_inc( b, LENGTH_SIZE );
         memcpy( b->data + b->bytes_used, data, length );
         jsr211_inc( b, length );
 #ifdef TRACE_DATA_OPS
@@ -165,11 +286,11 @@ jsr211_result jsr211_add_level( DATA_BUFFER ** buffer ) {
 #endif
     if( b->level >= sizeof(b->size_offset)/sizeof(b->size_offset[0]) )
         return JSR211_FAILED;
-    CHECKRC( assureBufferCap(buffer, sizeof(size_type) ) );
+    CHECKRC( assureBufferCap(buffer, LENGTH_SIZE ) );
     b = *buffer;
     b->size_offset[ b->level ] = b->bytes_used;
-    *(size_type *)(b->data + b->bytes_used) = (size_type)0;
-    jsr211_inc( b, sizeof(size_type) );
+    put_length( b->data + b->bytes_used, 0 );
+    jsr211_inc( b, LENGTH_SIZE );
     b->level++;
     return JSR211_OK;
 }
@@ -184,17 +305,20 @@ jsr211_result jsr211_drop_level( DATA_BUFFER * buffer ) {
     if( buffer->level == 0 )
         return JSR211_FAILED;
     buffer->level--;
+    put_length( buffer->data + buffer->size_offset[ buffer->level ],
+        buffer->bytes_used - buffer->size_offset[ buffer->level ] - LENGTH_SIZE );
     return JSR211_OK;
 }
 
 JSR211_BUFFER_DATA jsr211_get_result_data(JSR211_RESULT_BUFFER resbuf){
     if (resbuf == NULL) return NULL;
+    patch_levels( (DATA_BUFFER*)resbuf );
     return ((DATA_BUFFER*)resbuf)->data;
 }
 
 void jsr211_get_data( JSR211_BUFFER_DATA handle, const void ** data, size_t * length ){
-    *length = *(size_type *)handle;
-    *data = (size_type *)handle + 1;
+    *length = get_length( (const unsigned char *)handle );
+    *data = (const unsigned char *)handle + LENGTH_SIZE;
 }
 
 /**
@@ -223,6 +347,33 @@ JSR211_BUFFER_DATA jsr211_get_next( JSR211_ENUM_HANDLE * eh ){
 
 //---------------------------------------------------------
 
+/**
+ * Folds the string to its matching key.
+ * @param str folded string
+ * @param len the string length in jchars
+ * @param key output buffer for len jchars, may be the same as str
+ */
+void jsr211_fold_string(const jchar* str, size_t len, /*OUT*/ jchar* key) {
+    while (len--) {
+        *key++ = JSR211_FOLD(*str);
+        str++;
+    }
+}
+
+/**
+ * Computes the hash code of the matching key.
+ * @param key the key
+ * @param len the key length in jchars
+ * @return the hash code
+ */
+unsigned int jsr211_hash_key(const jchar* key, size_t len) {
+    unsigned int hash = 0;
+    while (len--) {
+        hash = 31 * hash + *key++;
+    }
+    return hash;
+}
+
 /**
  * Appends string to output string array.
  * @param str appended string
@@ -234,6 +385,196 @@ jsr211_result jsr211_appendString( const jchar* str, size_t str_size, /*OUT*/ JS
     return jsr211_append_data( (DATA_BUFFER **)array, str, str_size * sizeof(str[0]) );
 }
 
+/**
+ * Appends all strings of the source string array to output string array.
+ * The strings are copied at once, without parsing the source array.
+ * @param src source string array
+ * @param array string array.
+ * @return operation status.
+ */
+jsr211_result jsr211_appendStrings( JSR211_RESULT_BUFFER src, /*OUT*/ JSR211_RESULT_STRARRAY array) {
+    jsr211_result rc;
+    const void * data; size_t length;
+    DATA_BUFFER * b;
+    jsr211_get_data( jsr211_get_result_data(src), &data, &length );
+    CHECKRC( assureBufferCap((DATA_BUFFER **)array, length) );
+    b = *(DATA_BUFFER **)array;
+    memcpy( b->data + b->bytes_used, data, length );
+    jsr211_inc( b, length );
+    return JSR211_OK;
+}
+
+/**
+ * Frees the deduplication table of the buffer.
+ */
+static void dedup_release( DATA_BUFFER * buffer ) {
+    if (buffer->dedup != NULL) {
+        JAVAME_FREE(buffer->dedup->hashes);
+        JAVAME_FREE(buffer->dedup->offsets);
+        JAVAME_FREE(buffer->dedup);
+        buffer->dedup = NULL;
+    }
+}
+
+/**
+ * Returns the key of the top level entry: the string itself or
+ * the first field (ID) of the content handler.
+ */
+static void dedup_entry_key( dedup_kind kind, JSR211_BUFFER_DATA entry,
+                                const jchar ** key, size_t * sz ) {
+    const void * data; size_t length;
+    if (kind == DEDUP_HANDLERS) {
+        JSR211_ENUM_HANDLE eh = jsr211_get_enum_handle( entry );
+        entry = jsr211_get_next( &eh );
+    }
+    jsr211_get_data( entry, &data, &length );
+    *key = (const jchar *)data;
+    *sz = length / sizeof(jchar);
+}
+
+/**
+ * Computes the key hash, folded for the case-insensitive strings.
+ */
+static unsigned int dedup_hash( dedup_kind kind, const jchar * key, size_t sz ) {
+    unsigned int hash = 0;
+    if (kind != DEDUP_FOLDED_STRINGS) return jsr211_hash_key(key, sz);
+    while (sz--) {
+        hash = 31 * hash + JSR211_FOLD(*key);
+        key++;
+    }
+    return hash;
+}
+
+/**
+ * Compares the keys of the same length.
+ */
+static int dedup_equal( dedup_kind kind, const jchar * k1, const jchar * k2, size_t sz ) {
+    if (kind != DEDUP_FOLDED_STRINGS) return jsr211_jchars_equal(k1, k2, sz);
+    return jsr211_jchars_equal_fold(k1, k2, sz);
+}
+
+/**
+ * Puts the entry offset into the free slot of the table.
+ */
+static void dedup_put( DEDUP_TABLE * t, unsigned int hash, size_t offset ) {
+    size_t i = hash & (t->size - 1);
+    while (t->offsets[i] != 0) {
+        i = (i + 1) & (t->size - 1);
+    }
+    t->hashes[i] = hash;
+    t->offsets[i] = offset;
+    t->count++;
+}
+
+/**
+ * Doubles the table slots count.
+ */
+static jsr211_result dedup_grow( DEDUP_TABLE * t ) {
+    unsigned int* hashes = t->hashes;
+    size_t* offsets = t->offsets;
+    size_t size = t->size, i;
+
+    t->hashes = (unsigned int*)JAVAME_MALLOC(2 * size * sizeof(unsigned int));
+    t->offsets = (size_t*)JAVAME_MALLOC(2 * size * sizeof(size_t));
+    if (t->hashes == NULL || t->offsets == NULL) {
+        if (t->hashes != NULL) JAVAME_FREE(t->hashes);
+        if (t->offsets != NULL) JAVAME_FREE(t->offsets);
+        t->hashes = hashes;
+        t->offsets = offsets;
+        return JSR211_FAILED;
+    }
+    memset(t->offsets, 0, 2 * size * sizeof(size_t));
+    t->size = 2 * size;
+    t->count = 0;
+    for (i = 0; i < size; i++) {
+        if (offsets[i] != 0) dedup_put(t, hashes[i], offsets[i]);
+    }
+    JAVAME_FREE(hashes);
+    JAVAME_FREE(offsets);
+    return JSR211_OK;
+}
+
+/**
+ * Returns the deduplication table of the buffer brought up to date with
+ * its top level entries, or NULL if no memory available. The table is
+ * rebuilt if it was built for the entries of another kind.
+ */
+static DEDUP_TABLE * dedup_table( DATA_BUFFER * b, dedup_kind kind ) {
+    DEDUP_TABLE * t = b->dedup;
+    JSR211_ENUM_HANDLE eh;
+    JSR211_BUFFER_DATA bd;
+
+    if (t != NULL && t->kind != kind) {
+        dedup_release( b );
+        t = NULL;
+    }
+    if (t == NULL) {
+        t = (DEDUP_TABLE *)JAVAME_MALLOC(sizeof(DEDUP_TABLE));
+        if (t == NULL) return NULL;
+        t->hashes = (unsigned int*)JAVAME_MALLOC(DEDUP_INITIAL_SIZE * sizeof(unsigned int));
+        t->offsets = (size_t*)JAVAME_MALLOC(DEDUP_INITIAL_SIZE * sizeof(size_t));
+        if (t->hashes == NULL || t->offsets == NULL) {
+            if (t->hashes != NULL) JAVAME_FREE(t->hashes);
+            if (t->offsets != NULL) JAVAME_FREE(t->offsets);
+            JAVAME_FREE(t);
+            return NULL;
+        }
+        memset(t->offsets, 0, DEDUP_INITIAL_SIZE * sizeof(size_t));
+        t->kind = kind;
+        t->size = DEDUP_INITIAL_SIZE;
+        t->count = 0;
+        t->indexed = LENGTH_SIZE;
+        b->dedup = t;
+    }
+
+    // index the entries appended since the previous test
+    patch_levels( b );
+    eh = jsr211_get_enum_handle( b->data );
+    eh.handle = b->data + t->indexed;
+    while( (bd = jsr211_get_next( &eh )) != NULL ){
+        const jchar * key; size_t sz;
+        if (2 * (t->count + 1) > t->size && dedup_grow(t) != JSR211_OK) {
+            dedup_release( b );
+            return NULL;
+        }
+        dedup_entry_key( kind, bd, &key, &sz );
+        dedup_put( t, dedup_hash(kind, key, sz),
+                        (const unsigned char *)bd - b->data );
+        t->indexed = (const unsigned char *)eh.handle - b->data;
+    }
+    return t;
+}
+
+/**
+ * Tests if the key is not identical to the key of any top level entry.
+ * Falls back to the linear scan if the table cannot be allocated.
+ */
+static jsr211_boolean dedup_is_unique( DATA_BUFFER * b, dedup_kind kind,
+                                            const jchar * key, size_t sz ) {
+    DEDUP_TABLE * t = dedup_table( b, kind );
+    const jchar * entry_key; size_t entry_sz;
+
+    if (t != NULL) {
+        unsigned int hash = dedup_hash(kind, key, sz);
+        size_t i = hash & (t->size - 1);
+        for (; t->offsets[i] != 0; i = (i + 1) & (t->size - 1)) {
+            if (t->hashes[i] != hash) continue;
+            dedup_entry_key( kind, b->data + t->offsets[i], &entry_key, &entry_sz );
+            if (entry_sz == sz && dedup_equal(kind, key, entry_key, sz))
+                return JSR211_FALSE;
+        }
+    } else {
+        JSR211_ENUM_HANDLE eh = jsr211_get_enum_handle( b->data );
+        JSR211_BUFFER_DATA bd;
+        while( (bd = jsr211_get_next( &eh )) != NULL ){
+            dedup_entry_key( kind, bd, &entry_key, &entry_sz );
+            if (entry_sz == sz && dedup_equal(kind, key, entry_key, sz))
+                return JSR211_FALSE;
+        }
+    }
+    return JSR211_TRUE;
+}
+
 /**
  * Tests if the string is not identical to any of ones included in array.
  * @param str appended string
@@ -243,22 +584,8 @@ jsr211_result jsr211_appendString( const jchar* str, size_t str_size, /*OUT*/ JS
  * @return JSR211_TRUE if string does not present in result yet JSR211_FALSE if does
  */
 jsr211_boolean jsr211_isUniqueString(const jchar *str, size_t sz, int casesens, JSR211_RESULT_STRARRAY array) {
-    JSR211_BUFFER_DATA bd = jsr211_get_result_data(*array);
-    JSR211_ENUM_HANDLE eh = jsr211_get_enum_handle( bd );
-    while( (bd = jsr211_get_next( &eh )) != NULL ){
-        const void * data; size_t length;
-        jsr211_get_data( bd, &data, &length );
-        if ( length == sz * sizeof(jchar) ) {
-            if (casesens == JAVACALL_TRUE) {
-                if( wcsncmp(str, (const jchar *)data, sz) == 0 )
-                    return JAVACALL_FALSE;
-            } else {
-                if( javautil_wcsnicmp(str, (const jchar *)data, sz) == 0 )
-                    return JAVACALL_FALSE;
-            }
-        }
-    }
-    return JAVACALL_TRUE;
+    return dedup_is_unique( *(DATA_BUFFER **)array,
+            casesens == JAVACALL_TRUE? DEDUP_STRINGS: DEDUP_FOLDED_STRINGS, str, sz );
 }
 
 /**
@@ -269,19 +596,7 @@ jsr211_boolean jsr211_isUniqueString(const jchar *str, size_t sz, int casesens,
  * @return JSR211_TRUE if id does not present in result yet JSR211_FALSE if does
  */
 jsr211_boolean jsr211_isUniqueHandler(const jchar *id, size_t id_sz, JSR211_RESULT_CHARRAY array) {
-    JSR211_ENUM_HANDLE eh = jsr211_get_enum_handle( jsr211_get_result_data(*array) );
-    JSR211_BUFFER_DATA bd;
-    while( (bd = jsr211_get_next( &eh )) != NULL ){
-        JSR211_ENUM_HANDLE ehh = jsr211_get_enum_handle( bd );
-        JSR211_BUFFER_DATA id_handle = jsr211_get_next( &ehh );
-        const void * data; size_t length;
-        jsr211_get_data( id_handle, &data, &length );
-        if ( length == id_sz * sizeof(jchar) ) {
-            if( wcsncmp(id, (const jchar *)data, id_sz) == 0 )
-                return JAVACALL_FALSE;
-        }
-    }
-    return JAVACALL_TRUE;
+    return dedup_is_unique( *(DATA_BUFFER **)array, DEDUP_HANDLERS, id, id_sz );
 }
 
 /**
@@ -300,6 +615,20 @@ jsr211_result jsr211_appendUniqueString(const jchar* str, size_t str_size, int c
 
 //---------------------------------------------------------
 
+/** Content handler record encoding */
+static jsr211_record_format record_format = JSR211_RECORD_HEX;
+
+/**
+ * Selects the content handler record encoding.
+ * @param format the most compact encoding supported by the caller
+ * @return the selected encoding
+ */
+jsr211_record_format jsr211_set_record_format(jsr211_record_format format) {
+    record_format = (format == JSR211_RECORD_BINARY)? 
+                                JSR211_RECORD_BINARY: JSR211_RECORD_HEX;
+    return record_format;
+}
+
 /**
  * Serializes handler data into buffer.
  * Variable <code>buf</code> after macros comletion points at the end of 
@@ -321,6 +650,15 @@ static jsr211_result fill_ch_buf(DATA_BUFFER ** buffer, const javacall_utf16* id
     // !!! suit IS null-terminated
     if( 0 == jsrop_string_to_suiteid(suit, &suite_id) )
         return JSR211_FAILED;
+    if( record_format == JSR211_RECORD_BINARY ){
+        jchar bin[2];
+        bin[ 0 ] = (jchar)((unsigned int)suite_id >> 16);
+        bin[ 1 ] = (jchar)((unsigned int)suite_id & 0xFFFF);
+        CHECKRC( jsr211_append_data(buffer, bin, sizeof(bin)) );
+        CHECKRC( jsr211_append_data(buffer, clas, clas_size * sizeof(clas[0])) );
+        bin[ 0 ] = (jchar)flag;
+        return jsr211_append_data( buffer, bin, sizeof(bin[0]) );
+    }
     suite_id_buf[ 0 ] = '0';
     if( suite_id < 0 ){
         suite_id_buf[ 0 ] = '-';
@@ -69,6 +69,8 @@
 #include <javautil_unicode.h>
 #include <javacall_memory.h>
 
+#include "jsr211_jchars.h"
+
 /*
  * The mode for get to retrieve a new request.
  */
@@ -96,8 +98,79 @@ typedef struct _StoredLink {
     struct _StoredLink* flink; /**< The forward link */
     struct _StoredLink* blink;    /**< The backward link */
     struct _StoredInvoc* invoc;    /**< The stored invocation */
+    struct _StoredLink* tlink;    /**< The next link with the same tid */
+    struct _AppQueue* queue;    /**< The destination application queue */
+    struct _StoredLink* aflink;    /**< The forward link in the application queue */
+    struct _StoredLink* ablink;    /**< The backward link in the application queue */
+    struct _StoredLink* sflink;    /**< The forward link in the status list */
+    struct _StoredLink* sblink;    /**< The backward link in the status list */
+    int list;    /**< The status list the link is kept in */
+    unsigned int seq;    /**< The order number of the link in the queue */
 } StoredLink;
 
+/**
+ * Stored invocation together with its queue link and the payload
+ * block holding its arguments array, the characters of all its
+ * strings and its data, in this order.
+ * The entries are served from the slab pool.
+ */
+typedef struct _StoredEntry {
+    StoredInvoc invoc;    /**< The invocation; must be the first member */
+    StoredLink link;    /**< The queue link of the invocation */
+    void* payload;    /**< The payload block; the next free entry in the pool */
+    struct _InvocSlab* slab;    /**< The slab the entry belongs to */
+} StoredEntry;
+
+/* The entry of the stored invocation. */
+#define ENTRY(invoc) ((StoredEntry*)(invoc))
+
+/** Number of the entries in a slab */
+#define SLAB_ENTRIES 16
+
+/**
+ * A fixed size block of the stored invocation entries.
+ */
+typedef struct _InvocSlab {
+    struct _InvocSlab* next;    /**< The next slab of the pool */
+    int used;    /**< Number of the entries in use */
+    StoredEntry* free;    /**< The first free entry */
+    StoredEntry entries[SLAB_ENTRIES];    /**< The entries */
+} InvocSlab;
+
+/*
+ * Slabs of the stored invocation entries.
+ */
+static InvocSlab* invocSlabs = NULL;
+
+/* The status list of the requests waiting for the handler. */
+#define LIST_WAITING 0
+
+/* The status list of the responses, from OK to INITIATED status. */
+#define LIST_RESPONSE 1
+
+/* The status list of all the other invocations. */
+#define LIST_OTHER 2
+
+#define LIST_COUNT 3
+
+/**
+ * Queue of the invocations stored for one destination application.
+ * The queue links are kept in the order of the global queue, the
+ * status lists keep the same order.
+ */
+typedef struct _AppQueue {
+    struct _AppQueue* next;    /**< The next queue in the hash chain */
+    unsigned int hash;    /**< The hash of suiteID and className */
+    SuiteIdType suiteID;    /**< The destination suite */
+    StoredString className;    /**< The destination class name; the characters follow the queue */
+    int count;    /**< Number of the queued invocations */
+    int handle;    /**< The registered application handle, 0 if not registered */
+    StoredLink* head;    /**< The first link of the queue */
+    StoredLink* tail;    /**< The last link of the queue */
+    StoredLink* heads[LIST_COUNT];    /**< The first links of the status lists */
+    StoredLink* tails[LIST_COUNT];    /**< The last links of the status lists */
+} AppQueue;
+
 static int copyOut(const StoredInvoc *invoc, int mode, 
            jobject invocObj, jobject argsObj, jobject obj);
 static void removeEntry(StoredLink *entry);
@@ -107,11 +180,14 @@ static void invocFree(StoredInvoc* stored);
 /* Function to put a new entry in the queue. */
 static jboolean invocPut(StoredInvoc* invoc);
 
-static StoredLink* invocFind(SuiteIdType suiteId, 
-                   const pcsl_string* classname, int mode);
+static StoredLink* invocFind(AppQueue* queue, int mode);
 static StoredLink* invocFindTid(int tid);
+static int tidHash(int tid);
 static int invocNextTid();
 static jboolean modeCheck(StoredInvoc* invoc, int mode);
+static jboolean stringEqualsChars(const StoredString* str,
+                   const jchar* chars, jsize len);
+static jboolean stringsEqual(const StoredString* a, const StoredString* b);
 
 #define isEmpty() (invocQueue == NULL)
 
@@ -120,6 +196,93 @@ static jboolean modeCheck(StoredInvoc* invoc, int mode);
  */
 static StoredLink* invocQueue = NULL;
 
+/*
+ * Tail of queue of stored Invocations.
+ */
+static StoredLink* invocQueueTail = NULL;
+
+/**
+ * Open addressing index of the queue links by transaction ID.
+ * A slot holds the first queued link with the tid, the links with
+ * the same tid are chained through StoredLink.tlink in the queue order.
+ */
+typedef struct _TidIndex {
+    StoredLink** links; /**< Slots, NULL if the slot is free */
+    int size;           /**< Number of slots, a power of two */
+    int count;          /**< Number of the used slots */
+} TidIndex;
+
+/** The initial number of the index slots */
+#define TID_INDEX_MIN_SIZE 16
+
+static TidIndex tidIndex = { NULL, 0, 0 };
+
+static jboolean tidIndexAdd(StoredLink* link);
+static void tidIndexRemove(StoredLink* link);
+
+/*
+ * Hash table of the application queues.
+ */
+static AppQueue** appQueues = NULL;
+static int appQueuesSize = 0;
+static int appQueuesCount = 0;
+
+/** The initial number of the application queues hash table slots */
+#define APP_QUEUES_MIN_SIZE 16
+
+/**
+ * Slot of the registered applications table.
+ * A handle is the slot index + 1 in the low HANDLE_INDEX_BITS bits and
+ * the slot generation above them, so the handle of a released slot
+ * does not address the application registered in the slot later.
+ */
+typedef struct _AppHandle {
+    AppQueue* queue;    /**< The registered queue, NULL if the slot is free */
+    int handle;    /**< The handle last issued for the slot */
+} AppHandle;
+
+#define HANDLE_INDEX_BITS 16
+#define HANDLE_INDEX_MASK ((1 << HANDLE_INDEX_BITS) - 1)
+#define HANDLE_GEN_MASK 0x7FFF
+
+/*
+ * Queues of the registered applications indexed by the handle.
+ * The registered queues are kept when they become empty, until
+ * the suite is removed.
+ */
+static AppHandle* appHandles = NULL;
+static int appHandlesSize = 0;
+static int appHandlesCount = 0;
+/* Number of the free slots below appHandlesCount */
+static int appHandlesFree = 0;
+
+/*
+ * Order number of the last queued link.
+ */
+static unsigned int lastSeq = 0;
+
+/*
+ * Number of the stored invocations.
+ */
+static int invocCount = 0;
+
+/*
+ * Number of the links left in a wrong application queue
+ * because a new queue could not be allocated.
+ */
+static int strayLinks = 0;
+
+static AppQueue* appQueueForHandle(int handle);
+static int appHandleSlot();
+static AppQueue* appQueueGet(const StoredCLDCAppID* app);
+static void appQueueFree(AppQueue* queue);
+static void refileStrays();
+static jboolean appQueueAdd(StoredLink* link);
+static void appQueueRemove(StoredLink* link);
+static void invocRefile(StoredLink* link);
+static void invocChanged(StoredInvoc* invoc);
+static StoredLink* findLink(StoredInvoc *invoc);
+
 #define UNDEFINED_TID 0
 /*
  * Transaction ID of next transaction. Acts as virtual time.
@@ -258,17 +421,217 @@ static void initializeFields(KNIDECLARGS jobject invocationImplObj) {
 //---------------------------------------------------------
 
 /**
- * The utility allocates memory for StoredInvoc struct and initializes it with
- * zeroes.
- * It replaces standard 'calloc'-family function to double-check that allocated
- * buffer is zeroed.
+ * The utility takes a StoredInvoc entry from the slab pool and initializes
+ * it with zeroes. A new slab is allocated when all the slabs are in use.
  *
  * @return pointer on zeroed StoredInvoc buffer or NULL if EOM occurs.
  */
 static StoredInvoc * newStoredInvoc() {
-    StoredInvoc * buf = JAVAME_MALLOC(sizeof(StoredInvoc));
-    memset( buf, '\0', sizeof(*buf) );
-    return buf;
+    InvocSlab* slab;
+    StoredEntry* entry;
+
+    for (slab = invocSlabs; slab != NULL && slab->free == NULL; slab = slab->next);
+    if (slab == NULL) {
+        int i;
+        slab = (InvocSlab*) JAVAME_MALLOC(sizeof(InvocSlab));
+        if (slab == NULL)
+            return NULL;
+        slab->used = 0;
+        slab->free = NULL;
+        for (i = SLAB_ENTRIES; i-- > 0; ) {
+            slab->entries[i].payload = slab->free;
+            slab->free = &slab->entries[i];
+        }
+        slab->next = invocSlabs;
+        invocSlabs = slab;
+    }
+
+    entry = slab->free;
+    slab->free = (StoredEntry*)entry->payload;
+    slab->used++;
+    memset( entry, '\0', sizeof(*entry) );
+    entry->slab = slab;
+    return &entry->invoc;
+}
+
+/**
+ * Returns the entry of the StoredInvoc to the slab pool.
+ * The slab is freed when it becomes unused unless it is the only one.
+ *
+ * @param invoc the StoredInvoc to release
+ */
+static void releaseStoredInvoc(StoredInvoc* invoc) {
+    StoredEntry* entry = ENTRY(invoc);
+    InvocSlab* slab = entry->slab;
+
+    entry->payload = slab->free;
+    slab->free = entry;
+    if (--slab->used == 0 && (slab != invocSlabs || slab->next != NULL)) {
+        InvocSlab** p = &invocSlabs;
+        while (*p != slab)
+            p = &(*p)->next;
+        *p = slab->next;
+        JAVAME_FREE(slab);
+    }
+}
+
+/* The size of the string characters in the payload block */
+#define STRING_SIZE(length) (((size_t)(length) + 1) * sizeof(jchar))
+
+/* The size of the stored string characters, none for the null string */
+#define STORED_SIZE(str) ((str)->data != NULL? STRING_SIZE((str)->length): 0)
+
+/**
+ * Allocates a payload block and lays out the arguments array and
+ * the data of the invocation in it. The arguments are null strings,
+ * the data is not initialized.
+ *
+ * @param next the invocation to lay out the block for
+ * @param argsLen the number of the arguments
+ * @param dataLen the length of the data
+ * @param charsSize the size of the characters of all the strings
+ * @param block [out] the block, NULL if there is nothing to store
+ * @param chars [out] the first free jchar of the strings area
+ * @return KNI_TRUE on success, KNI_FALSE if out of memory
+ */
+static jboolean payloadAlloc(StoredInvoc* next, int argsLen, int dataLen,
+                    size_t charsSize, char** block, jchar** chars) {
+    size_t argsSize = argsLen * sizeof(StoredString);
+    int i;
+
+    *block = NULL;
+    if (argsSize + charsSize + dataLen > 0) {
+        *block = (char*) JAVAME_MALLOC(argsSize + charsSize + dataLen);
+        if (*block == NULL)
+            return KNI_FALSE;
+    }
+    *chars = (*block != NULL)? (jchar*)(*block + argsSize): NULL;
+    next->args = NULL;
+    next->argsLen = argsLen;
+    next->data = NULL;
+    next->dataLen = dataLen;
+    if (argsLen > 0) {
+        next->args = (StoredString*)*block;
+        for (i = 0; i < argsLen; i++) {
+            next->args[i].data = NULL;
+            next->args[i].length = 0;
+        }
+    }
+    if (dataLen > 0)
+        next->data = *block + argsSize + charsSize;
+    return KNI_TRUE;
+}
+
+/**
+ * Replaces the invocation with its new state laid out in the new
+ * payload block and frees the old block.
+ *
+ * @param invoc the stored invocation
+ * @param next the new state of the invocation
+ * @param block the payload block of the new state
+ */
+static void payloadCommit(StoredInvoc* invoc, const StoredInvoc* next, char* block) {
+    StoredEntry* entry = ENTRY(invoc);
+
+    if (entry->payload != NULL)
+        JAVAME_FREE(entry->payload);
+    *invoc = *next;
+    entry->payload = block;
+}
+
+/**
+ * Copies the characters to the strings area of a payload block.
+ *
+ * @param str the string to point to the copy
+ * @param chars the first free jchar of the area, advanced past the copy
+ * @param data the characters, NULL to set the null string
+ * @param length the number of the characters
+ */
+static void putString(StoredString* str, jchar** chars,
+                    const jchar* data, jsize length) {
+    if (data == NULL) {
+        str->data = NULL;
+        str->length = 0;
+        return;
+    }
+    memcpy(*chars, data, length * sizeof(jchar));
+    (*chars)[length] = 0;
+    str->data = *chars;
+    str->length = length;
+    *chars += length + 1;
+}
+
+/**
+ * Copies the Java string to the strings area of a payload block.
+ *
+ * @param str the string to point to the copy
+ * @param chars the first free jchar of the area, advanced past the copy
+ * @param obj the Java string, may be null
+ */
+static void putJavaString(StoredString* str, jchar** chars, jstring obj) {
+    jsize length = KNI_IsNullHandle(obj)? -1: KNI_GetStringLength(obj);
+
+    if (length < 0) {
+        str->data = NULL;
+        str->length = 0;
+        return;
+    }
+    KNI_GetStringRegion(obj, 0, length, *chars);
+    (*chars)[length] = 0;
+    str->data = *chars;
+    str->length = length;
+    *chars += length + 1;
+}
+
+/**
+ * Returns the size of the Java string characters in a payload block.
+ */
+static size_t javaStringSize(jstring obj) {
+    jsize length = KNI_IsNullHandle(obj)? -1: KNI_GetStringLength(obj);
+    return (length < 0)? 0: STRING_SIZE(length);
+}
+
+/**
+ * Copies the strings, arguments and data of the source to a new
+ * payload block of the invocation and frees the old block.
+ * The source may refer to the old block.
+ *
+ * @param invoc the stored invocation
+ * @param src the new state of the invocation; its strings, arguments
+ *    and data may be anywhere
+ * @return KNI_TRUE on success, KNI_FALSE if out of memory; the invocation
+ *    is not changed then
+ */
+static jboolean invocSetPayload(StoredInvoc* invoc, const StoredInvoc* src) {
+    StoredInvoc next = *src;
+    size_t charsSize = 0;
+    char* block;
+    jchar* chars;
+    int i;
+
+#define sizeString(field) charsSize += STORED_SIZE(&src->field);
+    ENUM_STRING_FIELDS(sizeString)
+    sizeString(destinationApp.className)
+    sizeString(invokingApp.className)
+    for (i = 0; i < src->argsLen; i++)
+        sizeString(args[i])
+#undef sizeString
+
+    if (!payloadAlloc(&next, src->argsLen, src->dataLen, charsSize, &block, &chars))
+        return KNI_FALSE;
+
+#define copyString(field) putString(&next.field, &chars, src->field.data, src->field.length);
+    ENUM_STRING_FIELDS(copyString)
+    copyString(destinationApp.className)
+    copyString(invokingApp.className)
+    for (i = 0; i < src->argsLen; i++)
+        copyString(args[i])
+#undef copyString
+    if (src->dataLen > 0)
+        memcpy(next.data, src->data, src->dataLen);
+
+    payloadCommit(invoc, &next, block);
+    return KNI_TRUE;
 }
 
 /**
@@ -278,12 +641,13 @@ static StoredInvoc * newStoredInvoc() {
  * @param fieldid of field to store the jstring
  * @return false if the String could not allocate
  */
-static jboolean storeStringField(const pcsl_string* str,
+static jboolean storeStringField(const StoredString* str,
                     jobject invocObj, jfieldID fid, jobject tmpobj) {
-    if (str == NULL || pcsl_string_is_null(str)) {
+    if (str == NULL || str->data == NULL) {
         KNI_ReleaseHandle(tmpobj);
     } else {
-        if (PCSL_STRING_OK != midp_jstring_from_pcsl_string(str, tmpobj)) {
+        KNI_NewString(str->data, str->length, tmpobj);
+        if (KNI_IsNullHandle(tmpobj)) {
             return KNI_FALSE;
         }
     }
@@ -294,128 +658,206 @@ static jboolean storeStringField(const pcsl_string* str,
 /**
  * Extract the parameters ID, Type, URL, arguments and data
  * and update/copy their values to the InvocStore instance.
+ * All the strings, the arguments and the data are copied to a single
+ * new payload block, the old block is freed.
  * @param invoc the StoreInvoc to update
  * @param invocObj the Java invoc instance
  * @param tmp1 a temporary object
  * @param tmp2 a 2nd temporary object 
- * @return TRUE if all the allocations and modifications worked
+ * @return TRUE if all the allocations and modifications worked;
+ *    the StoredInvoc is not changed otherwise
  */
 static jboolean update(StoredInvoc* invoc, jobject invocObj, jobject tmp1, jobject tmp2) {
     // do not update tid
-    // also there is no need to update argsLen, dataLen
+    StoredInvoc next = *invoc;
+    size_t charsSize = 0;
+    char* block;
+    jchar* chars;
+    int argsLen;
+    int dataLen;
+    int i;
 
-    jboolean ret = KNI_ENOMEM;    /* Assume failure */
-    do {
-        /* On any error break out of this block */
-        int len;
-        pcsl_string* args;
+    /* Measure the strings, a null application keeps its class name */
+#define sizeString(_fname) \
+    KNI_GetObjectField(invocObj, FID(_fname), tmp1); \
+    charsSize += javaStringSize(tmp1);
+
+#define sizeAppString(_app) \
+    KNI_GetObjectField(invocObj, FID(_app), tmp2); \
+    if (KNI_IsNullHandle(tmp2)) { \
+        charsSize += STORED_SIZE(&invoc->_app.className); \
+    } else { \
+        KNI_GetObjectField(tmp2, FID(className), tmp1); \
+        charsSize += javaStringSize(tmp1); \
+    }
 
-#define updateString(_struct, _fname, _object) \
-        pcsl_string_free(&(_struct)._fname); \
-        KNI_GetObjectField(_object, FID(_fname), tmp1); \
-        if (PCSL_STRING_OK != midp_jstring_to_pcsl_string(tmp1, &(_struct)._fname)) \
-            break; \
+    ENUM_STRING_FIELDS(sizeString)
+    sizeAppString(destinationApp)
+    sizeAppString(invokingApp)
+#undef sizeString
+#undef sizeAppString
+
+    KNI_GetObjectField(invocObj, FID(data), tmp2);
+    dataLen = (KNI_IsNullHandle(tmp2)? 0: KNI_GetArrayLength(tmp2));
+    KNI_GetObjectField(invocObj, FID(arguments), tmp2);
+    argsLen = (KNI_IsNullHandle(tmp2)? 0: KNI_GetArrayLength(tmp2));
+    for (i = 0; i < argsLen; i++) {
+        KNI_GetObjectArrayElement(tmp2, i, tmp1);
+        charsSize += javaStringSize(tmp1);
+    }
 
-#define updateInvocString(_fname) updateString(*invoc, _fname, invocObj)
+    if (!payloadAlloc(&next, argsLen, dataLen, charsSize, &block, &chars))
+        return KNI_FALSE;
 
+    /* Copy the fields, nothing can fail from now on */
 #define updateInt(_fname) \
-        invoc->_fname = KNI_GetIntField(invocObj, FID(_fname)); \
+    next._fname = KNI_GetIntField(invocObj, FID(_fname));
+
+#define updateString(_fname) \
+    KNI_GetObjectField(invocObj, FID(_fname), tmp1); \
+    putJavaString(&next._fname, &chars, tmp1);
+
+#define updateApp(_app) \
+    KNI_GetObjectField(invocObj, FID(_app), tmp2); \
+    if (KNI_IsNullHandle(tmp2)) { \
+        putString(&next._app.className, &chars, \
+            invoc->_app.className.data, invoc->_app.className.length); \
+    } else { \
+        next._app.suiteID = KNI_GetIntField(tmp2, FID(suiteID)); \
+        KNI_GetObjectField(tmp2, FID(className), tmp1); \
+        putJavaString(&next._app.className, &chars, tmp1); \
+    }
 
-        ENUM_SIMPLE_INT_FIELDS(updateInt)
-        ENUM_STRING_FIELDS(updateInvocString)
+    ENUM_SIMPLE_INT_FIELDS(updateInt)
+    ENUM_STRING_FIELDS(updateString)
+    updateApp(destinationApp)
+    updateApp(invokingApp)
 #undef updateInt
-#undef updateInvocString
-    
-        // update destinationApp and invokingApp
-        KNI_GetObjectField(invocObj, FID(destinationApp), tmp1);
-        if(!KNI_IsNullHandle(tmp1)){
-            invoc->destinationApp.suiteID = KNI_GetIntField(tmp1, FID(suiteID));
-            updateString(invoc->destinationApp, className, tmp1)
-        }
-
-        KNI_GetObjectField(invocObj, FID(invokingApp), tmp1);
-        if(!KNI_IsNullHandle(tmp1)){
-            invoc->invokingApp.suiteID = KNI_GetIntField(tmp1, FID(suiteID));
-            updateString(invoc->invokingApp, className, tmp1)
-        }
-
 #undef updateString
+#undef updateApp
 
-        invoc->responseRequired = KNI_GetBooleanField(invocObj, FID(responseRequired));
+    next.responseRequired = KNI_GetBooleanField(invocObj, FID(responseRequired));
 
-        /*
-         * Copy the arguments if non-empty.
-         * Always keep the pointers safe so invocFree()
-         * can function correctly.
-         */
-        KNI_GetObjectField(invocObj, FID(arguments), tmp2);
-        len = invoc->argsLen; // old length
-        invoc->argsLen = (KNI_IsNullHandle(tmp2)? 0: KNI_GetArrayLength(tmp2)); // new length
-
-        if (len != invoc->argsLen) {
-            // free args
-            if (invoc->args != NULL) {
-                args = invoc->args;
-                while (len--) {
-                    pcsl_string_free(args++);
-                }
-                JAVAME_FREE(invoc->args);
-                invoc->args = NULL;
-            }
-            len = invoc->argsLen;
-            if (len > 0) {
-                invoc->args = (pcsl_string*)JAVAME_CALLOC(len, sizeof(pcsl_string));
-	            if (invoc->args == NULL)
-		            break;
-            }
-        }
+    /* Copy the arguments if non-empty. */
+    KNI_GetObjectField(invocObj, FID(arguments), tmp2);
+    for (i = 0; i < argsLen; i++) {
+        KNI_GetObjectArrayElement(tmp2, i, tmp1);
+        putJavaString(&next.args[i], &chars, tmp1);
+    }
 
-        args = invoc->args;
-        if (len > 0) {
-            args += len;
-            while (len--) {
-                pcsl_string_free(--args);
-                KNI_GetObjectArrayElement(tmp2, len, tmp1);
-                if (PCSL_STRING_OK != midp_jstring_to_pcsl_string(tmp1, args))
-                    break;
-            }
-        }
-    
-        /* Copy any data from the Invocation to malloc's memory. */
+    /* Copy any data from the Invocation to the payload block. */
+    if (dataLen > 0) {
         KNI_GetObjectField(invocObj, FID(data), tmp2);
-        len = (KNI_IsNullHandle(tmp2)? 0: KNI_GetArrayLength(tmp2));
+        KNI_GetRawArrayRegion(tmp2, 0, dataLen, next.data);
+    }
 
-        if (invoc->dataLen != len) {
-            if (invoc->data != NULL) {
-                JAVAME_FREE(invoc->data);
-                invoc->data = NULL;
-            }
-            if (len > 0) {
-	            invoc->data = JAVAME_MALLOC(len);
-	            if (invoc->data == NULL)
-		            break;
+    payloadCommit(invoc, &next, block);
+    return KNI_TRUE;
+}
+
+/**
+ * Registers the application in the store.
+ * The application queue is created if needed and kept for the
+ * registered application, the same handle is returned for every
+ * registration of the suiteId and classname until the suite is
+ * released by {@link #releaseSuite0}.
+ *
+ * @param suiteId the application suite
+ * @param classname the application class name, may be null
+ * @return the application handle
+ * @throws OutOfMemoryError if the memory allocation fails
+ */
+KNIEXPORT KNI_RETURNTYPE_INT
+KNIDECL(com_sun_j2me_content_InvocationStore_registerApp0) {
+    StoredCLDCAppID app;
+    AppQueue* queue = NULL;
+    jchar* chars = NULL;
+    int handle = 0;
+
+    KNI_StartHandles(1);
+    KNI_DeclareHandle(classname); /* Arg2: classname */
+
+    /* Argument indices must match Java native method declaration */
+#define registerSuiteIdArg 1
+#define registerClassnameArg 2
+
+    app.suiteID = KNI_GetParameterAsInt(registerSuiteIdArg);
+    app.className.data = NULL;
+    app.className.length = 0;
+    KNI_GetParameterAsObject(registerClassnameArg, classname);
+
+    do {
+        size_t size = javaStringSize(classname);
+        if (size > 0 && NULL == (chars = (jchar*) JAVAME_MALLOC(size)))
+            break;
+        putJavaString(&app.className, &chars, classname);
+        if (strayLinks > 0)
+            refileStrays();
+        if (NULL == (queue = appQueueGet(&app)))
+            break;
+        if (queue->handle == 0) {
+            int index = appHandleSlot();
+            int gen;
+            if (index < 0) {
+                if (queue->count == 0)
+                    appQueueFree(queue);
+                break;
             }
-            invoc->dataLen = len;
-        }
-        
-        if (len > 0) {
-            KNI_GetRawArrayRegion(tmp2, 0, len, invoc->data);
+            gen = ((appHandles[index].handle >> HANDLE_INDEX_BITS) + 1) & HANDLE_GEN_MASK;
+            appHandles[index].queue = queue;
+            appHandles[index].handle = (gen << HANDLE_INDEX_BITS) | (index + 1);
+            queue->handle = appHandles[index].handle;
         }
-    
-        /* Clear to indicate everything worked. */
-        ret = KNI_TRUE;
+        handle = queue->handle;
     } while (0);
 
-    return ret;
+    if (app.className.data != NULL)
+        JAVAME_FREE((void*)app.className.data);
+    if (handle == 0)
+        KNI_ThrowNew(jsropOutOfMemoryError, "InvocationStore_registerApp0");
+
+#undef registerSuiteIdArg
+#undef registerClassnameArg
+    KNI_EndHandles();
+    KNI_ReturnInt(handle);
+}
+
+/**
+ * Releases the handles of all the registered applications of the
+ * suite. The queues left empty are freed, the released handles no
+ * longer match any application.
+ *
+ * @param suiteId the removed suite
+ */
+KNIEXPORT KNI_RETURNTYPE_VOID
+KNIDECL(com_sun_j2me_content_InvocationStore_releaseSuite0) {
+    /* Argument indices must match Java native method declaration */
+#define releaseSuiteIdArg 1
+    SuiteIdType suiteId = KNI_GetParameterAsInt(releaseSuiteIdArg);
+    int i;
+
+    for (i = 0; i < appHandlesCount; i++) {
+        AppQueue* queue = appHandles[i].queue;
+        if (queue != NULL && queue->suiteID == suiteId) {
+            appHandles[i].queue = NULL;
+            appHandlesFree++;
+            queue->handle = 0;
+            if (queue->count == 0)
+                appQueueFree(queue);
+        }
+    }
+
+#undef releaseSuiteIdArg
+    KNI_ReturnVoid();
 }
 
 /**
  * Implementation of native method to queue a new Invocation.
  * The state of the InvocationImpl is copied to the heap
  * and inserted in the head of the invocation queue.
- * An StoredInvoc struct is allocated on the native heap and 
- * the non-null strings for each field of the InvocationImpl class
- * are copied to the heap.
+ * An StoredInvoc struct is taken from the slab pool and
+ * the non-null strings for each field of the InvocationImpl class,
+ * the arguments and the data are copied to its payload block.
  * A new transaction ID is assigned to this Invocation
  * and returned in the tid field of the InvocationImpl.
  * @param invoc the InvocationImpl to store
@@ -488,41 +930,35 @@ KNIDECL(com_sun_j2me_content_InvocationStore_put0) {
  * replenished then the operation can be retried.
  *
  * @param invoc an Invocation Object to fill in
- * @param suiteId to match a pending invocation
- * @param classname to match a pending invocation
+ * @param app the handle of the application to match
  * @param mode one of {@link #MODE_REQUEST}, {@link #MODE_RESPONSE},
  *    or {@link #MODE_CLEANUP}
  * @param blocking true to block until a matching invocation is available
  * @return 1 if a matching invocation was found and returned 
- *    in its entirety; zero if there was no matching invocation;
- *    -1 if the sizes of the arguments or parameter array were wrong
+ *    in its entirety, the arguments and data arrays are allocated
+ *    as needed; zero if there was no matching invocation
  * @see StoredInvoc
  */
 
 KNIEXPORT KNI_RETURNTYPE_INT
 KNIDECL(com_sun_j2me_content_InvocationStore_get0) {
     int ret = 0;          /* return value = nothing matched */
-    KNI_StartHandles(5);
+    KNI_StartHandles(4);
     KNI_DeclareHandle(classObj);
     KNI_DeclareHandle(obj);      /* multipurpose handle */
     KNI_DeclareHandle(argsObj);      /* handle for argument array */
     KNI_DeclareHandle(invocObj);  /* Arg1: Invocation object; non-null */
-    KNI_DeclareHandle(classname); /* Arg3: non-null classname */
-    int mode = MODE_REQUEST;      /* Arg4: mode for get */
-    jint blockID = 0; /* Arg5: 0 if shouldn't block */
+    int mode = MODE_REQUEST;      /* Arg3: mode for get */
+    jint blockID = 0; /* Arg4: 0 if shouldn't block */
 
     /* Argument indices must match Java native method declaration */
 #define getInvokeObjArg 1
-#define getSuiteIdArg 2
-#define getClassnameArg 3
-#define getModeArg 4
-#define getBlockIDArg 5
+#define getAppArg 2
+#define getModeArg 3
+#define getBlockIDArg 4
 
     StoredLink* match = NULL;
 
-    SuiteIdType desiredSuiteId;
-    pcsl_string desiredClassname = PCSL_STRING_NULL_INITIALIZER;
-
     do {/* Block to break out of on exceptions */
         /* Check if blocked invocation was cancelled. */
         if (isThreadCancelled()) {
@@ -537,21 +973,10 @@ KNIDECL(com_sun_j2me_content_InvocationStore_get0) {
         if (!isEmpty()) {
             /* Get the desired type of invocation. */
             mode = KNI_GetParameterAsInt(getModeArg);
-            desiredSuiteId = KNI_GetParameterAsInt(getSuiteIdArg);
-            KNI_GetParameterAsObject(getClassnameArg, classname);
-            if (PCSL_STRING_OK != 
-                    midp_jstring_to_pcsl_string(classname, &desiredClassname)) {
-                KNI_ThrowNew(jsropOutOfMemoryError, 
-                   "InvocationStore_get0 no memory for [desiredClassname]");
-                break;
-            }
-            match = invocFind(desiredSuiteId, &desiredClassname, mode);
+            match = invocFind(appQueueForHandle(KNI_GetParameterAsInt(getAppArg)), mode);
         }
     } while (KNI_FALSE);
 
-    /* Always free strings allocated */
-    pcsl_string_free(&desiredClassname);
-
     if (match != NULL) {
         StoredInvoc *invoc = match->invoc;
         /* Queue is not empty, get InvocationImpl obj and init. */
@@ -571,6 +996,7 @@ KNIDECL(com_sun_j2me_content_InvocationStore_get0) {
                      * Keep this entry in the queue.
                      */
                     invoc->status = STATUS_ACTIVE;
+                    invocRefile(match);
                     KNI_SetIntField(invocObj, FID(status), invoc->status);
                 }
                 break;
@@ -597,9 +1023,6 @@ KNIDECL(com_sun_j2me_content_InvocationStore_get0) {
             KNI_ThrowNew(jsropOutOfMemoryError, "invocStore returning strings");
             KNI_ReleaseHandle(invocObj);
             break;
-        default:
-            /* Either args array or data array is incorrect size. */
-            ;
         }
     } else {
         /* No match found. */
@@ -650,9 +1073,6 @@ KNIDECL(com_sun_j2me_content_InvocationStore_getByTid0) {
                     KNI_ThrowNew(jsropOutOfMemoryError, "invocStore returning strings");
                     KNI_ReleaseHandle(invocObj);
                     break;
-                default:
-                    /* Either args array or data array is incorrect size. */
-                    ;
             }
         }
 #undef modeArgIdx 
@@ -665,14 +1085,15 @@ KNIDECL(com_sun_j2me_content_InvocationStore_getByTid0) {
 
 /**
  * Copy a native Invocation to the supplied Invocation instance.
+ * The args and data arrays are replaced by the arrays of
+ * the stored sizes unless the Invocation already has them.
  * @param invoc the native InvocStore 
  * @param mode the mode of copyout
  * @param invocObj the Invocation object to copy to
  * @param argsObj an object to use to refer to the arguments array
  * @param obj a temporary object handle
- * @return 0 if there were problems allocating Java Strings;
- *    1 if all the copies succeeded;
- *    -1 if the Java Arrays allocated for args or data were insufficient
+ * @return 0 if there were problems allocating Java Strings or Arrays;
+ *    1 if all the copies succeeded
  */
 static int copyOut(const StoredInvoc *invoc, int mode, 
                     jobject invocObj, jobject argsObj, jobject obj)
@@ -686,18 +1107,22 @@ static int copyOut(const StoredInvoc *invoc, int mode,
     storeInt(argsLen)
     storeInt(dataLen);
 
-    /* Check if size of argument array and data array are correct. */
+    /* Allocate the argument array and data array of the stored sizes. */
     KNI_GetObjectField(invocObj, FID(data), obj);
     datalen = KNI_GetArrayLength(obj);
     if (datalen != invoc->dataLen) {
-        /* Data array allocated by Java has not correct size. */
-        return -1;
+        SNI_NewArray(SNI_BYTE_ARRAY, invoc->dataLen, obj);
+        if (KNI_IsNullHandle(obj))
+            return 0;
+        KNI_SetObjectField(invocObj, FID(data), obj);
     }
     KNI_GetObjectField(invocObj, FID(arguments), obj);
     arraylen = KNI_GetArrayLength(obj);
     if (arraylen != invoc->argsLen) {
-        /* Args array allocated by Java has not correct size. */
-        return -1;
+        SNI_NewArray(SNI_STRING_ARRAY, invoc->argsLen, obj);
+        if (KNI_IsNullHandle(obj))
+            return 0;
+        KNI_SetObjectField(invocObj, FID(arguments), obj);
     }
 
 #define store(name) storeStringField(&invoc->name, invocObj, FID(name), obj) &&
@@ -732,10 +1157,10 @@ static int copyOut(const StoredInvoc *invoc, int mode,
 
 #undef storeInt
 
-    /* Return the arguments if any; array length already checked. */
+    /* Return the arguments if any; array length already matches. */
     if (invoc->argsLen > 0) {
         int ndx;
-        pcsl_string* args;
+        const StoredString* args;
     
         /* For each stored arg create a string and store in the array.
          * No stored arg is null.  If a string cannot be created
@@ -744,8 +1169,9 @@ static int copyOut(const StoredInvoc *invoc, int mode,
         KNI_GetObjectField(invocObj, FID(arguments), argsObj);
         args = invoc->args;
         for (ndx = 0; ndx < invoc->argsLen; ndx++, args++) {
-            if (!pcsl_string_is_null(args)) {
-                if (PCSL_STRING_OK != midp_jstring_from_pcsl_string(args, obj)) {
+            if (args->data != NULL) {
+                KNI_NewString(args->data, args->length, obj);
+                if (KNI_IsNullHandle(obj)) {
                     /* String create failed; exit now. */
                     return 0;
                 }
@@ -756,7 +1182,7 @@ static int copyOut(const StoredInvoc *invoc, int mode,
         }
     }
 
-    /* Return the data array if any; array length was already checked. */
+    /* Return the data array if any; array length already matches. */
     if (invoc->dataLen > 0) {
         KNI_GetObjectField(invocObj, FID(data), obj);
         KNI_SetRawArrayRegion(obj, 0, invoc->dataLen, invoc->data);
@@ -775,8 +1201,7 @@ static int copyOut(const StoredInvoc *invoc, int mode,
  * once.  When an Invocation is returned; it is marked as being
  * notified.
  *
- * @param suiteId to match a pending invocation
- * @param classname to match a pending invocation
+ * @param app the handle of the application to match
  * @param mode one of {@link #MODE_REQUEST}, {@link #MODE_RESPONSE},
  *    or {@link #MODE_CLEANUP}
  * @param blocking true to block until a matching invocation is available
@@ -786,19 +1211,13 @@ static int copyOut(const StoredInvoc *invoc, int mode,
 KNIEXPORT KNI_RETURNTYPE_BOOLEAN
 KNIDECL(com_sun_j2me_content_InvocationStore_listen0) {
     StoredLink* match = NULL;
-    SuiteIdType desiredSuiteId;
-    pcsl_string desiredClassname = PCSL_STRING_NULL_INITIALIZER;
-
-    KNI_StartHandles(1);
-    KNI_DeclareHandle(classname); /* Arg2: non-null classname */
-    int mode;                  /* Arg3: requested invocation mode */
-    jint blockID = 0; /* Arg4: 0 if shouldn't block */
+    int mode;                  /* Arg2: requested invocation mode */
+    jint blockID = 0; /* Arg3: 0 if shouldn't block */
 
     /* Argument indices must match Java native method declaration */
-#define listenSuiteIdArg 1
-#define listenClassnameArg 2
-#define listenModeArg 3
-#define listenBlockIDArg 4
+#define listenAppArg 1
+#define listenModeArg 2
+#define listenBlockIDArg 3
 
     do {/* Block to break out of on exceptions */
         /* Check if blocked invocation was cancelled. */
@@ -811,27 +1230,12 @@ KNIDECL(com_sun_j2me_content_InvocationStore_listen0) {
         blockID = KNI_GetParameterAsInt(listenBlockIDArg);
     
         if (!isEmpty()) {
-            /* Queue is not empty
-             * Need a string copy of the desired suiteID and classname
-             * to use for comparisons
-             */
-            desiredSuiteId = KNI_GetParameterAsInt(listenSuiteIdArg);
-            KNI_GetParameterAsObject(listenClassnameArg, classname);
-            if (PCSL_STRING_OK != midp_jstring_to_pcsl_string(classname, &desiredClassname)) {
-                KNI_ThrowNew(jsropOutOfMemoryError, 
-                    "InvocationStore_listen0 no memory for [desiredClassname]");
-                break;
-            }
-
             /* Get the desired request mode. */
             mode = KNI_GetParameterAsInt(listenModeArg);
-            match = invocFind(desiredSuiteId, &desiredClassname, mode);
+            match = invocFind(appQueueForHandle(KNI_GetParameterAsInt(listenAppArg)), mode);
         }
     } while (KNI_FALSE);
 
-    /* Always free strings allocated */
-    pcsl_string_free(&desiredClassname);
-
     if (match != NULL) {
         match->invoc->notified = KNI_TRUE;
     } else {
@@ -842,7 +1246,9 @@ KNIDECL(com_sun_j2me_content_InvocationStore_listen0) {
         }
     }
 
-    KNI_EndHandles();
+#undef listenAppArg
+#undef listenModeArg
+#undef listenBlockIDArg
     KNI_ReturnBoolean(match != NULL);
 }
 
@@ -851,78 +1257,33 @@ KNIDECL(com_sun_j2me_content_InvocationStore_listen0) {
  * Resets the request or response flags for listener notification.
  * Each request or response is marked as not having been notified.
  *
- * @param suiteId to match a pending invocation
- * @param classname to match a pending invocation
+ * @param app the handle of the application to match
  * @param mode one of {@link #MODE_LREQUEST}, {@link #MODE_LRESPONSE}
  */
 KNIEXPORT KNI_RETURNTYPE_VOID
 KNIDECL(com_sun_j2me_content_InvocationStore_resetListenNotifiedFlag0) {
     StoredLink* link;
-    StoredInvoc* invoc;
-    SuiteIdType desiredSuiteId;
-    pcsl_string desiredClassname = PCSL_STRING_NULL_INITIALIZER;
-
-    KNI_StartHandles(1);
-    KNI_DeclareHandle(classname); /* Arg2: non-null classname */
-    int mode;                  /* Arg3: requested invocation mode */
+    AppQueue* queue;
+    int mode;                  /* Arg2: requested invocation mode */
 
     /* Argument indices must match Java native method declaration */
-#define listenSuiteIdArg 1
-#define listenClassnameArg 2
-#define listenModeArg 3
-
-    do {/* Block to break out of on exceptions */
-        if (!isEmpty()) {
-            /* Queue is not empty
-             * Need a string copy of the desired suiteId and classname
-             * to use for comparisons
-             */
-            desiredSuiteId = KNI_GetParameterAsInt(listenSuiteIdArg);
-    
-            KNI_GetParameterAsObject(listenClassnameArg, classname);
-            if (PCSL_STRING_OK != midp_jstring_to_pcsl_string(classname, &desiredClassname)) {
-                KNI_ThrowNew(jsropOutOfMemoryError, 
-                    "InvocationStore_setListenNotify0 no memory for [desiredClassname]");
-                break;
-            }
-    
-            /* Get the desired request mode. */
-            mode = KNI_GetParameterAsInt(listenModeArg);
-    
-            /* Inspect the queue of Invocations and pick one that
-             * matches the suiteId and classname
-             */
-            for (link = invocQueue; link != NULL; link = link->flink) {
-                invoc = link->invoc;
-                /*
-                 * If the status matches the request
-                 * and the suite matches and the classname matches.
-                 */
-                if (mode == MODE_LREQUEST && invoc->status == STATUS_WAITING) {
-                   /* This invocation is a match; check classname and suite below */
-                } else if (mode == MODE_LRESPONSE &&
-                            (invoc->status >= STATUS_OK && invoc->status <= STATUS_INITIATED)) {
-                    /* A pending response; check classname and suite below */
-                } else {
-                    /* Not this invocation; on to the next */
-                    continue;
-                }
-                /* Check if this is the right class and suite */
-                if (desiredSuiteId == invoc->destinationApp.suiteID &&
-                        pcsl_string_equals(&desiredClassname, &invoc->destinationApp.className)) {
-                    /* Reset the flag so this Invocation will notify. */
-                    invoc->notified = KNI_FALSE;
-                }
-            }
+#define listenAppArg 1
+#define listenModeArg 2
+
+    queue = appQueueForHandle(KNI_GetParameterAsInt(listenAppArg));
+    mode = KNI_GetParameterAsInt(listenModeArg);
+
+    /* Inspect the status list of the application queue */
+    if (queue != NULL && (mode == MODE_LREQUEST || mode == MODE_LRESPONSE)) {
+        link = queue->heads[mode == MODE_LREQUEST? LIST_WAITING: LIST_RESPONSE];
+        for (; link != NULL; link = link->sflink) {
+            /* Reset the flag so this Invocation will notify. */
+            link->invoc->notified = KNI_FALSE;
         }
-    } while (KNI_FALSE);
-
-    /* TBD: MidpMalloc failure not reported; not found is returned */
-
-    /* Always free strings allocated */
-    pcsl_string_free(&desiredClassname);
+    }
 
-    KNI_EndHandles();
+#undef listenAppArg
+#undef listenModeArg
     KNI_ReturnVoid();
 }
 
@@ -932,8 +1293,8 @@ KNIDECL(com_sun_j2me_content_InvocationStore_resetListenNotifiedFlag0) {
  * by suiteId and classname so they can be cleaned up on
  * exit.
  *
- * @param suiteId to match a pending invocation
- * @param classname to match a pending invocation
+ * @param app the handle of the application to match
+ * @param cleanup the flag value to set
  * @see StoredInvoc
  * @see #invocQueue
  */
@@ -941,59 +1302,25 @@ KNIEXPORT KNI_RETURNTYPE_VOID
 KNIDECL(com_sun_j2me_content_InvocationStore_setCleanupFlag0) {
     StoredLink* link;
     StoredInvoc* invoc;
-    SuiteIdType desiredSuiteId;
-    pcsl_string desiredClassname = PCSL_STRING_NULL_INITIALIZER;
+    AppQueue* queue;
     jboolean cleanup;
 
-    KNI_StartHandles(1);
-    KNI_DeclareHandle(classname); /* Arg2: non-null classname */
-
     /* Argument indices must match Java native method declaration */
-#define markSuiteIdArg 1
-#define markClassnameArg 2
-#define markCleanup 3
-
-    do {/* Block to break out of on exceptions */
-
-    if (!isEmpty()) {
-        /* Queue is not empty
-         * Need a string copy of the desired classname
-         * to use for comparisons
-         */
-        desiredSuiteId = KNI_GetParameterAsInt(markSuiteIdArg);
-
-        KNI_GetParameterAsObject(markClassnameArg, classname);
-        if (PCSL_STRING_OK != midp_jstring_to_pcsl_string(classname, 
-                           &desiredClassname)) {
-            KNI_ThrowNew(jsropOutOfMemoryError, 
-                "InvocationStore_setListenCleanup0 no memory for [desiredClassname]");
-            break;
-        }
+#define markAppArg 1
+#define markCleanup 2
 
-        cleanup = KNI_GetParameterAsBoolean(markCleanup);
+    queue = appQueueForHandle(KNI_GetParameterAsInt(markAppArg));
+    cleanup = KNI_GetParameterAsBoolean(markCleanup);
 
-        /* Inspect the queue of Invocations and pick one that
-         * matches the suiteId and classname.
-         */
-        for (link = invocQueue; link != NULL; link = link->flink) {
-            invoc = link->invoc;
-            /*
-             * If the suite matches and the classname matches
-             * set cleanup to the next tid;
-             */
-            if (desiredSuiteId == invoc->destinationApp.suiteID &&
-                    pcsl_string_equals(&desiredClassname, &invoc->destinationApp.className)) {
-                /* Found an entry for the Invocation */
-                invoc->cleanup = cleanup;
-                invoc->notified = KNI_FALSE;
-            }
-        }
+    /* Mark all the Invocations of the application queue */
+    for (link = (queue != NULL)? queue->head: NULL; link != NULL; link = link->aflink) {
+        invoc = link->invoc;
+        invoc->cleanup = cleanup;
+        invoc->notified = KNI_FALSE;
     }
-    } while (0);
-    
-    pcsl_string_free(&desiredClassname);
 
-    KNI_EndHandles();
+#undef markAppArg
+#undef markCleanup
     KNI_ReturnVoid();
 }
 
@@ -1009,48 +1336,49 @@ KNIDECL(com_sun_j2me_content_InvocationStore_unblockWaitingThreads0) {
     KNI_ReturnVoid();
 }
 
-// int requestsCount0(int suiteId, String classname);
+// int requestsCount0(int suiteId, int app);
 KNIEXPORT KNI_RETURNTYPE_INT
 KNIDECL(com_sun_j2me_content_InvocationStore_requestsCount0) {
     /* Argument indices must match Java native method declaration */
 #define rqcSuiteIdArg 1
-#define rqcClassnameArg 2
+#define rqcAppArg 2
 
     StoredLink* link;
     int count = 0;
     int suiteId = KNI_GetParameterAsInt(rqcSuiteIdArg);
-    pcsl_string classname = PCSL_STRING_NULL_INITIALIZER;
-    KNI_StartHandles(1);
-    KNI_DeclareHandle(hclassname);
-    KNI_GetParameterAsObject(rqcClassnameArg, hclassname);
-    do { // fake loop
-        if (PCSL_STRING_OK != midp_jstring_to_pcsl_string(hclassname, &classname)) {
-            KNI_ThrowNew(jsropOutOfMemoryError, "InvocationStore_requestsCount0");
-            break;
+    int app = KNI_GetParameterAsInt(rqcAppArg);
+
+    if( suiteId == UNUSED_SUITE_ID ){
+        count = 2 * invocCount;
+    } else if( app != 0 ){
+        /* The destination matches are counted by the application queue
+         * unless it may hold stray links or belongs to another suite,
+         * the invoking application is not indexed. */
+        AppQueue* queue = appQueueForHandle(app);
+        if( queue != NULL ){
+            jboolean byQueue = strayLinks == 0 && queue->suiteID == suiteId;
+            if( byQueue )
+                count = queue->count;
+            for (link = invocQueue; link != NULL; link = link->flink) {
+                if( !byQueue && link->invoc->destinationApp.suiteID == suiteId &&
+                        stringsEqual(&queue->className, &link->invoc->destinationApp.className) )
+                    count++;
+                if( link->invoc->invokingApp.suiteID == suiteId &&
+                        stringsEqual(&queue->className, &link->invoc->invokingApp.className) )
+                    count++;
+            }
         }
-        /* Inspect the queue of Invocations and pick one that
-         * matches the suiteId and classname.
-         */
+    } else {
         for (link = invocQueue; link != NULL; link = link->flink) {
-            if( suiteId == UNUSED_SUITE_ID ){
-                count += 2;
-            } else {
-                if( link->invoc->destinationApp.suiteID == suiteId ){
-                    if( pcsl_string_is_null(&classname) || pcsl_string_equals(&classname, &link->invoc->destinationApp.className) )
-                        count++;
-                }
-                if( link->invoc->invokingApp.suiteID == suiteId ){
-                    if( pcsl_string_is_null(&classname) || pcsl_string_equals(&classname, &link->invoc->invokingApp.className) )
-                        count++;
-                }
-            }
+            if( link->invoc->destinationApp.suiteID == suiteId )
+                count++;
+            if( link->invoc->invokingApp.suiteID == suiteId )
+                count++;
         }
-        pcsl_string_free(&classname);
-    } while(0);
-    KNI_EndHandles();
+    }
 
 #undef rqcSuiteIdArg
-#undef rqcClassnameArg
+#undef rqcAppArg
     KNI_ReturnInt(count);
 }
 
@@ -1073,6 +1401,7 @@ KNIDECL(com_sun_j2me_content_InvocationStore_update0) {
     match = invocFindTid(KNI_GetIntField(invocObj, FID(tid)));
     if( match != NULL && match->invoc != NULL ){
         update(match->invoc, invocObj, tmp1, tmp2);
+        invocRefile(match);
         unblockWaitingThreads(JSR211_WAIT_OK, 0, JSR211_WAIT_OK);
     }    
 
@@ -1117,47 +1446,58 @@ KNIDECL(com_sun_j2me_content_InvocationStore_dispose0) {
  *
  */
 static jboolean invocPut(StoredInvoc* invoc) {
-    StoredLink *link, *last;
+    StoredLink *link = &ENTRY(invoc)->link;
+    StoredLink *last;
 
 #ifdef DEBUG_INVOCLC
     printf( "invocPut: handlerID '%ls', class = '%ls'\n", 
                             invoc->ID.data, invoc->destinationApp.className.data );
 #endif
 
-    link = (StoredLink*) JAVAME_CALLOC(1, sizeof(StoredLink));
-    if (link == NULL) 
+    memset(link, '\0', sizeof(*link));
+    link->invoc = invoc;
+    link->seq = ++lastSeq;
+    if (!appQueueAdd(link)) {
+        link->invoc = NULL;
         return PCSL_FALSE;
+    }
+    if (!tidIndexAdd(link)) {
+        appQueueRemove(link);
+        link->invoc = NULL;
+        return PCSL_FALSE;
+    }
 
-    link->invoc = invoc;
     if (invocQueue == NULL) {
         invocQueue = link;
     } else {
-        for (last = invocQueue; last->flink != NULL; last = last->flink);
+        last = invocQueueTail;
         link->blink = last;
         last->flink = link;
     }
+    invocQueueTail = link;
+    invocCount++;
 
     return PCSL_TRUE;
 }
 
 /**
- * Function to find a matching entry in the queue.
- * The suiteId and classname must match.  If the request param
+ * Function to find a matching entry in the application queue.
+ * If the request param
  * is true then a new Invocation (INIT status) is returned.
  * If false, then an OK, CANCELLED, INITIATED, or ERROR
  * status is selected.  Other status values are ignored.
  *
- * @param suiteId the application suite
- * @param classname a string identifying the entry point
+ * @param queue the application queue, may be NULL
  * @param mode one of {@link #MODE_REQUEST}, {@link #MODE_RESPONSE},
  *    or {@link #MODE_CLEANUP}, {@link #MODE_LREQUEST},
  *    {@link #MODE_LRESPONSE}
  * @return a StoredLink if a matching one is found; NULL otherwise
  */
-static StoredLink* invocFind(SuiteIdType suiteId, 
-                                const pcsl_string* classname, int mode) {
+static StoredLink* invocFind(AppQueue* queue, int mode) {
     StoredLink* curr;
+    StoredLink* next;
     StoredInvoc* invoc;
+    int list = LIST_COUNT;
 
 #ifdef TRACE_INVOCFIND
     {
@@ -1169,47 +1509,49 @@ static StoredLink* invocFind(SuiteIdType suiteId,
             case MODE_LRESPONSE: m = "MODE_LRESPONSE"; break;
             case MODE_CLEANUP: m = "MODE_CLEANUP"; break;
         }
-        printf( "invocFind: class = '%ls', mode = %s\n", classname->data, m );
+        printf( "invocFind: class = '%ls', mode = %s\n", 
+                (queue != NULL)? queue->className.data: NULL, m );
     }
 #endif
 
-    /* Inspect the queue of Invocations and pick one that
-     * matches the suiteId and classname.
-     */
-    for (curr = invocQueue; curr != NULL; ) {
+    /* The requests and responses are looked up in their status lists only. */
+    if (queue == NULL)
+        return NULL;
+    switch (mode) {
+    case MODE_REQUEST:
+    case MODE_LREQUEST:
+        list = LIST_WAITING;
+        break;
+    case MODE_RESPONSE:
+    case MODE_LRESPONSE:
+        list = LIST_RESPONSE;
+        break;
+    }
+
+    for (curr = (list != LIST_COUNT)? queue->heads[list]: queue->head; curr != NULL; 
+                                                                    curr = next) {
         invoc = curr->invoc;
+        next = (list != LIST_COUNT)? curr->sflink: curr->aflink;
 #ifdef TRACE_INVOCFIND
         printf( "invoc: tid = %d, status = %d, responseReq = %d, ID = '%ls', class = '%ls'\n",
                 invoc->tid, invoc->status, invoc->responseRequired, invoc->ID.data, invoc->destinationApp.className.data );
 #endif
-        /*
-         * If the status matches the request
-         * and the suite matches and the classname matches.
-         */
-        if (suiteId == invoc->destinationApp.suiteID && pcsl_string_equals(classname, &invoc->destinationApp.className)){
-#ifdef TRACE_INVOCFIND
-            printf( "\ttid & classname are OK\n" );
-#endif
-            if(modeCheck(invoc, mode)) {
+        if(modeCheck(invoc, mode)) {
 #ifdef TRACE_INVOCFIND
-                printf( "\tmode OK\n" );
+            printf( "\tmode OK\n" );
 #endif
-                if (mode == MODE_CLEANUP) {
-                    /* An active or waiting Invocation needs a response */
-                    if ((invoc->status != STATUS_WAITING && invoc->status != STATUS_ACTIVE) ||
-                            !invoc->responseRequired) {
-                        /* A regular response, discard and continue */
-                        StoredLink* next = curr->flink;
-                        removeEntry(curr);
-                        invocFree(invoc);
-                        curr = next;
-                        continue;
-                    }
+            if (mode == MODE_CLEANUP) {
+                /* An active or waiting Invocation needs a response */
+                if ((invoc->status != STATUS_WAITING && invoc->status != STATUS_ACTIVE) ||
+                        !invoc->responseRequired) {
+                    /* A regular response, discard and continue */
+                    removeEntry(curr);
+                    invocFree(invoc);
+                    continue;
                 }
-                return curr;
             }
+            return curr;
         }
-        curr = curr->flink;
     }
     return NULL;
 }
@@ -1263,14 +1605,481 @@ static jboolean modeCheck(StoredInvoc* invoc, int mode) {
  */
 static StoredLink* invocFindTid(int tid) {
     StoredLink* curr;
+    int mask = tidIndex.size - 1;
+    int i;
 
-    /* Inspect the queue of Invocations and pick one that
-     * matches the TID.
-     */
-    for (curr = invocQueue; curr != NULL && tid != curr->invoc->tid; curr = curr->flink);
+    if (tidIndex.links == NULL)
+        return NULL;
+
+    /* Probe the index slots starting from the tid hash */
+    for (i = tidHash(tid) & mask; (curr = tidIndex.links[i]) != NULL; 
+                                                    i = (i + 1) & mask) {
+        if (tid == curr->invoc->tid)
+            break;
+    }
     return curr;
 }
 
+/**
+ * Spreads the tid bits over the index slots.
+ */
+static int tidHash(int tid) {
+    unsigned int h = (unsigned int)tid * 0x9E3779B1u;
+    return (int)((h ^ (h >> 16)) & 0x7FFFFFFF);
+}
+
+/**
+ * Doubles the number of the index slots and reinserts the links.
+ *
+ * @return KNI_TRUE on success, KNI_FALSE if out of memory
+ */
+static jboolean tidIndexGrow() {
+    StoredLink** links = tidIndex.links;
+    int size = tidIndex.size;
+    int newSize = (size == 0)? TID_INDEX_MIN_SIZE: size * 2;
+    int mask = newSize - 1;
+    int i, j;
+
+    tidIndex.links = (StoredLink**) JAVAME_CALLOC(newSize, sizeof(StoredLink*));
+    if (tidIndex.links == NULL) {
+        tidIndex.links = links;
+        return KNI_FALSE;
+    }
+    tidIndex.size = newSize;
+
+    for (i = 0; i < size; i++) {
+        if (links[i] != NULL) {
+            for (j = tidHash(links[i]->invoc->tid) & mask; 
+                    tidIndex.links[j] != NULL; j = (j + 1) & mask);
+            tidIndex.links[j] = links[i];
+        }
+    }
+    if (links != NULL)
+        JAVAME_FREE(links);
+    return KNI_TRUE;
+}
+
+/**
+ * Adds the link to the tid index. The link must be put to the queue tail,
+ * so it is chained after the queued links with the same tid.
+ *
+ * @param link the link to add
+ * @return KNI_TRUE on success, KNI_FALSE if out of memory
+ */
+static jboolean tidIndexAdd(StoredLink* link) {
+    StoredLink* first;
+    int mask, i;
+
+    link->tlink = NULL;
+    first = invocFindTid(link->invoc->tid);
+    if (first != NULL) {
+        while (first->tlink != NULL)
+            first = first->tlink;
+        first->tlink = link;
+        return KNI_TRUE;
+    }
+
+    /* keep the load factor under 3/4 */
+    if ((tidIndex.count + 1) * 4 > tidIndex.size * 3 && !tidIndexGrow())
+        return KNI_FALSE;
+
+    mask = tidIndex.size - 1;
+    for (i = tidHash(link->invoc->tid) & mask; 
+            tidIndex.links[i] != NULL; i = (i + 1) & mask);
+    tidIndex.links[i] = link;
+    tidIndex.count++;
+    return KNI_TRUE;
+}
+
+/**
+ * Removes the link from the tid index.
+ * The freed slot is filled by shifting back the following links of
+ * the probe sequence, so lookups need no deleted slot markers.
+ *
+ * @param link the link to remove
+ */
+static void tidIndexRemove(StoredLink* link) {
+    int mask = tidIndex.size - 1;
+    int i, j, k;
+    StoredLink* prev;
+
+    if (tidIndex.links == NULL)
+        return;
+
+    for (i = tidHash(link->invoc->tid) & mask; tidIndex.links[i] != NULL; 
+                                                    i = (i + 1) & mask) {
+        if (link->invoc->tid == tidIndex.links[i]->invoc->tid)
+            break;
+    }
+    if (tidIndex.links[i] == NULL)
+        return;
+
+    if (tidIndex.links[i] != link) {
+        /* unchain from the links with the same tid */
+        for (prev = tidIndex.links[i]; prev->tlink != NULL && prev->tlink != link; 
+                                                    prev = prev->tlink);
+        if (prev->tlink == link)
+            prev->tlink = link->tlink;
+        return;
+    }
+
+    if (link->tlink != NULL) {
+        tidIndex.links[i] = link->tlink;
+        return;
+    }
+
+    /* free the slot and shift back the displaced links */
+    tidIndex.links[i] = NULL;
+    tidIndex.count--;
+    for (j = (i + 1) & mask; tidIndex.links[j] != NULL; j = (j + 1) & mask) {
+        k = tidHash(tidIndex.links[j]->invoc->tid) & mask;
+        /* move the link if its home slot k is not within (i, j] */
+        if ((i <= j)? (i < k && k <= j): (i < k || k <= j))
+            continue;
+        tidIndex.links[i] = tidIndex.links[j];
+        tidIndex.links[j] = NULL;
+        i = j;
+    }
+}
+
+/**
+ * Computes the hash of the destination application.
+ */
+static unsigned int appHash(SuiteIdType suiteId, const StoredString* classname) {
+    unsigned int h = (unsigned int)suiteId * 0x9E3779B1u;
+    if (classname->data != NULL)
+        h ^= jsr211_hash_key(classname->data, (size_t)classname->length);
+    return h;
+}
+
+/**
+ * Returns the status list for the invocation status.
+ */
+static int statusList(jint status) {
+    if (status == STATUS_WAITING)
+        return LIST_WAITING;
+    if (status >= STATUS_OK && status <= STATUS_INITIATED)
+        return LIST_RESPONSE;
+    return LIST_OTHER;
+}
+
+/**
+ * Looks up the queue in the hash table.
+ */
+static AppQueue* appQueueLookup(SuiteIdType suiteId, const StoredString* classname) {
+    unsigned int hash;
+    AppQueue* queue;
+
+    if (appQueues == NULL)
+        return NULL;
+
+    hash = appHash(suiteId, classname);
+    for (queue = appQueues[hash & (appQueuesSize - 1)]; queue != NULL; queue = queue->next) {
+        if (queue->hash == hash && queue->suiteID == suiteId &&
+                stringsEqual(&queue->className, classname))
+            break;
+    }
+    return queue;
+}
+
+/**
+ * Refiles the links left in a wrong application queue.
+ */
+static void refileStrays() {
+    StoredLink* link;
+    int strays = strayLinks;
+
+    strayLinks = 0;
+    for (link = invocQueue; link != NULL && strays > 0; link = link->flink) {
+        AppQueue* queue = link->queue;
+        if (queue->suiteID != link->invoc->destinationApp.suiteID ||
+                !stringsEqual(&queue->className, &link->invoc->destinationApp.className)) {
+            strays--;
+            invocRefile(link);
+        }
+    }
+}
+
+/**
+ * Finds the queue of the registered application.
+ *
+ * @param handle the application handle
+ * @return the queue or NULL if the handle is not valid
+ */
+static AppQueue* appQueueForHandle(int handle) {
+    int index = (handle & HANDLE_INDEX_MASK) - 1;
+
+    if (strayLinks > 0)
+        refileStrays();
+    if (handle <= 0 || index < 0 || index >= appHandlesCount ||
+            appHandles[index].handle != handle)
+        return NULL;
+    return appHandles[index].queue;
+}
+
+/**
+ * Finds a free slot of the registered applications table,
+ * the table grows if there is no released slot.
+ *
+ * @return the slot index or -1 if out of memory
+ */
+static int appHandleSlot() {
+    int i;
+
+    if (appHandlesFree > 0) {
+        for (i = 0; i < appHandlesCount; i++) {
+            if (appHandles[i].queue == NULL) {
+                appHandlesFree--;
+                return i;
+            }
+        }
+    }
+    if (appHandlesCount == HANDLE_INDEX_MASK)
+        return -1;
+    if (appHandlesCount == appHandlesSize) {
+        int size = (appHandlesSize == 0)? APP_QUEUES_MIN_SIZE: appHandlesSize * 2;
+        AppHandle* handles = (AppHandle*) JAVAME_REALLOC(appHandles,
+                                                size * sizeof(AppHandle));
+        if (handles == NULL)
+            return -1;
+        appHandles = handles;
+        appHandlesSize = size;
+    }
+    appHandles[appHandlesCount].queue = NULL;
+    appHandles[appHandlesCount].handle = 0;
+    return appHandlesCount++;
+}
+
+/**
+ * Doubles the number of the application queues hash table slots.
+ *
+ * @return KNI_TRUE on success, KNI_FALSE if out of memory
+ */
+static jboolean appQueuesGrow() {
+    AppQueue** queues = appQueues;
+    int size = appQueuesSize;
+    int newSize = (size == 0)? APP_QUEUES_MIN_SIZE: size * 2;
+    int i;
+
+    appQueues = (AppQueue**) JAVAME_CALLOC(newSize, sizeof(AppQueue*));
+    if (appQueues == NULL) {
+        appQueues = queues;
+        return KNI_FALSE;
+    }
+    appQueuesSize = newSize;
+
+    for (i = 0; i < size; i++) {
+        while (queues[i] != NULL) {
+            AppQueue* queue = queues[i];
+            AppQueue** slot = &appQueues[queue->hash & (newSize - 1)];
+            queues[i] = queue->next;
+            queue->next = *slot;
+            *slot = queue;
+        }
+    }
+    if (queues != NULL)
+        JAVAME_FREE(queues);
+    return KNI_TRUE;
+}
+
+/**
+ * Finds or creates the queue of the destination application.
+ *
+ * @return the queue or NULL if out of memory
+ */
+static AppQueue* appQueueGet(const StoredCLDCAppID* app) {
+    AppQueue* queue = appQueueLookup(app->suiteID, &app->className);
+    AppQueue** slot;
+    jchar* chars;
+
+    if (queue != NULL)
+        return queue;
+
+    if (appQueuesCount >= appQueuesSize && !appQueuesGrow() && appQueues == NULL)
+        return NULL;
+
+    queue = (AppQueue*) JAVAME_CALLOC(1, sizeof(AppQueue) + STORED_SIZE(&app->className));
+    if (queue == NULL)
+        return NULL;
+    chars = (jchar*)(queue + 1);
+    putString(&queue->className, &chars, app->className.data, app->className.length);
+    queue->suiteID = app->suiteID;
+    queue->hash = appHash(app->suiteID, &app->className);
+
+    slot = &appQueues[queue->hash & (appQueuesSize - 1)];
+    queue->next = *slot;
+    *slot = queue;
+    appQueuesCount++;
+    return queue;
+}
+
+/**
+ * Removes the empty queue from the hash table and frees it.
+ */
+static void appQueueFree(AppQueue* queue) {
+    AppQueue** slot = &appQueues[queue->hash & (appQueuesSize - 1)];
+
+    while (*slot != queue)
+        slot = &(*slot)->next;
+    *slot = queue->next;
+    appQueuesCount--;
+
+    JAVAME_FREE(queue);
+}
+
+/**
+ * Puts the link to the status list of its queue keeping the list
+ * in the order of the global queue.
+ */
+static void statusListAdd(StoredLink* link) {
+    AppQueue* queue = link->queue;
+    int list = statusList(link->invoc->status);
+    StoredLink* prev = queue->tails[list];
+
+    /* a link usually goes to the tail */
+    while (prev != NULL && (int)(prev->seq - link->seq) > 0)
+        prev = prev->sblink;
+
+    link->list = list;
+    link->sblink = prev;
+    link->sflink = (prev != NULL)? prev->sflink: queue->heads[list];
+    if (link->sflink != NULL) {
+        link->sflink->sblink = link;
+    } else {
+        queue->tails[list] = link;
+    }
+    if (prev != NULL) {
+        prev->sflink = link;
+    } else {
+        queue->heads[list] = link;
+    }
+}
+
+/**
+ * Removes the link from the status list of its queue.
+ */
+static void statusListRemove(StoredLink* link) {
+    AppQueue* queue = link->queue;
+
+    if (link->sblink != NULL) {
+        link->sblink->sflink = link->sflink;
+    } else {
+        queue->heads[link->list] = link->sflink;
+    }
+    if (link->sflink != NULL) {
+        link->sflink->sblink = link->sblink;
+    } else {
+        queue->tails[link->list] = link->sblink;
+    }
+    link->sflink = link->sblink = NULL;
+}
+
+/**
+ * Puts the link to the queue of its invocation destination application.
+ *
+ * @param link the link to put
+ * @return KNI_TRUE on success, KNI_FALSE if out of memory
+ */
+static jboolean appQueueAdd(StoredLink* link) {
+    AppQueue* queue = appQueueGet(&link->invoc->destinationApp);
+    StoredLink* prev;
+
+    if (queue == NULL)
+        return KNI_FALSE;
+
+    prev = queue->tail;
+    while (prev != NULL && (int)(prev->seq - link->seq) > 0)
+        prev = prev->ablink;
+
+    link->queue = queue;
+    link->ablink = prev;
+    link->aflink = (prev != NULL)? prev->aflink: queue->head;
+    if (link->aflink != NULL) {
+        link->aflink->ablink = link;
+    } else {
+        queue->tail = link;
+    }
+    if (prev != NULL) {
+        prev->aflink = link;
+    } else {
+        queue->head = link;
+    }
+    queue->count++;
+
+    statusListAdd(link);
+    return KNI_TRUE;
+}
+
+/**
+ * Removes the link from its application queue, the queue is freed
+ * when it becomes empty.
+ */
+static void appQueueRemove(StoredLink* link) {
+    AppQueue* queue = link->queue;
+
+    if (queue == NULL)
+        return;
+
+    statusListRemove(link);
+    if (link->ablink != NULL) {
+        link->ablink->aflink = link->aflink;
+    } else {
+        queue->head = link->aflink;
+    }
+    if (link->aflink != NULL) {
+        link->aflink->ablink = link->ablink;
+    } else {
+        queue->tail = link->ablink;
+    }
+    link->aflink = link->ablink = NULL;
+    link->queue = NULL;
+
+    if (--queue->count == 0 && queue->handle == 0)
+        appQueueFree(queue);
+}
+
+/**
+ * Moves the link to the queue and status list matching the current
+ * destination application and status of its invocation.
+ * Must be called after either of them is changed.
+ *
+ * @param link the link of the changed invocation
+ */
+static void invocRefile(StoredLink* link) {
+    AppQueue* queue = link->queue;
+    const StoredCLDCAppID* app = &link->invoc->destinationApp;
+
+    if (queue->suiteID != app->suiteID ||
+            !stringsEqual(&queue->className, &app->className)) {
+        /* create the new queue before the old one may be freed */
+        AppQueue* target = appQueueGet(app);
+        if (target != NULL) {
+            appQueueRemove(link);
+            appQueueAdd(link);
+            return;
+        }
+        /* keep the link in the old queue until the memory is available,
+         * its status list is updated anyway */
+        strayLinks++;
+    }
+    if (link->list != statusList(link->invoc->status)) {
+        statusListRemove(link);
+        statusListAdd(link);
+    }
+}
+
+/**
+ * Refiles the link of the changed stored invocation.
+ *
+ * @param invoc the changed invocation
+ * @see #invocRefile
+ */
+static void invocChanged(StoredInvoc* invoc) {
+    StoredLink* link = findLink(invoc);
+    if (link != NULL)
+        invocRefile(link);
+}
+
 /**
  * Free all of the memory used by a stored invocation.
  * 
@@ -1282,27 +2091,10 @@ static void invocFree(StoredInvoc* invoc) {
      * Strings, free the structure and throw OutOfMemoryError.
      */
     if (invoc != NULL) {
-        if (invoc->args != NULL) {
-            /* Free the argument array and strings, if any */
-            pcsl_string* args = invoc->args;
-            int i = invoc->argsLen;
-            while (i--) {
-                pcsl_string_free(args++);
-            }
-            JAVAME_FREE(invoc->args);
-        }
-
-        if (invoc->data != NULL) {
-            JAVAME_FREE(invoc->data);
-        }
-
-#define freeStringField( field ) pcsl_string_free(&invoc->field);
-        ENUM_STRING_FIELDS(freeStringField)
-        freeStringField( destinationApp.className )
-        freeStringField( invokingApp.className )
-#undef freeStringField
-
-        JAVAME_FREE(invoc);
+        /* The strings, arguments and data are all in the payload block */
+        if (ENTRY(invoc)->payload != NULL)
+            JAVAME_FREE(ENTRY(invoc)->payload);
+        releaseStoredInvoc(invoc);
     }
 }
 
@@ -1333,6 +2125,10 @@ static void removeEntry(StoredLink* entry) {
         StoredLink *blink = entry->blink;
         StoredLink *flink = entry->flink;
 
+        tidIndexRemove(entry);
+        appQueueRemove(entry);
+        invocCount--;
+
         if (blink == NULL) {
             invocQueue = flink;
         } else {
@@ -1340,11 +2136,40 @@ static void removeEntry(StoredLink* entry) {
         }
         if (flink != NULL) {
             flink->blink = blink;
+        } else {
+            invocQueueTail = blink;
         }
-        JAVAME_FREE(entry);
+        entry->invoc = NULL;
     }
 }
 
+/**
+ * Compares the string with the jchar buffer.
+ *
+ * @param str the string to compare
+ * @param chars the buffer to compare with
+ * @param len number of jchars in the buffer
+ *
+ * @return KNI_TRUE if the string consists of the buffer jchars
+ */
+static jboolean stringEqualsChars(const StoredString* str,
+                   const jchar* chars, jsize len) {
+    if (str->data == NULL || str->length != len)
+        return KNI_FALSE;
+    return jsr211_jchars_equal(str->data, chars, (size_t)len)? KNI_TRUE: KNI_FALSE;
+}
+
+/**
+ * Compares two strings, the contents are matched by the jchar kernel.
+ *
+ * @return KNI_TRUE if the strings are equal
+ */
+static jboolean stringsEqual(const StoredString* a, const StoredString* b) {
+    if (a->data == NULL || b->data == NULL)
+        return (a->data == b->data)? KNI_TRUE: KNI_FALSE;
+    return stringEqualsChars(b, a->data, a->length);
+}
+
 static int javacall_string_len(javacall_const_utf16_string string) {
     javacall_int32 length;
     if (JAVACALL_OK != javautil_unicode_utf16_ulength (string, &length))
@@ -1352,6 +2177,17 @@ static int javacall_string_len(javacall_const_utf16_string string) {
     return length;
 }
 
+/**
+ * Points the string to the javacall string without copying it.
+ *
+ * @param str the string to set
+ * @param string the zero terminated javacall string, NULL for the null string
+ */
+static void viewString(StoredString* str, javacall_const_utf16_string string) {
+    str->data = string;
+    str->length = (string != NULL)? javacall_string_len(string): 0;
+}
+
 /**
  * Function to find a matching entry in the queue.
  * The handlerID must match. The function seeks among new Invocations 
@@ -1363,9 +2199,7 @@ static int javacall_string_len(javacall_const_utf16_string string) {
  */
 StoredInvoc* jsr211_get_invocation(javacall_const_utf16_string handlerID) {
     StoredLink* curr;
-    pcsl_string id = PCSL_STRING_NULL_INITIALIZER;
-
-    pcsl_string_convert_from_utf16(handlerID, javacall_string_len(handlerID), &id);
+    jsize len = javacall_string_len(handlerID);
 
 #ifdef DEBUG_211
     printf( "jsr211_get_invocation: %ls\n", handlerID );
@@ -1374,13 +2208,12 @@ StoredInvoc* jsr211_get_invocation(javacall_const_utf16_string handlerID) {
      * matches the handlerID.
      */
     for (curr = invocQueue; curr != NULL; curr = curr->flink) {
-        if (curr->invoc->status == STATUS_WAITING && pcsl_string_equals(&id, &curr->invoc->ID)) {
-            pcsl_string_free(&id);
+        if (curr->invoc->status == STATUS_WAITING && 
+                stringEqualsChars(&curr->invoc->ID, handlerID, len)) {
             return curr->invoc;
         }
     }
     
-    pcsl_string_free(&id);
     return NULL;
 }
 
@@ -1392,29 +2225,14 @@ StoredInvoc* jsr211_get_invocation(javacall_const_utf16_string handlerID) {
  * @return a StoredInvoc if a matching one is found; NULL otherwise
  */
 StoredInvoc* jsr211_find_invocation(int invoc_id) {
-    StoredLink* curr;
-
-    /* Inspect the queue of Invocations and pick one that matches. */
-    for (curr = invocQueue; curr != NULL; curr = curr->flink) {
-        if (invoc_id == curr->invoc->tid) {
-            /* Found one; return it */
-            return curr->invoc;
-        }
-    }
-    return NULL;
+    StoredLink* curr = invocFindTid(invoc_id);
+    return (curr != NULL)? curr->invoc: NULL;
 }
 
 static StoredLink* findLink(StoredInvoc *invoc) {
-    StoredLink* curr;
-
-    /* Inspect the queue of Invocations and pick one that matches. */
-    for (curr = invocQueue; curr != NULL; curr = curr->flink) {
-        if (invoc == curr->invoc) {
-            /* Found one; return it */
-            return curr;
-        }
-    }
-    return NULL;
+    /* The link is embedded in the entry; it is in use while queued. */
+    StoredLink* link = &ENTRY(invoc)->link;
+    return (link->invoc == invoc)? link: NULL;
 }
 
 void jsr211_remove_invocation(StoredInvoc* invoc) {
@@ -1468,13 +2286,13 @@ jsr211_launch_result jsr211_execute_handler(javacall_const_utf16_string handler_
 
     result = JSR211_LAUNCH_ERROR;
 
-    jc_invoc.url               = (jchar *)pcsl_string_get_utf16_data(&invoc->url);
-    jc_invoc.type              = (jchar *)pcsl_string_get_utf16_data(&invoc->type);
-    jc_invoc.action            = (jchar *)pcsl_string_get_utf16_data(&invoc->action);
-    jc_invoc.invokingAppName   = (jchar *)pcsl_string_get_utf16_data(&invoc->invokingAppName);
-    jc_invoc.invokingAuthority = (jchar *)pcsl_string_get_utf16_data(&invoc->invokingAuthority);
-    jc_invoc.username          = (jchar *)pcsl_string_get_utf16_data(&invoc->username);
-    jc_invoc.password          = (jchar *)pcsl_string_get_utf16_data(&invoc->password);
+    jc_invoc.url               = (jchar *)invoc->url.data;
+    jc_invoc.type              = (jchar *)invoc->type.data;
+    jc_invoc.action            = (jchar *)invoc->action.data;
+    jc_invoc.invokingAppName   = (jchar *)invoc->invokingAppName.data;
+    jc_invoc.invokingAuthority = (jchar *)invoc->invokingAuthority.data;
+    jc_invoc.username          = (jchar *)invoc->username.data;
+    jc_invoc.password          = (jchar *)invoc->password.data;
     jc_invoc.argsLen           = invoc->argsLen;
     jc_invoc.dataLen           = invoc->dataLen;
     jc_invoc.data              = invoc->data;
@@ -1494,7 +2312,7 @@ jsr211_launch_result jsr211_execute_handler(javacall_const_utf16_string handler_
         if (NULL != jc_invoc.args) {
             jsr211_boolean succ = JSR211_TRUE;
             for (i=0; i<invoc->argsLen; i++) {
-                jc_invoc.args[i] = (jchar *)pcsl_string_get_utf16_data(&invoc->args[i]);
+                jc_invoc.args[i] = (jchar *)invoc->args[i].data;
                 if (NULL == jc_invoc.args[i])
                     succ = JSR211_FALSE;
             }
@@ -1507,24 +2325,15 @@ jsr211_launch_result jsr211_execute_handler(javacall_const_utf16_string handler_
                     invoc->status = without_finish_notification ? STATUS_INITIATED : STATUS_ACTIVE;
                 }
             }
-            for (i=0; i<invoc->argsLen; i++)
-                if (NULL != jc_invoc.args[i])
-                    pcsl_string_release_utf16_data(jc_invoc.args[i], &invoc->args[i]);
             JAVAME_FREE(jc_invoc.args);
             jc_invoc.args = NULL;
         }
     }
 
-    pcsl_string_release_utf16_data(jc_invoc.url, &invoc->url);
-    pcsl_string_release_utf16_data(jc_invoc.type, &invoc->type);
-    pcsl_string_release_utf16_data(jc_invoc.action, &invoc->action);
-    pcsl_string_release_utf16_data(jc_invoc.invokingAppName, &invoc->invokingAppName);
-    pcsl_string_release_utf16_data(jc_invoc.invokingAuthority, &invoc->invokingAuthority);
-    pcsl_string_release_utf16_data(jc_invoc.username, &invoc->username);
-    pcsl_string_release_utf16_data(jc_invoc.password, &invoc->password);
 
     if (result == JSR211_LAUNCH_ERROR)
         invoc->status = STATUS_ERROR;
+    invocChanged(invoc);
 
     return result;
 }
@@ -1549,6 +2358,8 @@ static void handle_javanotify_chapi_platform_finish(int invoc_id,
         javacall_chapi_invocation_status status
 ) {
     StoredInvoc* invoc;
+    StoredInvoc src;
+    StoredString* srcArgs = NULL;
     int i;
     javacall_result result;
     
@@ -1559,45 +2370,30 @@ static void handle_javanotify_chapi_platform_finish(int invoc_id,
         return;
     result = JAVACALL_OK;
 
-    if (PCSL_STRING_OK != pcsl_string_convert_from_utf16(
-            url,javacall_string_len(url), &invoc->url))
-        result = JAVACALL_FAIL;
-    
-    if (NULL != invoc->args) {
-        for (i=0; i< invoc->argsLen; i++)
-            pcsl_string_free(&invoc->args[i]);
-        JAVAME_FREE(invoc->args);
-        invoc->args = NULL;
-    }
-    invoc->argsLen = 0;
-
-    if ( (NULL != args) && (0 != argsLen) ) {
-        invoc->args = (pcsl_string*)JAVAME_CALLOC(argsLen, sizeof(pcsl_string));
-        if (NULL != invoc->args) {
-            for (i = 0; i< argsLen; i++) {
-                invoc->args[i] = PCSL_STRING_NULL;
-                if (PCSL_STRING_OK != pcsl_string_convert_from_utf16(
-                        args[i], javacall_string_len(args[i]), &invoc->args[i]))
-                    result = JAVACALL_FAIL;
-            }
-        } else
-            result = JAVACALL_OUT_OF_MEMORY;
-    }
-
-    if (NULL != invoc->data) {
-        JAVAME_FREE(invoc->data);
-        invoc->data = NULL;
-    }
-    invoc->dataLen = 0;
-
-    if ( (NULL != data) && (0 != dataLen) ) {
-        invoc->data = JAVAME_MALLOC(dataLen);
-        if (NULL != invoc->data) {
-            invoc->dataLen = dataLen;
-            memcpy (invoc->data, data, dataLen);
-        } else
+    if (NULL == args)
+        argsLen = 0;
+    if (NULL == data)
+        dataLen = 0;
+
+    /* The new URL, arguments and data are copied with the kept strings */
+    src = *invoc;
+    if (NULL != url)
+        viewString(&src.url, url);
+    if (argsLen > 0) {
+        srcArgs = (StoredString*) JAVAME_MALLOC(argsLen * sizeof(StoredString));
+        if (NULL == srcArgs)
             result = JAVACALL_OUT_OF_MEMORY;
+        for (i = 0; srcArgs != NULL && i < argsLen; i++)
+            viewString(&srcArgs[i], args[i]);
     }
+    src.args = srcArgs;
+    src.argsLen = argsLen;
+    src.data = data;
+    src.dataLen = dataLen;
+    if (JAVACALL_OK == result && !invocSetPayload(invoc, &src))
+        result = JAVACALL_OUT_OF_MEMORY;
+    if (NULL != srcArgs)
+        JAVAME_FREE(srcArgs);
 
     switch (status) {
         case INVOCATION_STATUS_OK:
@@ -1623,6 +2419,7 @@ static void handle_javanotify_chapi_platform_finish(int invoc_id,
             invoc->destinationApp = invoc->invokingApp;
             invoc->invokingApp = tmpAppID;
         }
+        invocChanged(invoc);
         /* Unmark the response since it is "new" to the target */
         invoc->cleanup = KNI_FALSE;
         invoc->notified = KNI_FALSE;
@@ -1663,6 +2460,8 @@ static void handle_javanotify_chapi_java_invoke(
     int suite_id_len = 128;
     int suite_id;
     StoredInvoc* invoc;
+    StoredInvoc src;
+    StoredString* srcArgs = NULL;
     javacall_chapi_handler_registration_type flag;
     javacall_result res;
     int i;
@@ -1736,109 +2535,65 @@ static void handle_javanotify_chapi_java_invoke(
     }
 
     res = JAVACALL_OK;
-        
-    invoc->tid = invoc_id;
-    invoc->status = STATUS_INIT;
-    invoc->destinationApp.suiteID = suite_id;
-    invoc->invokingApp.suiteID = UNUSED_SUITE_ID;
-
-    if (PCSL_STRING_OK != pcsl_string_convert_from_utf16(handler_id, javacall_string_len(handler_id), &invoc->ID))
-        res = JAVACALL_FAIL;
-    if (PCSL_STRING_OK != pcsl_string_convert_from_utf16(classname, classname_len, &invoc->destinationApp.className))
-        res = JAVACALL_FAIL;
-    JAVAME_FREE(classname);
+
+    /* The strings are copied to the payload block of the invocation */
+    memset(&src, '\0', sizeof(src));
+    src.tid = invoc_id;
+    src.status = STATUS_INIT;
+    src.destinationApp.suiteID = suite_id;
+    src.invokingApp.suiteID = UNUSED_SUITE_ID;
+
+    viewString(&src.ID, handler_id);
+    src.destinationApp.className.data = classname;
+    src.destinationApp.className.length = classname_len;
 
     /* IMPL_NOTE: null suite ID is an indication of platform request */
-    invoc->invokingApp.className = PCSL_STRING_NULL;
-    invoc->invokingID = PCSL_STRING_NULL;
+    src.invokingApp.className.data = NULL;
+    src.invokingID.data = NULL;
 
-    invoc->responseRequired =
+    src.responseRequired =
         (0 == invocation->responseRequired) ? JSR211_FALSE : JSR211_TRUE;
-    if (PCSL_STRING_OK != pcsl_string_convert_from_utf16(
-            invocation->url, javacall_string_len(invocation->url), &invoc->url))
-        res = JAVACALL_FAIL;
-    if (invocation->type != NULL && 
-            PCSL_STRING_OK != pcsl_string_convert_from_utf16(
-                invocation->type, javacall_string_len(invocation->type), &invoc->type))
-        res = JAVACALL_FAIL;
-    if (invocation->action != NULL && 
-            PCSL_STRING_OK != pcsl_string_convert_from_utf16(
-                invocation->action, javacall_string_len(invocation->action), &invoc->action))
-        res = JAVACALL_FAIL;
-    if (invocation->invokingAppName != NULL && 
-            PCSL_STRING_OK != pcsl_string_convert_from_utf16(
-                invocation->invokingAppName, javacall_string_len(
-                    invocation->invokingAppName), &invoc->invokingAppName))
-        res = JAVACALL_FAIL;
-    if (invocation->invokingAuthority != NULL && 
-            PCSL_STRING_OK != pcsl_string_convert_from_utf16(
-                invocation->invokingAuthority, javacall_string_len(
-                    invocation->invokingAuthority), &invoc->invokingAuthority))
-        res = JAVACALL_FAIL;
-    if (invocation->username != NULL &&
-            PCSL_STRING_OK != pcsl_string_convert_from_utf16(
-                invocation->username, javacall_string_len(invocation->username), &invoc->username))
-        res = JAVACALL_FAIL;
-    if (invocation->password != NULL &&
-            PCSL_STRING_OK != pcsl_string_convert_from_utf16(
-                invocation->password, javacall_string_len(invocation->password), &invoc->password))
-        res = JAVACALL_FAIL;
-    
-    if (JAVACALL_OK == res) {
-        invoc->argsLen = invocation->argsLen;
-        invoc->args = JAVAME_CALLOC(sizeof(pcsl_string), invoc->argsLen);
-        if (NULL != invoc->args) {
-            for (i = 0; i < invocation->argsLen; i++) {
-                invoc->args[i] = PCSL_STRING_NULL;
-                if (invocation->args[i] != NULL && 
-                        PCSL_STRING_OK != pcsl_string_convert_from_utf16(
-                            invocation->args[i], javacall_string_len(invocation->args[i]), &invoc->args[i]))
-                    res = JAVACALL_FAIL;
-            }
-            if (JAVACALL_OK == res) {
-                if ((NULL != invocation->data) && (0 != invocation->dataLen)) {
-                    invoc->dataLen = invocation->dataLen;
-                    invoc->data = JAVAME_MALLOC(invoc->dataLen);
-                    if (NULL == invoc->data)
-                        res = JAVACALL_OUT_OF_MEMORY;
-                }
-                if (JAVACALL_OK == res) {
-                    memcpy (invoc->data, invocation->data, invoc->dataLen);
-                
-                    /* invocation is ready to be processed */
-                    invoc->status = STATUS_WAITING;
-                    /* Insert the new Invocation at the end of the queue */
-                    if (!jsr211_enqueue_invocation(invoc))
-                        res = JAVACALL_FAIL;
-                    
-                    unblockWaitingThreads(JSR211_WAIT_OK, 0, JSR211_WAIT_OK);
-                    
-                    /* IMPL_NOTE: The midlet handler should be launched on
-                                  corresponding MIDP event processing */
-
-                    if (JAVACALL_OK != res)
-                        JAVAME_FREE(invoc->data);
-                }
-            }
-            if (JAVACALL_OK != res){
-                for (i = 0; i < invocation->argsLen; i++)
-                    pcsl_string_free(&invoc->args[i]);
-                JAVAME_FREE(invoc->args);
-            }
-        } else
+    viewString(&src.url, invocation->url);
+    viewString(&src.type, invocation->type);
+    viewString(&src.action, invocation->action);
+    viewString(&src.invokingAppName, invocation->invokingAppName);
+    viewString(&src.invokingAuthority, invocation->invokingAuthority);
+    viewString(&src.username, invocation->username);
+    viewString(&src.password, invocation->password);
+
+    if (invocation->argsLen > 0) {
+        srcArgs = (StoredString*) JAVAME_MALLOC(invocation->argsLen * sizeof(StoredString));
+        if (NULL == srcArgs)
             res = JAVACALL_OUT_OF_MEMORY;
+        for (i = 0; srcArgs != NULL && i < invocation->argsLen; i++)
+            viewString(&srcArgs[i], invocation->args[i]);
+        src.args = srcArgs;
+        src.argsLen = invocation->argsLen;
+    }
+    if (NULL != invocation->data) {
+        src.data = invocation->data;
+        src.dataLen = invocation->dataLen;
+    }
+    if (JAVACALL_OK == res && !invocSetPayload(invoc, &src))
+        res = JAVACALL_OUT_OF_MEMORY;
+    JAVAME_FREE(classname);
+    if (NULL != srcArgs)
+        JAVAME_FREE(srcArgs);
+
+    if (JAVACALL_OK == res) {
+        /* invocation is ready to be processed */
+        invoc->status = STATUS_WAITING;
+        /* Insert the new Invocation at the end of the queue */
+        if (!jsr211_enqueue_invocation(invoc))
+            res = JAVACALL_FAIL;
+        
+        unblockWaitingThreads(JSR211_WAIT_OK, 0, JSR211_WAIT_OK);
+        
+        /* IMPL_NOTE: The midlet handler should be launched on
+                      corresponding MIDP event processing */
     }
     if (JAVACALL_OK != res) {
-        pcsl_string_free(&invoc->ID);
-        pcsl_string_free(&invoc->destinationApp.className);
-        pcsl_string_free(&invoc->url);
-        pcsl_string_free(&invoc->type);
-        pcsl_string_free(&invoc->action);
-        pcsl_string_free(&invoc->invokingAppName);
-        pcsl_string_free(&invoc->invokingAuthority);
-        pcsl_string_free(&invoc->username);
-        pcsl_string_free(&invoc->password);
-        JAVAME_FREE(invoc);
+        invocFree(invoc);
     }
 }
 
@@ -1866,12 +2621,12 @@ jsr211_boolean jsr211_platform_finish(int tid, jsr211_boolean *should_exit)
         return JSR211_FALSE;
     invoc = link->invoc;
 
-    url = pcsl_string_get_utf16_data(&invoc->url);
+    url = invoc->url.data;
     args = JAVAME_CALLOC(invoc->argsLen, sizeof(javacall_utf16_string));
     if ( (NULL != url) && (NULL != args) ) {
         success = JSR211_TRUE;
         for (i = 0; i < invoc->argsLen; i++) {
-            args[i] = pcsl_string_get_utf16_data(&invoc->args[i]);
+            args[i] = (javacall_utf16_string)invoc->args[i].data;
             if (NULL == args[i])
                 success = JSR211_FALSE;
         }
@@ -1903,14 +2658,10 @@ jsr211_boolean jsr211_platform_finish(int tid, jsr211_boolean *should_exit)
                     success = JSR211_FALSE;
             }
         }
-
-        for (i = 0; i < invoc->argsLen; i++)
-            pcsl_string_release_utf16_data(args[i],&invoc->args[i]);
     } else
         success = JSR211_FALSE;
 
     JAVAME_FREE(args);
-    pcsl_string_release_utf16_data(url, &invoc->url);
 
     return success;
 }
@@ -98,9 +98,11 @@ static void result2string(KNIDECLARGS JSR211_RESULT_BUFFER buffer, jstring str){
         }
         length /= 2;
         chars[ length ] = '\0';
+        // the low half of the consumed level length marks the framing
+        *--chars = JSR211_RESULT_FRAMING_V2;
 
         if (JAVACALL_OK != jsrop_jstring_from_utf16_string_n(
-                                KNIPASSARGS (const javacall_utf16_string)data, length, str)){
+                                KNIPASSARGS (const javacall_utf16_string)chars, length + 1, str)){
             KNI_ThrowNew(jsropOutOfMemoryError, "No memory to create result string!");
         }
 #ifdef TRACE_TRANSFER_DATA
@@ -110,6 +112,39 @@ static void result2string(KNIDECLARGS JSR211_RESULT_BUFFER buffer, jstring str){
     jsr211_release_result_buffer(buffer);
 }
 
+/** Result kept by the transfer into too small an array */
+static JSR211_RESULT_BUFFER pendingResult = NULL;
+
+/**
+ * Copies the result data right into the Java char array. If the array is
+ * too small the result is kept for the following takeResult0 call.
+ * @param buffer result buffer, released or kept by the function
+ * @param chars Java char array
+ * @return number of copied characters or the negated number of
+ * characters required
+ */
+static jint result2chars(KNIDECLARGS JSR211_RESULT_BUFFER buffer, jobject chars){
+    const void * data; size_t length;
+    jint count;
+
+    if (buffer == NULL) return 0;
+    jsr211_get_data( jsr211_get_result_data(buffer), &data, &length );
+    count = (jint)(length / sizeof(jchar));
+#ifdef TRACE_TRANSFER_DATA
+    printf( "kni_reg_store: buffer = %p, chars %d\n", buffer, (int)count );
+#endif
+    if (count > 0 && (KNI_IsNullHandle(chars) || KNI_GetArrayLength(chars) < count)) {
+        if (pendingResult != NULL) jsr211_release_result_buffer(pendingResult);
+        pendingResult = buffer;
+        return -count;
+    }
+    if (count > 0) {
+        KNI_SetRawArrayRegion(chars, 0, count * sizeof(jchar), (const jbyte*)data);
+    }
+    jsr211_release_result_buffer(buffer);
+    return count;
+}
+
 static void cleanStringArray(const jchar** strings, int n) {
     if (strings != NULL){
         jchar** p = (jchar **)strings;
@@ -526,19 +561,21 @@ KNIDECL(com_sun_j2me_content_RegistryStore_unregister0) {
 
 /**
  * java call:
- *   private native String findHandler0(String callerId, int searchBy, 
- *                                      String value);
+ *   private native int findHandler0(String callerId, int searchBy, 
+ *                                      String value, char[] buf);
  */
-KNIEXPORT KNI_RETURNTYPE_OBJECT
+KNIEXPORT KNI_RETURNTYPE_INT
 KNIDECL(com_sun_j2me_content_RegistryStore_findHandler0) {
     jchar* callerId = NULL;
     jsr211_field searchBy;
     jchar* value = NULL;
     JSR211_RESULT_BUFFER result = jsr211_create_result_buffer();
+    jint count;
 
-    KNI_StartHandles(2);
+    KNI_StartHandles(3);
     KNI_DeclareHandle(callerObj);
     KNI_DeclareHandle(valueObj);
+    KNI_DeclareHandle(charsObj);
 
     do {
         KNI_GetParameterAsObject(1, callerObj);
@@ -557,46 +594,143 @@ KNIDECL(com_sun_j2me_content_RegistryStore_findHandler0) {
 
     if( value != NULL ) JAVAME_FREE(value);
     if( callerId != NULL ) JAVAME_FREE(callerId);
-    result2string(KNIPASSARGS  result, valueObj);
+    KNI_GetParameterAsObject(4, charsObj);
+    count = result2chars(KNIPASSARGS  result, charsObj);
 
-    KNI_EndHandlesAndReturnObject(valueObj);
+    KNI_EndHandles();
+    KNI_ReturnInt(count);
 }
 
 
 /**
  * java call:
- *   private native String forSuite0(String suiteID);
+ *   private native int openCursor0(String callerId, int searchBy, String value);
  */
-KNIEXPORT KNI_RETURNTYPE_OBJECT
+KNIEXPORT KNI_RETURNTYPE_INT
+KNIDECL(com_sun_j2me_content_RegistryStore_openCursor0) {
+    jchar* callerId = NULL;
+    jchar* value = NULL;
+    int cursor = 0;
+
+    KNI_StartHandles(2);
+    KNI_DeclareHandle(callerObj);
+    KNI_DeclareHandle(valueObj);
+
+    KNI_GetParameterAsObject(1, callerObj);
+    KNI_GetParameterAsObject(3, valueObj);
+    if (JAVACALL_OK != jsrop_jstring_to_utf16_string(callerObj, (javacall_utf16_string*)&callerId) ||
+        JAVACALL_OK != jsrop_jstring_to_utf16_string(valueObj, (javacall_utf16_string*)&value)) {
+        KNI_ThrowNew(jsropOutOfMemoryError, 
+               "RegistryStore_openCursor0 no memory for string arguments");
+    } else if (JSR211_OK != jsr211_cursor_open(callerId,
+                    (jsr211_field) KNI_GetParameterAsInt(2), value, &cursor)) {
+        cursor = 0;
+    }
+
+    if( value != NULL ) JAVAME_FREE(value);
+    if( callerId != NULL ) JAVAME_FREE(callerId);
+
+    KNI_EndHandles();
+    KNI_ReturnInt(cursor);
+}
+
+/**
+ * java call:
+ *   private native int nextPage0(int cursor, int maxCount, char[] buf);
+ */
+KNIEXPORT KNI_RETURNTYPE_INT
+KNIDECL(com_sun_j2me_content_RegistryStore_nextPage0) {
+    JSR211_RESULT_BUFFER result = jsr211_create_result_buffer();
+    jint count;
+
+    KNI_StartHandles(1);
+    KNI_DeclareHandle(charsObj);
+
+    KNI_GetParameterAsObject(3, charsObj);
+    if (JSR211_OK != jsr211_cursor_next(KNI_GetParameterAsInt(1),
+                                        KNI_GetParameterAsInt(2), &result)) {
+        // an empty page would be taken for the end of the result
+        jsr211_release_result_buffer(result);
+        KNI_ThrowNew(jsropRuntimeException,
+                "RegistryStore_nextPage0 the cursor is closed or reclaimed");
+        count = 0;
+    } else {
+        count = result2chars(KNIPASSARGS result, charsObj);
+    }
+
+    KNI_EndHandles();
+    KNI_ReturnInt(count);
+}
+
+/**
+ * java call:
+ *   private native void closeCursor0(int cursor);
+ */
+KNIEXPORT KNI_RETURNTYPE_VOID
+KNIDECL(com_sun_j2me_content_RegistryStore_closeCursor0) {
+    jsr211_cursor_close(KNI_GetParameterAsInt(1));
+    KNI_ReturnVoid();
+}
+
+/**
+ * java call:
+ *   private native int forSuite0(int suiteID, char[] buf);
+ */
+KNIEXPORT KNI_RETURNTYPE_INT
 KNIDECL(com_sun_j2me_content_RegistryStore_forSuite0) {
     JSR211_RESULT_BUFFER result = jsr211_create_result_buffer();
+    jint count;
 
     KNI_StartHandles(1);
-    KNI_DeclareHandle(strObj);   // String object
+    KNI_DeclareHandle(charsObj);
 
     SuiteIdType suite_id_param = KNI_GetParameterAsInt(1);
+    KNI_GetParameterAsObject(2, charsObj);
     jsr211_find_for_suite(suite_id_param, &result);
-    result2string(KNIPASSARGS result, strObj);
+    count = result2chars(KNIPASSARGS result, charsObj);
 
-    KNI_EndHandlesAndReturnObject(strObj);
+    KNI_EndHandles();
+    KNI_ReturnInt(count);
 }
 
-/* *
+/**
  * java call:
- *  private native String getByURL0(String callerId, String url, String action);
- * /
-KNIEXPORT KNI_RETURNTYPE_OBJECT
+ *   private native int takeResult0(char[] buf);
+ */
+KNIEXPORT KNI_RETURNTYPE_INT
+KNIDECL(com_sun_j2me_content_RegistryStore_takeResult0) {
+    JSR211_RESULT_BUFFER result = pendingResult;
+    jint count;
+
+    KNI_StartHandles(1);
+    KNI_DeclareHandle(charsObj);
+
+    KNI_GetParameterAsObject(1, charsObj);
+    pendingResult = NULL;
+    count = result2chars(KNIPASSARGS result, charsObj);
+
+    KNI_EndHandles();
+    KNI_ReturnInt(count);
+}
+
+/**
+ * java call:
+ *  private native int getByURL0(String callerId, String url, String action,
+ *                                  char[] buf);
+ */
+KNIEXPORT KNI_RETURNTYPE_INT
 KNIDECL(com_sun_j2me_content_RegistryStore_getByURL0) {
     jchar* callerId = NULL;
     jchar* url = NULL;
     jchar* action = NULL;
     JSR211_RESULT_BUFFER result = jsr211_create_result_buffer();
+    jint count;
 
     KNI_StartHandles(4);
     KNI_DeclareHandle(callerObj);
     KNI_DeclareHandle(urlObj);
     KNI_DeclareHandle(actionObj);
-    KNI_DeclareHandle(resultObj);
+    KNI_DeclareHandle(charsObj);
 
     do {
         KNI_GetParameterAsObject(1, callerObj);
@@ -610,17 +744,18 @@ KNIDECL(com_sun_j2me_content_RegistryStore_getByURL0) {
             break;
         }
 
-        jsr211_handler_by_URL(callerId, url, action, &result);
+        jsr211_handlers_by_URL(callerId, url, action, &result);
     } while (0);
 
-    JAVAME_FREE(action);
-    JAVAME_FREE(url);
-    JAVAME_FREE(callerId);
-    result2string(KNIPASSARGS  result, resultObj);
+    if( action != NULL ) JAVAME_FREE(action);
+    if( url != NULL ) JAVAME_FREE(url);
+    if( callerId != NULL ) JAVAME_FREE(callerId);
+    KNI_GetParameterAsObject(4, charsObj);
+    count = result2chars(KNIPASSARGS  result, charsObj);
 
-    KNI_EndHandlesAndReturnObject(resultObj);
+    KNI_EndHandles();
+    KNI_ReturnInt(count);
 }
-*/
 
 /**
  * java call:
@@ -768,11 +903,24 @@ KNIDECL(com_sun_j2me_content_RegistryStore_selectSingleHandler0) {
 
 /**
  * java call:
- * private native static boolean init();
+ * private native static int getGeneration0();
  */
-KNIEXPORT KNI_RETURNTYPE_BOOLEAN
+KNIEXPORT KNI_RETURNTYPE_INT
+KNIDECL(com_sun_j2me_content_RegistryStore_getGeneration0) {
+    KNI_ReturnInt( jsr211_get_generation() );
+}
+
+/**
+ * java call:
+ * private native static int init(int recordFormat);
+ *
+ * Returns the content handler record format negotiated with the caller
+ * or -1 if the initialization fails.
+ */
+KNIEXPORT KNI_RETURNTYPE_INT
 KNIDECL(com_sun_j2me_content_RegistryStore_init) {
     jboolean ret = KNI_TRUE;
+    jsr211_record_format format = (jsr211_record_format) KNI_GetParameterAsInt(1);
     if (initialized < 0) {
         // Global initialization
         if (JSR211_OK != jsr211_initialize()) {
@@ -787,7 +935,7 @@ KNIDECL(com_sun_j2me_content_RegistryStore_init) {
     } else {
         initialized++;
     }
-    KNI_ReturnBoolean(ret);
+    KNI_ReturnInt(ret? jsr211_set_record_format(format): -1);
 }
 
 /**
@@ -802,6 +950,10 @@ KNIDECL(com_sun_j2me_content_RegistryStore_finalize) {
     if (initialized > 0) {
 
         if (--initialized == 0) {
+            if (pendingResult != NULL) {
+                jsr211_release_result_buffer(pendingResult);
+                pendingResult = NULL;
+            }
             jsr211_finalize();
             initialized = -1;
         }
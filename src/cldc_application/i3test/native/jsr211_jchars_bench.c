@@ -0,0 +1,155 @@
+/*
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions.
+ */
+
+/**
+ * @file
+ * @brief Microbenchmark of the jchar comparison kernels.
+ * <P>
+ * The kernels are compared with the calls they replaced: <UL>
+ *  <LI> jsr211_jchars_equal with wcsncmp and pcsl_string_equals,
+ *  <LI> jsr211_jchars_equal_fold with javautil_wcsnicmp,
+ *  <LI> jsr211_jchars_compare with javautil_unicode_cmp. </UL>
+ * Every pair runs on equal strings, the worst case for a comparison,
+ * of 8, 48 and 256 jchars, and the results of the pair are checked to
+ * agree.
+ * <P>
+ * The program is built against the PCSL and javacall libraries with
+ * 16-bit wchar_t, as the registry used wcsncmp on jchar buffers. The
+ * wcsncmp figures are meaningful only if the C library is built with
+ * 16-bit wchar_t too. For example:
+ * <pre>
+ *   cc -O2 -fshort-wchar -I... -o jchars_bench jsr211_jchars_bench.c \
+ *       jsr211_jchars.c -lpcsl_string -ljavautil
+ *   ./jchars_bench
+ * </pre>
+ * It prints the time per call in nanoseconds and returns 0 if all the
+ * results agree.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <wchar.h>
+#include <time.h>
+
+#include <javacall_defs.h>
+#include <javautil_string.h>
+#include <javautil_unicode.h>
+#include <pcsl_string.h>
+
+#include "jsr211_jchars.h"
+
+/** Calls per measurement */
+#define BENCH_CALLS     2000000L
+
+/** Longest compared string */
+#define BENCH_MAX_LEN   256
+
+/** Number of the failed checks */
+static int failures = 0;
+
+/** Keeps the results, so the calls are not optimized away */
+static volatile long sink;
+
+static jchar str_a[BENCH_MAX_LEN + 1];
+static jchar str_b[BENCH_MAX_LEN + 1];
+static jchar str_upper[BENCH_MAX_LEN + 1];
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    }
+
+/**
+ * Runs the statement BENCH_CALLS times and returns the time per run in
+ * nanoseconds.
+ */
+#define MEASURE(result, stmt) { \
+    long n; \
+    clock_t start = clock(); \
+    for (n = 0; n < BENCH_CALLS; n++) { \
+        stmt; \
+    } \
+    result = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / BENCH_CALLS; \
+}
+
+/**
+ * Fills the strings: two equal copies of a MIME type like text and its
+ * upper case copy.
+ */
+static void fill(size_t len) {
+    static const char pattern[] = "application/vnd.sun.chapi-test+xml;";
+    size_t i;
+    for (i = 0; i < len; i++) {
+        str_a[i] = str_b[i] = pattern[i % (sizeof(pattern) - 1)];
+        str_upper[i] = (str_a[i] >= 'a' && str_a[i] <= 'z')?
+                                str_a[i] - ('a' - 'A'): str_a[i];
+    }
+    str_a[len] = str_b[len] = str_upper[len] = 0;
+}
+
+static void bench(size_t len) {
+    pcsl_string pa, pb;
+    javacall_int32 comparison;
+    double kernel, old1, old2;
+
+    fill(len);
+    CHECK(PCSL_STRING_OK == pcsl_string_convert_from_utf16(str_a, len, &pa));
+    CHECK(PCSL_STRING_OK == pcsl_string_convert_from_utf16(str_b, len, &pb));
+
+    CHECK(jsr211_jchars_equal(str_a, str_b, len));
+    CHECK(0 == wcsncmp((const wchar_t*)str_a, (const wchar_t*)str_b, len));
+    CHECK(pcsl_string_equals(&pa, &pb));
+    MEASURE(kernel, sink += jsr211_jchars_equal(str_a, str_b, len));
+    MEASURE(old1, sink += wcsncmp((const wchar_t*)str_a, (const wchar_t*)str_b, len));
+    MEASURE(old2, sink += pcsl_string_equals(&pa, &pb));
+    printf("%-8s %6d %10.1f %10.1f %10.1f\n", "equal", (int)len, kernel, old1, old2);
+
+    CHECK(jsr211_jchars_equal_fold(str_a, str_upper, len));
+    CHECK(0 == javautil_wcsnicmp(str_a, str_upper, len));
+    MEASURE(kernel, sink += jsr211_jchars_equal_fold(str_a, str_upper, len));
+    MEASURE(old1, sink += javautil_wcsnicmp(str_a, str_upper, len));
+    printf("%-8s %6d %10.1f %10.1f %10s\n", "fold", (int)len, kernel, old1, "-");
+
+    CHECK(0 == jsr211_jchars_compare(str_a, len, str_b, len));
+    CHECK(JAVACALL_OK == javautil_unicode_cmp(str_a, str_b, &comparison) &&
+                                                            comparison == 0);
+    MEASURE(kernel, sink += jsr211_jchars_compare(str_a, len, str_b, len));
+    MEASURE(old1, { javautil_unicode_cmp(str_a, str_b, &comparison);
+                    sink += comparison; });
+    printf("%-8s %6d %10.1f %10.1f %10s\n", "compare", (int)len, kernel, old1, "-");
+
+    pcsl_string_free(&pa);
+    pcsl_string_free(&pb);
+}
+
+int main(void) {
+    printf("%-8s %6s %10s %10s %10s\n", "ns/call", "len", "kernel",
+                                    "wcs/util", "pcsl");
+    bench(8);
+    bench(48);
+    bench(BENCH_MAX_LEN);
+    printf("%s\n", failures? "FAILED": "PASSED");
+    return failures? 1: 0;
+}
@@ -0,0 +1,324 @@
+/*
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions.
+ */
+
+/**
+ * @file
+ * @brief Tests of the POSIX journaling CHAPI registry backend.
+ * <P>
+ * The test includes the backend source, so it can check the journal
+ * state, and provides the internal storage root itself. It is a
+ * standalone program built against the MIDP, PCSL and javacall headers,
+ * for example:
+ * <pre>
+ *   cc -I... -o registry_test jsr211_posix_registry_test.c
+ *   ./registry_test /tmp/chapi_test/
+ * </pre>
+ * The storage directory MUST exist and end with the separator. The
+ * program returns 0 if all the checks pass.
+ */
+
+#include <signal.h>
+#include <sys/resource.h>
+#include <jsrop_memory.h>
+
+/** Number of the allocations that succeed before one fails, -1 for none */
+static int malloc_countdown = -1;
+
+/**
+ * The allocator of the backend under test, which can fail on request.
+ */
+static void* test_malloc(size_t size) {
+    if (malloc_countdown == 0) return NULL;
+    if (malloc_countdown > 0) malloc_countdown--;
+    return JAVAME_MALLOC(size);
+}
+
+#undef JAVAME_MALLOC
+#define JAVAME_MALLOC(size) test_malloc(size)
+
+#include "../../core/native/jsr211_posix_registry.c"
+
+/** The storage root given on the command line */
+static const char* test_root;
+
+/** Number of the failed checks */
+static int failures = 0;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    }
+
+/*
+ * The internal storage replacement: the paths are built from test_root.
+ */
+const pcsl_string* storage_get_root(StorageIdType storageId) {
+    static pcsl_string root;
+    (void)storageId;
+    return &root;
+}
+
+jint pcsl_string_utf8_length(const pcsl_string* str) {
+    (void)str;
+    return strlen(test_root);
+}
+
+pcsl_string_status pcsl_string_convert_to_utf8(const pcsl_string* str,
+                        jbyte* buffer, jint buffer_length, jint* converted_length) {
+    (void)str;
+    if ((jint)strlen(test_root) >= buffer_length) return PCSL_STRING_EINVAL;
+    strcpy((char*)buffer, test_root);
+    *converted_length = strlen(test_root);
+    return PCSL_STRING_OK;
+}
+
+/**
+ * Converts the ASCII string to a javacall string in a rotating buffer.
+ */
+static javacall_const_utf16_string W(const char* str) {
+    static javacall_utf16 buffers[8][64];
+    static int next = 0;
+    javacall_utf16* buf = buffers[next++ % 8];
+    int i;
+    for (i = 0; str[i] != 0; i++) buf[i] = str[i];
+    buf[i] = 0;
+    return buf;
+}
+
+/**
+ * Registers the handler with one type and one localized action.
+ */
+static javacall_result reg(const char* id, const char* type) {
+    javacall_const_utf16_string types[1];
+    javacall_const_utf16_string actions[1];
+    javacall_const_utf16_string locales[1];
+    javacall_const_utf16_string names[1];
+    types[0] = W(type);
+    actions[0] = W("open");
+    locales[0] = W("en");
+    names[0] = W("Open");
+    return javacall_chapi_register_handler(W(id), W("Test"), W("5"),
+                W("com.sun.Test"), 1, types, 1, NULL, 0, actions, 1,
+                locales, 1, names, 1, NULL, 0);
+}
+
+/**
+ * Returns the number of the registered handlers.
+ */
+static int count_handlers(void) {
+    javacall_utf16 buf[64];
+    int pos = 0, n = 0, len = 64;
+    while (JAVACALL_OK == javacall_chapi_enum_handlers(&pos, buf, &len)) {
+        n++;
+        len = 64;
+    }
+    return n;
+}
+
+/**
+ * Checks the handler is registered with the type.
+ */
+static int has_handler(const char* id, const char* type) {
+    javacall_utf16 buf[64];
+    int pos = 0, len = 64, i;
+    if (JAVACALL_OK != javacall_chapi_enum_types(W(id), &pos, buf, &len)) return 0;
+    for (i = 0; type[i] != 0 && buf[i] == type[i]; i++);
+    return type[i] == 0 && buf[i] == 0;
+}
+
+/**
+ * Returns the journal file size.
+ */
+static long journal_file_size(void) {
+    struct stat st;
+    char* path = storage_path(JOURNAL_FILE);
+    int res = stat(path, &st);
+    JAVAME_FREE(path);
+    return (res == 0)? (long)st.st_size: -1;
+}
+
+/**
+ * Finalizes the registry and loads it again from the journal.
+ */
+static void reload(void) {
+    javacall_chapi_finalize_registry();
+    CHECK(JAVACALL_OK == javacall_chapi_init_registry());
+}
+
+static void test_register_unregister(void) {
+    CHECK(JAVACALL_OK == reg("a", "text/a"));
+    CHECK(JAVACALL_OK == reg("b", "text/b"));
+    CHECK(JAVACALL_OK == reg("c", "text/c"));
+    CHECK(JAVACALL_OK == javacall_chapi_unregister_handler(W("b")));
+    CHECK(JAVACALL_OK != javacall_chapi_unregister_handler(W("b")));
+    CHECK(JAVACALL_OK == reg("a", "text/a2"));
+    CHECK(count_handlers() == 2);
+    CHECK(has_handler("a", "text/a2"));
+    CHECK(!has_handler("b", "text/b"));
+    CHECK(has_handler("c", "text/c"));
+}
+
+static void test_replay(void) {
+    reload();
+    CHECK(count_handlers() == 2);
+    CHECK(has_handler("a", "text/a2"));
+    CHECK(has_handler("c", "text/c"));
+}
+
+static void test_torn_tail(void) {
+    static const char garbage[] = "RJHC torn record";
+    long size;
+    char* path;
+    int fd;
+
+    javacall_chapi_finalize_registry();
+    size = journal_file_size();
+    path = storage_path(JOURNAL_FILE);
+    fd = open(path, O_WRONLY | O_APPEND);
+    JAVAME_FREE(path);
+    CHECK(fd >= 0);
+    CHECK(write(fd, garbage, sizeof(garbage)) == sizeof(garbage));
+    close(fd);
+
+    CHECK(JAVACALL_OK == javacall_chapi_init_registry());
+    CHECK(journal_file_size() == size);
+    CHECK(count_handlers() == 2);
+    CHECK(JAVACALL_OK == reg("d", "text/d"));
+    reload();
+    CHECK(has_handler("d", "text/d"));
+}
+
+static void test_failed_append(void) {
+    struct rlimit saved, limit;
+    long size = journal_file_size();
+
+    // the record can land only partially
+    signal(SIGXFSZ, SIG_IGN);
+    getrlimit(RLIMIT_FSIZE, &saved);
+    limit = saved;
+    limit.rlim_cur = size + sizeof(RECORD_HEADER) / 2;
+    setrlimit(RLIMIT_FSIZE, &limit);
+    CHECK(JAVACALL_OK != reg("e", "text/e"));
+    setrlimit(RLIMIT_FSIZE, &saved);
+
+    CHECK(journal_file_size() == size);
+    CHECK(JAVACALL_OK == reg("f", "text/f"));
+    reload();
+    CHECK(!has_handler("e", "text/e"));
+    CHECK(has_handler("f", "text/f"));
+}
+
+static void test_deferred_sync(void) {
+    int synced = unsynced;
+    int i;
+
+    jsr211_posix_registry_defer_sync();
+    for (i = 0; i < JOURNAL_SYNC_BATCH; i++) {
+        CHECK(JAVACALL_OK == reg("s", "text/s"));
+    }
+    CHECK(unsynced == synced + JOURNAL_SYNC_BATCH);
+    CHECK(JAVACALL_OK == jsr211_posix_registry_sync());
+    CHECK(unsynced == 0);
+
+    // the periodic sync is back
+    for (i = 0; i < JOURNAL_SYNC_BATCH; i++) {
+        CHECK(JAVACALL_OK == reg("s", "text/s"));
+    }
+    CHECK(unsynced == 0);
+    CHECK(JAVACALL_OK == javacall_chapi_unregister_handler(W("s")));
+}
+
+static void test_compaction(void) {
+    char* temp;
+    long size = 0;
+    int i;
+
+    // register until the journal shrinks
+    for (i = 0; journal_file_size() >= size && i < 10000; i++) {
+        size = journal_file_size();
+        CHECK(JAVACALL_OK == reg("g", (i % 2)? "text/g1": "text/g2"));
+    }
+    CHECK(size + 0x400 >= JOURNAL_COMPACT_MIN);
+    CHECK(journal_file_size() < JOURNAL_COMPACT_MIN);
+    CHECK(journal_file_size() == (long)live_size);
+    temp = storage_path(JOURNAL_TEMP_FILE);
+    CHECK(access(temp, F_OK) != 0);
+    JAVAME_FREE(temp);
+
+    // the appends after the compaction go to the new journal
+    CHECK(JAVACALL_OK == reg("h", "text/h"));
+    reload();
+    CHECK(has_handler("g", (i % 2)? "text/g2": "text/g1"));
+    CHECK(has_handler("h", "text/h"));
+    CHECK(count_handlers() == 6);
+}
+
+static void test_replay_no_memory(void) {
+    int n = count_handlers();
+    long size;
+    int i;
+    javacall_result res = JAVACALL_FAIL;
+
+    javacall_chapi_finalize_registry();
+    size = journal_file_size();
+
+    // every allocation of the replay fails in turn, the journal stays whole
+    for (i = 0; res != JAVACALL_OK && i < 1000; i++) {
+        malloc_countdown = i;
+        res = javacall_chapi_init_registry();
+        malloc_countdown = -1;
+        CHECK(res == JAVACALL_OK || res == JAVACALL_CHAPI_ERROR_NO_MEMORY);
+        CHECK(journal_file_size() == size);
+    }
+    CHECK(i > n);
+    CHECK(count_handlers() == n);
+    CHECK(has_handler("h", "text/h"));
+}
+
+int main(int argc, char** argv) {
+    char* path;
+
+    if (argc < 2) {
+        printf("usage: %s <storage directory>/\n", argv[0]);
+        return 2;
+    }
+    test_root = argv[1];
+    path = storage_path(JOURNAL_FILE);
+    unlink(path);
+    JAVAME_FREE(path);
+
+    CHECK(JAVACALL_OK == javacall_chapi_init_registry());
+    test_register_unregister();
+    test_replay();
+    test_torn_tail();
+    test_failed_append();
+    test_deferred_sync();
+    test_compaction();
+    test_replay_no_memory();
+    javacall_chapi_finalize_registry();
+
+    printf("%s\n", failures? "FAILED": "PASSED");
+    return failures? 1: 0;
+}
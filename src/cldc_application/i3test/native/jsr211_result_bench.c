@@ -0,0 +1,165 @@
+/*
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions.
+ */
+
+/**
+ * @file
+ * @brief Microbenchmark of the result buffer deduplication.
+ * <P>
+ * The benchmark fills a result buffer with n distinct types and then
+ * appends 2n more types, half of them the upper case copies of the present
+ * ones, testing every type with @link jsr211_isUniqueString first. n
+ * goes from 10 to 10,000. The hash side table is compared with the linear
+ * scan of the buffer, which the deduplication used before and still falls
+ * back to if the table can't be allocated.
+ * <P>
+ * The benchmark includes the result buffer source and is a standalone
+ * program built against the MIDP, PCSL and javacall headers, for example:
+ * <pre>
+ *   cc -O2 -I... -o result_bench jsr211_result_bench.c jsr211_jchars.c
+ *   ./result_bench
+ * </pre>
+ * It prints the time per operation for both methods and returns 0 if
+ * they find the same duplicates.
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include "../../core/native/jsr211_result.c"
+
+/** Smallest and largest number of the distinct strings */
+#define BENCH_MIN       10
+#define BENCH_MAX       10000
+
+/** Operations per measurement, small sizes are repeated up to it */
+#define BENCH_OPS       60000L
+
+/**
+ * Writes the n-th type, in upper case if requested, so the
+ * case-insensitive comparison has to fold.
+ */
+static size_t make_type(long n, int upper, /*OUT*/ jchar* buf) {
+    char str[32];
+    size_t i, len;
+    sprintf(str, "%s/x-bench-%ld", upper? "APPLICATION": "application", n);
+    len = strlen(str);
+    for (i = 0; i < len; i++) buf[i] = (jchar)str[i];
+    return len;
+}
+
+/**
+ * The uniqueness test scanning all the buffer entries.
+ */
+static jsr211_boolean linear_is_unique(const jchar* key, size_t sz,
+                                            JSR211_RESULT_STRARRAY array) {
+    JSR211_ENUM_HANDLE eh;
+    JSR211_BUFFER_DATA bd;
+    const jchar* entry_key;
+    size_t entry_sz;
+
+    patch_levels(*(DATA_BUFFER**)array);
+    eh = jsr211_get_enum_handle((*(DATA_BUFFER**)array)->data);
+    while ((bd = jsr211_get_next(&eh)) != NULL) {
+        dedup_entry_key(DEDUP_FOLDED_STRINGS, bd, &entry_key, &entry_sz);
+        if (entry_sz == sz && dedup_equal(DEDUP_FOLDED_STRINGS,
+                                            key, entry_key, entry_sz)) {
+            return JSR211_FALSE;
+        }
+    }
+    return JSR211_TRUE;
+}
+
+/**
+ * Fills the buffer with n types and probes it with 2n types.
+ *
+ * @param linear whether the linear scan is used
+ * @return the number of the duplicates found
+ */
+static long run(long n, int linear) {
+    JSR211_RESULT_BUFFER buf = jsr211_create_result_buffer();
+    jchar type[32];
+    long i, found = 0;
+    size_t len;
+
+    for (i = 0; i < 3 * n; i++) {
+        // n distinct types, then the upper case copies of them
+        // interleaved with n more distinct types
+        if (i < n || ((i - n) & 1)) {
+            len = make_type(i, 0, type);
+        } else {
+            len = make_type((i - n) / 2, 1, type);
+        }
+        if (linear) {
+            if (JSR211_TRUE == linear_is_unique(type, len, &buf)) {
+                jsr211_appendString(type, len, &buf);
+            } else {
+                found++;
+            }
+        } else {
+            if (JSR211_TRUE == jsr211_isUniqueString(type, len, JAVACALL_FALSE, &buf)) {
+                jsr211_appendString(type, len, &buf);
+            } else {
+                found++;
+            }
+        }
+    }
+    jsr211_release_result_buffer(buf);
+    return found;
+}
+
+/**
+ * Returns the time of one operation of the run in nanoseconds.
+ */
+static double measure(long n, int linear, /*OUT*/ long* found) {
+    long rounds = BENCH_OPS / (3 * n), r;
+    clock_t start;
+
+    if (rounds < 1) rounds = 1;
+    start = clock();
+    for (r = 0; r < rounds; r++) {
+        *found = run(n, linear);
+    }
+    return (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / (rounds * 3 * n);
+}
+
+int main(void) {
+    long n, hash_found, linear_found;
+    double hash_ns, linear_ns;
+    int failures = 0;
+
+    printf("%8s %14s %14s\n", "n", "hash ns/op", "linear ns/op");
+    for (n = BENCH_MIN; n <= BENCH_MAX; n *= 10) {
+        hash_ns = measure(n, 0, &hash_found);
+        linear_ns = measure(n, 1, &linear_found);
+        printf("%8ld %14.1f %14.1f\n", n, hash_ns, linear_ns);
+        // every even probe is the upper case copy of a present type
+        if (hash_found != linear_found || hash_found != n) {
+            printf("FAILED n=%ld: %ld duplicates by hash, %ld by scan\n",
+                                            n, hash_found, linear_found);
+            failures++;
+        }
+    }
+    jsr211_result_pool_release();
+    return failures? 1: 0;
+}
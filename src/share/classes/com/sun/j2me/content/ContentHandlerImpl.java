@@ -127,6 +127,12 @@ public class ContentHandlerImpl extends ContentHandlerRegData
      */
     String authority;
 
+    /** The types folded to lower case, built on the first match. */
+    private String[] foldedTypes;
+
+    /** The suffixes folded to lower case, built on the first match. */
+    private String[] foldedSuffixes;
+
     /**
      * Initialize a new instance with the same information.
      * @param handler another ContentHandlerImpl
@@ -200,7 +206,20 @@ public class ContentHandlerImpl extends ContentHandlerRegData
      * is <code>null</code>
      */
     public boolean hasType(String type) {
-        return has(type, getTypes(), true);
+        return hasFoldedType(foldCase(type)); // Throw NPE if null
+    }
+
+    /**
+     * Determine if a type folded to lower case is supported.
+     *
+     * @param key the type folded by {@link #foldCase}
+     * @return <code>true</code> if the type is supported
+     */
+    boolean hasFoldedType(String key) {
+        if (foldedTypes == null) {
+            foldedTypes = fold(getTypes());
+        }
+        return has(key, foldedTypes);
     }
 
     /**
@@ -234,7 +253,20 @@ public class ContentHandlerImpl extends ContentHandlerRegData
      * is <code>null</code>
      */
     public boolean hasSuffix(String suffix) {
-        return has(suffix, getSuffixes(), true);
+        return hasFoldedSuffix(foldCase(suffix)); // Throw NPE if null
+    }
+
+    /**
+     * Determine if a suffix folded to lower case is supported.
+     *
+     * @param key the suffix folded by {@link #foldCase}
+     * @return <code>true</code> if the suffix is supported
+     */
+    boolean hasFoldedSuffix(String key) {
+        if (foldedSuffixes == null) {
+            foldedSuffixes = fold(getSuffixes());
+        }
+        return has(key, foldedSuffixes);
     }
 
     /**
@@ -280,7 +312,7 @@ public class ContentHandlerImpl extends ContentHandlerRegData
      * is <code>null</code>
      */
     public boolean hasAction(String action) {
-        return has(action, getActions(), false);
+        return has(action, getActions());
     }
 
     /**
@@ -312,24 +344,67 @@ public class ContentHandlerImpl extends ContentHandlerRegData
 
     /**
      * Determines if the string is in the array.
+     * Case-insensitive callers pass the key and the array both folded
+     * to lower case, so the match is always exact.
      * @param string to locate
      * @param strings array of strings to get from
-     * @param ignoreCase true to ignore case in matching
      * @return <code>true</code> if the value is found
      * @exception NullPointerException if <code>string</code>
      * is <code>null</code>
      */
-    static private boolean has(String string, String[] strings, boolean ignoreCase) {
-        int len = string.length(); // Throw NPE if null
+    static private boolean has(String string, String[] strings) {
+        int hash = string.hashCode(); // Throw NPE if null
         for (int i = 0; i < strings.length; i++) {
-            if (strings[i].length() == len &&
-                string.regionMatches(ignoreCase, 0, strings[i], 0, len)) {
+            if (strings[i].hashCode() == hash && string.equals(strings[i])) {
                 return true;
             }
         }
         return false;
     }
 
+    /**
+     * Folds the strings to lower case.
+     * @param strings array of strings to fold
+     * @return the array of the folded strings
+     */
+    static private String[] fold(String[] strings) {
+        String[] folded = new String[strings.length];
+        for (int i = 0; i < strings.length; i++) {
+            folded[i] = foldCase(strings[i]);
+        }
+        return folded;
+    }
+
+    /**
+     * Folds ASCII upper case letters of the type or suffix to lower case.
+     * Other characters are kept, so the result matches the native
+     * registry, which folds with <code>JSR211_FOLD</code>.
+     * @param string the string to fold
+     * @return the folded string, the same object if it has no upper case
+     *  ASCII letters
+     * @exception NullPointerException if <code>string</code>
+     * is <code>null</code>
+     */
+    static String foldCase(String string) {
+        int len = string.length();
+        int i = 0;
+        while (i < len) {
+            char c = string.charAt(i);
+            if (c >= 'A' && c <= 'Z') break;
+            i++;
+        }
+        if (i == len) {
+            return string;
+        }
+        char[] chars = string.toCharArray();
+        for (; i < len; i++) {
+            if (chars[i] >= 'A' && chars[i] <= 'Z') {
+                chars[i] += 'a' - 'A';
+            }
+        }
+        return new String(chars);
+    }
+
     /**
      * Get the mapping of actions to action names for the current
      * locale supported by this content handler. The behavior is
@@ -726,11 +801,11 @@ class HandlerTypeFilter extends HandlerFilter {
     
     protected HandlerTypeFilter(String type, ContentHandlerImpl.Handle.Receiver r) {
         super( r );
-        this.type = type;
+        this.type = ContentHandlerImpl.foldCase(type);
     }
 
     public void push(ContentHandlerImpl.Handle handle) {
-        if( handle.get().hasType(type) )
+        if( handle.get().hasFoldedType(type) )
             output.push(handle);
     } 
 }
@@ -754,11 +829,11 @@ class HandlerSuffixFilter extends HandlerFilter {
     
     protected HandlerSuffixFilter(String suffix, ContentHandlerImpl.Handle.Receiver r) {
         super( r );
-        this.suffix = suffix;
+        this.suffix = ContentHandlerImpl.foldCase(suffix);
     }
 
     public void push(ContentHandlerImpl.Handle handle) {
-        if( handle.get().hasSuffix(suffix) )
+        if( handle.get().hasFoldedSuffix(suffix) )
             output.push(handle);
     } 
 }
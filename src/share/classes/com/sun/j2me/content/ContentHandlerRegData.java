@@ -317,7 +317,8 @@ public class ContentHandlerRegData {
                         if (caseSens) {
                             if (s.equals(sprev)) break;
                         } else {
-                            if (s.equalsIgnoreCase(sprev)) break;
+                            if (ContentHandlerImpl.foldCase(s).equals(
+                                    ContentHandlerImpl.foldCase(sprev))) break;
                         }
                     }
                     if (e.hasMoreElements()) continue;
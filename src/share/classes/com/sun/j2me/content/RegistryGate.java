@@ -64,12 +64,45 @@ interface RegistryGate {
 	ContentHandlerImpl[] findConflicted(String handlerID);
 	ContentHandlerImpl.Data findHandler(String callerId, String handlerID, int searchMode);
 	ContentHandlerImpl[] findHandler(String callerId, int fieldId, String value);
+	ContentHandlerImpl[] findHandlerByURL(String callerId, String url, String action);
 	ContentHandlerImpl[] forSuite(int suiteId);
 	ContentHandlerImpl.Data getHandler(ApplicationID appID);
 	String[] getValues(String callerId, int fieldId);
 	ContentHandlerImpl.Data getHandlerData(String handlerID);
 	String[] getHandlerValues(String handlerID, int fieldId);
 	int selectSingleHandler(ContentHandlerRegData[] list, String action);
+	int getGeneration();
+
+	/**
+	 * Opens the cursor paging through the handlers found by the type,
+	 * suffix or action, so a query does not hold more than a page of
+	 * handlers at a time. The cursor MUST be closed by 
+	 * @link closeCursor.
+	 * @param callerId ID value to check access
+	 * @param fieldId @link FIELD_TYPES, @link FIELD_SUFFIXES or 
+	 *        @link FIELD_ACTIONS
+	 * @param value searched value
+	 * @return cursor handle or 0 if the cursor can't be opened
+	 */
+	int openCursor(String callerId, int fieldId, String value);
+
+	/**
+	 * Returns the next page of the found handlers. The handlers are paged
+	 * in the order of their IDs, a page continues after the last ID of 
+	 * the previous one even if the registry has changed meanwhile.
+	 * @param cursor cursor handle
+	 * @param maxCount maximum number of handlers in the page
+	 * @return the page, an empty array when the cursor is exhausted
+	 * @exception RuntimeException if the cursor is closed or has been
+	 *  reclaimed by the newer cursors
+	 */
+	ContentHandlerImpl[] nextPage(int cursor, int maxCount);
+
+	/**
+	 * Closes the cursor.
+	 * @param cursor cursor handle
+	 */
+	void closeCursor(int cursor);
 }
 
 interface RegistryMessageProcessor extends MessageProcessor {
@@ -83,6 +116,11 @@ interface RegistryMessageProcessor extends MessageProcessor {
 	static final int CODE_GetHandlerValues = 8;
 	static final int CODE_GetHandlerData = 9;
 	static final int CODE_SelectSingleHandler = 10;
+	static final int CODE_FindHandlerByURL = 11;
+	static final int CODE_GetGeneration = 12;
+	static final int CODE_OpenCursor = 13;
+	static final int CODE_NextPage = 14;
+	static final int CODE_CloseCursor = 15;
 }
 
 class RegistryRequestsConverter implements RegistryGate {
@@ -185,6 +223,19 @@ class RegistryRequestsConverter implements RegistryGate {
 		}
 	}
 
+	public ContentHandlerImpl[] findHandlerByURL(String callerId, String url, String action) {
+		Bytes dataOut = new Bytes();
+		try {
+			dataOut.writeUTFN(callerId);
+			dataOut.writeUTF(url);
+			dataOut.writeUTFN(action);
+			return toHandlersArray(out.sendMessage(RegistryMessageProcessor.CODE_FindHandlerByURL, 
+										dataOut.toByteArray()));
+		} catch (IOException e) {
+			throw new RuntimeException( e.getMessage() );
+		}
+	}
+
 	public ContentHandlerImpl[] forSuite(int suiteId) {
 		Bytes dataOut = new Bytes();
 		try {
@@ -263,6 +314,56 @@ class RegistryRequestsConverter implements RegistryGate {
 			throw new RuntimeException( e.getMessage() );
 		}
 	}
+
+	public int getGeneration() {
+		try {
+			byte[] data = out.sendMessage(RegistryMessageProcessor.CODE_GetGeneration, 
+								MessageProcessor.ZERO_BYTES);
+			return new DataInputStream( new ByteArrayInputStream( data ) ).readInt();
+		} catch (IOException e) {
+			throw new RuntimeException( e.getMessage() );
+		}
+	}
+
+	public int openCursor(String callerId, int fieldId, String value) {
+		Bytes dataOut = new Bytes();
+		try {
+			dataOut.writeUTFN(callerId);
+			dataOut.writeInt(fieldId);
+			dataOut.writeUTF(value);
+			byte[] data = out.sendMessage(RegistryMessageProcessor.CODE_OpenCursor, 
+								dataOut.toByteArray());
+			return new DataInputStream( new ByteArrayInputStream( data ) ).readInt();
+		} catch (IOException e) {
+			throw new RuntimeException( e.getMessage() );
+		}
+	}
+
+	public ContentHandlerImpl[] nextPage(int cursor, int maxCount) {
+		Bytes dataOut = new Bytes();
+		try {
+			dataOut.writeInt(cursor);
+			dataOut.writeInt(maxCount);
+			byte[] data = out.sendMessage(RegistryMessageProcessor.CODE_NextPage, 
+										dataOut.toByteArray());
+			if( data.length == 0 )
+				throw new RuntimeException( "registry cursor is not open" );
+			return toHandlersArray(data);
+		} catch (IOException e) {
+			throw new RuntimeException( e.getMessage() );
+		}
+	}
+
+	public void closeCursor(int cursor) {
+		Bytes dataOut = new Bytes();
+		try {
+			dataOut.writeInt(cursor);
+			out.sendMessage(RegistryMessageProcessor.CODE_CloseCursor, 
+								dataOut.toByteArray());
+		} catch (IOException e) {
+			throw new RuntimeException( e.getMessage() );
+		}
+	}
 }
 
 class RegistryRequestExecutor implements RegistryMessageProcessor {
@@ -286,6 +387,11 @@ class RegistryRequestExecutor implements RegistryMessageProcessor {
 			case CODE_GetHandlerValues: return getHandlerValues(dataIn);
 			case CODE_GetHandlerData: return getHandlerData(dataIn);
 			case CODE_SelectSingleHandler: return selectSinleHandler(dataIn);
+			case CODE_FindHandlerByURL: return findHandlerByURL(dataIn);
+			case CODE_GetGeneration: return getGeneration();
+			case CODE_OpenCursor: return openCursor(dataIn);
+			case CODE_NextPage: return nextPage(dataIn);
+			case CODE_CloseCursor: return closeCursor(dataIn);
 			default:
 				throw new RuntimeException( "illegal msg code " + msgCode );
 		}
@@ -345,6 +451,13 @@ class RegistryRequestExecutor implements RegistryMessageProcessor {
 		return toBytes( gate.findHandler(callerId, fieldId, value) );
 	}
 
+	private byte[] findHandlerByURL(DataInputStreamExt dataIn) throws IOException {
+		String callerId = dataIn.readUTFN();
+		String url = dataIn.readUTF();
+		String action = dataIn.readUTFN();
+		return toBytes( gate.findHandlerByURL(callerId, url, action) );
+	}
+
 	private byte[] forSuite(DataInputStream dataIn) throws IOException {
 		int suiteId = dataIn.readInt();
 		return toBytes( gate.forSuite(suiteId) );
@@ -382,4 +495,35 @@ class RegistryRequestExecutor implements RegistryMessageProcessor {
 		out.writeInt( gate.selectSingleHandler(list, action) );
 		return out.toByteArray();
 	}
-}
\ No newline at end of file
+
+	private byte[] getGeneration() throws IOException {
+		Bytes out = new Bytes();
+		out.writeInt( gate.getGeneration() );
+		return out.toByteArray();
+	}
+
+	private byte[] openCursor(DataInputStreamExt dataIn) throws IOException {
+		String callerId = dataIn.readUTFN();
+		int fieldId = dataIn.readInt();
+		String value = dataIn.readUTF();
+		Bytes out = new Bytes();
+		out.writeInt( gate.openCursor(callerId, fieldId, value) );
+		return out.toByteArray();
+	}
+
+	private byte[] nextPage(DataInputStream dataIn) throws IOException {
+		int cursor = dataIn.readInt();
+		int maxCount = dataIn.readInt();
+		try {
+			return toBytes( gate.nextPage(cursor, maxCount) );
+		} catch (RuntimeException e) {
+			// the empty response tells the client the cursor is not open
+			return ZERO_BYTES;
+		}
+	}
+
+	private byte[] closeCursor(DataInputStream dataIn) throws IOException {
+		gate.closeCursor( dataIn.readInt() );
+		return ZERO_BYTES;
+	}
+}
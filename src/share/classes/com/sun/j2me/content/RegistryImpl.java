@@ -72,6 +72,15 @@ public final class RegistryImpl {
     
     private int currentBlockID;
 
+    /** Results of <code>getValues</code> indexed by the field ID. */
+    private final String[][] valuesCache = new String[RegistryGate.FIELD_COUNT][];
+
+    /** Caller ID the cached values were selected for. */
+    private String valuesCaller;
+
+    /** Registry generation the cached values belong to. */
+    private int valuesGeneration;
+
     /** Count of responses received. */
     int responseCalls;
 
@@ -495,7 +504,7 @@ public final class RegistryImpl {
      * @return an array of types; MUST NOT be <code>null</code>
      */
     public String[] getTypes() {
-        return gate.getValues(getID(), RegistryGate.FIELD_TYPES);
+        return getValues(RegistryGate.FIELD_TYPES);
     }
 
     /**
@@ -507,7 +516,7 @@ public final class RegistryImpl {
      *  MUST NOT be <code>null</code>
      */
     public String[] getIDs() {
-        return gate.getValues(getID(), RegistryGate.FIELD_ID);
+        return getValues(RegistryGate.FIELD_ID);
     }
 
     /**
@@ -521,7 +530,7 @@ public final class RegistryImpl {
      *  MUST NOT be <code>null</code>
      */
     public String[] getActions() {
-        return gate.getValues(getID(), RegistryGate.FIELD_ACTIONS);
+        return getValues(RegistryGate.FIELD_ACTIONS);
     }
 
     /**
@@ -535,7 +544,38 @@ public final class RegistryImpl {
      *  MUST NOT be <code>null</code>
      */
     public String[] getSuffixes() {
-        return gate.getValues(getID(), RegistryGate.FIELD_SUFFIXES);
+        return getValues(RegistryGate.FIELD_SUFFIXES);
+    }
+
+    /**
+     * Gets all values of the field accessible to this application.
+     * The values are requested from the registry once and reused
+     * until the registry generation changes. The generation is asked
+     * on every call, so the values registered or unregistered by other
+     * isolates are seen at once.
+     *
+     * @param fieldId index of the field
+     * @return a copy of the values array
+     */
+    private String[] getValues(int fieldId) {
+        String callerId = getID();
+        int generation = gate.getGeneration();
+        synchronized (valuesCache) {
+            if (generation != valuesGeneration || valuesCaller == null ||
+                    !valuesCaller.equals(callerId)) {
+                for (int i = 0; i < valuesCache.length; i++) {
+                    valuesCache[i] = null;
+                }
+                valuesCaller = callerId;
+                valuesGeneration = generation;
+            }
+            if (valuesCache[fieldId] == null) {
+                valuesCache[fieldId] = gate.getValues(callerId, fieldId);
+            }
+            String[] result = new String[valuesCache[fieldId].length];
+            System.arraycopy(valuesCache[fieldId], 0, result, 0, result.length);
+            return result;
+        }
     }
 
     /**
@@ -995,6 +1035,8 @@ public final class RegistryImpl {
                 output = new HandlerActionFilter( invoc.getAction(), output );
             }
 
+            boolean byURL = false;
+
             // ID is null
             synchronized (mutex) {
                 // Inhibit types change while doing lookups
@@ -1011,13 +1053,7 @@ public final class RegistryImpl {
                             RegistryGate.FIELD_TYPES, invoc.getType(), 
                             output );
                 } else if (invoc.getURL() != null) {
-                    int lpIdx = invoc.getURL().lastIndexOf('.');
-                    if( lpIdx != -1 ){
-                        String suffix = invoc.getURL().substring(lpIdx);
-                        gate.enumHandlers( getID(), 
-                                RegistryGate.FIELD_SUFFIXES, suffix, 
-                                output );
-                    }
+                    byURL = true;
                 } else if (invoc.getAction() != null) {
                     gate.enumHandlers( getID(), 
                             RegistryGate.FIELD_ACTIONS, invoc.getAction(), 
@@ -1027,6 +1063,14 @@ public final class RegistryImpl {
                                 "not ID, type, URL, or action");
                 }
             }
+            if (byURL) {
+                // suffix match and action filter are done by the registry,
+                // the single native call needs no types lock
+                ContentHandlerImpl[] found = gate.findHandlerByURL( getID(), 
+                        invoc.getURL(), invoc.getAction() );
+                for( int i = 0; i < found.length; i++ )
+                    collection.push( found[i].handle );
+            }
             handlers = collection.getArray();
         }
         if (handlers == null || handlers.length == 0) {
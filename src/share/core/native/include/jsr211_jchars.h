@@ -0,0 +1,113 @@
+/*
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation. 
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt). 
+ * 
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA 
+ * 
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions. 
+ */
+
+/**
+ * @file
+ * @brief Comparison kernels for UTF-16 (jchar) buffers.
+ *
+ * The kernels compare 8 (SSE2) or 16 (AVX2) jchars at a time when the
+ * compiler targets these instruction sets, and fall back to the plain
+ * loop otherwise. Case-insensitive comparison folds ASCII letters only,
+ * as @link JSR211_FOLD does for types and suffixes.
+ * <P>
+ * The header does not depend on KNI, the buffers are declared as
+ * <code>unsigned short</code>, the representation of jchar and
+ * javacall_utf16.
+ */
+
+#ifndef _JSR211_JCHARS_H_
+#define _JSR211_JCHARS_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif/*__cplusplus*/
+
+/**
+ * Folds the character for case-insensitive matching of types and
+ * suffixes: ASCII letters are lowercased.
+ */
+#define JSR211_FOLD(c) (((c) >= 'A' && (c) <= 'Z')? \
+        (unsigned short)((c) + ('a' - 'A')): (unsigned short)(c))
+
+/**
+ * Finds the first position where the buffers differ.
+ * @param a first buffer
+ * @param b second buffer
+ * @param len number of jchars to compare
+ * @return index of the first differing jchar or len if the buffers are equal
+ */
+size_t jsr211_jchars_mismatch(const unsigned short* a, const unsigned short* b,
+                                                                size_t len);
+
+/**
+ * Finds the first position where the buffers differ ignoring the case of
+ * ASCII letters.
+ * @param a first buffer
+ * @param b second buffer
+ * @param len number of jchars to compare
+ * @return index of the first differing jchar or len if the buffers match
+ */
+size_t jsr211_jchars_mismatch_fold(const unsigned short* a,
+                                    const unsigned short* b, size_t len);
+
+/**
+ * Tests the buffers for equality.
+ * @return non-zero if the buffers are equal
+ */
+#define jsr211_jchars_equal(a, b, len) \
+    (jsr211_jchars_mismatch((a), (b), (len)) == (len))
+
+/**
+ * Tests the buffers for equality ignoring the case of ASCII letters.
+ * @return non-zero if the buffers match
+ */
+#define jsr211_jchars_equal_fold(a, b, len) \
+    (jsr211_jchars_mismatch_fold((a), (b), (len)) == (len))
+
+/**
+ * Compares the strings lexicographically by jchar values.
+ * @param a first string
+ * @param a_len first string length in jchars
+ * @param b second string
+ * @param b_len second string length in jchars
+ * @return negative, zero or positive value if the first string is less
+ * than, equal to or greater than the second one
+ */
+int jsr211_jchars_compare(const unsigned short* a, size_t a_len,
+                                    const unsigned short* b, size_t b_len);
+
+/**
+ * Returns length of the zero terminated string.
+ * @param str the string
+ * @return the length in jchars
+ */
+size_t jsr211_jchars_length(const unsigned short* str);
+
+#ifdef __cplusplus
+}
+#endif/*__cplusplus*/
+
+#endif /* _JSR211_JCHARS_H_ */
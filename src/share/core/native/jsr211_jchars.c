@@ -0,0 +1,121 @@
+/*
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation. 
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt). 
+ * 
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA 
+ * 
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions. 
+ */
+
+/**
+ * @file
+ * @brief Comparison kernels for UTF-16 (jchar) buffers.
+ */
+
+#include "jsr211_jchars.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define JCHARS_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define JCHARS_SSE2
+#endif
+
+#if defined(JCHARS_AVX2)
+
+#define BLOCK 16
+
+/* Loads 16 jchars; the result is -1 in the lanes where they are equal. */
+#define LOAD(p) _mm256_loadu_si256((const __m256i*)(p))
+#define BLOCK_EQUAL(x, y) \
+    (_mm256_movemask_epi8(_mm256_cmpeq_epi16((x), (y))) == -1)
+
+/* Lowercases ASCII letters: adds 0x20 to the lanes in 'A'..'Z'. */
+static __m256i fold_block(__m256i x) {
+    __m256i upper = _mm256_and_si256(
+        _mm256_cmpgt_epi16(x, _mm256_set1_epi16('A' - 1)),
+        _mm256_cmpgt_epi16(_mm256_set1_epi16('Z' + 1), x));
+    return _mm256_or_si256(x, _mm256_and_si256(upper, _mm256_set1_epi16(0x20)));
+}
+
+#elif defined(JCHARS_SSE2)
+
+#define BLOCK 8
+
+#define LOAD(p) _mm_loadu_si128((const __m128i*)(p))
+#define BLOCK_EQUAL(x, y) \
+    (_mm_movemask_epi8(_mm_cmpeq_epi16((x), (y))) == 0xFFFF)
+
+static __m128i fold_block(__m128i x) {
+    __m128i upper = _mm_and_si128(
+        _mm_cmpgt_epi16(x, _mm_set1_epi16('A' - 1)),
+        _mm_cmplt_epi16(x, _mm_set1_epi16('Z' + 1)));
+    return _mm_or_si128(x, _mm_and_si128(upper, _mm_set1_epi16(0x20)));
+}
+
+#endif
+
+/**
+ * Finds the first position where the buffers differ.
+ */
+size_t jsr211_jchars_mismatch(const unsigned short* a, const unsigned short* b,
+                                                                size_t len) {
+    size_t i = 0;
+#ifdef BLOCK
+    // skip equal blocks, the differing one is scanned below
+    for (; i + BLOCK <= len && BLOCK_EQUAL(LOAD(a + i), LOAD(b + i)); i += BLOCK);
+#endif
+    for (; i < len && a[i] == b[i]; i++);
+    return i;
+}
+
+/**
+ * Finds the first position where the buffers differ ignoring the case of
+ * ASCII letters.
+ */
+size_t jsr211_jchars_mismatch_fold(const unsigned short* a,
+                                    const unsigned short* b, size_t len) {
+    size_t i = 0;
+#ifdef BLOCK
+    for (; i + BLOCK <= len &&
+            BLOCK_EQUAL(fold_block(LOAD(a + i)), fold_block(LOAD(b + i))); i += BLOCK);
+#endif
+    for (; i < len && JSR211_FOLD(a[i]) == JSR211_FOLD(b[i]); i++);
+    return i;
+}
+
+/**
+ * Compares the strings lexicographically by jchar values.
+ */
+int jsr211_jchars_compare(const unsigned short* a, size_t a_len,
+                          const unsigned short* b, size_t b_len) {
+    size_t len = (a_len < b_len)? a_len: b_len;
+    size_t i = jsr211_jchars_mismatch(a, b, len);
+    if (i < len) return (int)a[i] - (int)b[i];
+    return (a_len < b_len)? -1: (a_len > b_len)? 1: 0;
+}
+
+/**
+ * Returns length of the zero terminated string.
+ */
+size_t jsr211_jchars_length(const unsigned short* str) {
+    const unsigned short* p = str;
+    while (*p) p++;
+    return p - str;
+}
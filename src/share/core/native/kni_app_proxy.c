@@ -32,9 +32,10 @@
 
 #include <jsrop_kni.h>
 #include <jsrop_suitestore.h>
-#include <javautil_unicode.h>
 #include <javacall_memory.h>
 
+#include "jsr211_jchars.h"
+
 //---------------------------------------------------------
 
 KNIEXPORT KNI_RETURNTYPE_BOOLEAN
@@ -74,12 +75,12 @@ static void destroyMidletIdChain( MidletIdChain * elem ){
 
 static int compareMidletIdChain( const MidletIdChain * elem, 
                     SuiteIdType suiteId, javacall_utf16_string midletClassName ){
-    javacall_int32 comparison;
     // assert( elem != NULL );
     if( elem->suiteId != suiteId )
         return elem->suiteId - suiteId;
-    javautil_unicode_cmp(elem->className, midletClassName, &comparison);
-    return comparison;
+    return jsr211_jchars_compare(
+                elem->className, jsr211_jchars_length(elem->className),
+                midletClassName, jsr211_jchars_length(midletClassName));
 }
 
 static MidletIdChain ** findMidletIdChain( SuiteIdType suiteId, javacall_utf16_string midletClassName ) {